@@ -0,0 +1,543 @@
+#if !defined(_WIN32) && !defined(_XOPEN_SOURCE)
+    #define _XOPEN_SOURCE 700 // clock_gettime
+#endif
+
+#include "bench_alloc.h"
+#include "cslw/cslw.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <time.h>
+#endif
+
+// Usage: cslw_bench [--json] [filter]
+// Every case runs once through cslw and once through the raw Lua C API doing the same work.
+
+#define BENCH_BATCH_NS   (20 * 1000)          // Minimum length of one timed batch
+#define BENCH_MIN_NS     (200 * 1000 * 1000)  // Minimum time spent per case
+#define BENCH_MAX_BATCHES 1000
+#define BENCH_FLAT_KEYS  16
+#define BENCH_LARGE_SIZE 1000
+
+// Allocation Counting
+//------------------------------------------------------------------------
+uint64_t bench_allocs = 0;
+
+void* bench_malloc(size_t sz)            { bench_allocs++; return malloc(sz); }
+void* bench_calloc(size_t c, size_t sz)  { bench_allocs++; return calloc(c, sz); }
+void* bench_realloc(void* b, size_t sz)  { bench_allocs++; return realloc(b, sz); }
+void  bench_free(void* b)                { free(b); }
+
+// For the raw Lua states, so both sides are counted the same way.
+static void*
+bench_lua_alloc(void* ud, void* ptr, size_t osize, size_t nsize)
+{
+    (void)ud;
+    (void)osize;
+
+    if (nsize == 0)
+    {
+        bench_free(ptr);
+        return NULL;
+    }
+
+    return bench_realloc(ptr, nsize);
+}
+
+static uint64_t
+bench_clock_ns()
+{
+#if defined(_WIN32)
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (freq.QuadPart == 0)
+        QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (uint64_t)((double)now.QuadPart * (1000000000.0 / (double)freq.QuadPart));
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// Shared State
+//------------------------------------------------------------------------
+static slwState* bslw = NULL;
+static lua_State* bL = NULL;
+static slwTable* btable = NULL;
+static volatile double bsink = 0;
+
+static const char* bkeys[BENCH_FLAT_KEYS] = {
+    "k0", "k1", "k2",  "k3",  "k4",  "k5",  "k6",  "k7",
+    "k8", "k9", "k10", "k11", "k12", "k13", "k14", "k15"
+};
+
+static void
+bench_check(bool ok)
+{
+    if (ok)
+        return;
+
+    fprintf(stderr, "bench: setup failed: %s\n", bL ? lua_tostring(bL, -1) : "no state");
+    exit(1);
+}
+
+static void
+bench_setup_cslw()
+{
+    bslw = slwState_new_with(slw_lib_all);
+    bench_check(bslw != NULL);
+    bL = bslw->LState;
+}
+
+static void
+bench_setup_lua()
+{
+    bL = lua_newstate(bench_lua_alloc, NULL);
+    bench_check(bL != NULL);
+    luaL_openlibs(bL);
+}
+
+static void
+bench_teardown()
+{
+    if (btable)
+    {
+        slwTable_free(btable);
+        btable = NULL;
+    }
+
+    if (bslw)
+        slwState_destroy(bslw);
+    else if (bL)
+        lua_close(bL);
+
+    bslw = NULL;
+    bL = NULL;
+}
+
+// `slwTable_free` only frees the top level, tables from `slwTable_get_at` own their children.
+static void
+bench_table_free(slwTable* slt)
+{
+    for (size_t i = 0; i < slt->size; i++)
+    {
+        if (slt->elements[i].ltype == LUA_TTABLE)
+            bench_table_free(slt->elements[i].value.t);
+    }
+
+    slwTable_free(slt);
+}
+
+// Reads a table into C the way slwTable_get_at would, without building the tree.
+static void
+bench_lua_walk(lua_State* L, int idx)
+{
+    idx = lua_absindex(L, idx);
+    lua_pushnil(L);
+    while (lua_next(L, idx) != 0)
+    {
+        if (lua_type(L, -1) == LUA_TTABLE)
+            bench_lua_walk(L, -1);
+        else
+            bsink += lua_tonumber(L, -1) + (double)(size_t)lua_tostring(L, -2);
+
+        lua_pop(L, 1);
+    }
+}
+
+// State Creation
+//------------------------------------------------------------------------
+static void bench_noop() {}
+
+static void
+bench_state_new_cslw(uint64_t n)
+{
+    for (uint64_t i = 0; i < n; i++)
+    {
+        slwState* slw = slwState_new_with(slw_lib_all);
+        slwState_destroy(slw);
+    }
+}
+
+static void
+bench_state_new_lua(uint64_t n)
+{
+    for (uint64_t i = 0; i < n; i++)
+    {
+        lua_State* L = lua_newstate(bench_lua_alloc, NULL);
+        luaL_openlibs(L);
+        lua_close(L);
+    }
+}
+
+// slwTable_push
+//------------------------------------------------------------------------
+static void
+bench_push_setup_cslw()
+{
+    bench_setup_cslw();
+    btable = slwTable_create();
+    for (int i = 0; i < BENCH_FLAT_KEYS; i++)
+        slwTable_setnumber(btable, bkeys[i], i + 0.5);
+}
+
+static void
+bench_push_cslw(uint64_t n)
+{
+    for (uint64_t i = 0; i < n; i++)
+    {
+        slwTable_push(bslw, btable);
+        slwStack_pop(bslw, 1);
+    }
+}
+
+static void
+bench_push_lua(uint64_t n)
+{
+    for (uint64_t i = 0; i < n; i++)
+    {
+        lua_createtable(bL, 0, BENCH_FLAT_KEYS);
+        for (int k = 0; k < BENCH_FLAT_KEYS; k++)
+        {
+            lua_pushnumber(bL, k + 0.5);
+            lua_setfield(bL, -2, bkeys[k]);
+        }
+        lua_pop(bL, 1);
+    }
+}
+
+// slwTable_get_at
+//------------------------------------------------------------------------
+static void
+bench_get_setup(const char* global, const char* code, bool cslw)
+{
+    if (cslw)
+        bench_setup_cslw();
+    else
+        bench_setup_lua();
+
+    bench_check(luaL_dostring(bL, code) == 0);
+    lua_settop(bL, 0);
+    lua_getglobal(bL, global);
+}
+
+static const char* bench_flat_code =
+    "bench_t = {} for i = 0, 15 do bench_t['k' .. i] = i + 0.5 end";
+static const char* bench_nested_code =
+    "bench_t = { a = { b = { c = 1, d = 2 }, e = 3 }, f = { g = { h = { i = 4 } } }, j = 5, k = { l = 6, m = 7 } }";
+static const char* bench_large_code =
+    "bench_t = {} for i = 1, 1000 do bench_t[i] = i * 0.5 end";
+
+static void bench_get_flat_setup_cslw()   { bench_get_setup("bench_t", bench_flat_code, true); }
+static void bench_get_flat_setup_lua()    { bench_get_setup("bench_t", bench_flat_code, false); }
+static void bench_get_nested_setup_cslw() { bench_get_setup("bench_t", bench_nested_code, true); }
+static void bench_get_nested_setup_lua()  { bench_get_setup("bench_t", bench_nested_code, false); }
+static void bench_get_large_setup_cslw()  { bench_get_setup("bench_t", bench_large_code, true); }
+static void bench_get_large_setup_lua()   { bench_get_setup("bench_t", bench_large_code, false); }
+
+static void
+bench_get_cslw(uint64_t n)
+{
+    for (uint64_t i = 0; i < n; i++)
+    {
+        slwTable* slt = slwTable_get_at(bslw, -1);
+        bsink += (double)slt->size;
+        bench_table_free(slt);
+    }
+}
+
+static void
+bench_get_lua(uint64_t n)
+{
+    for (uint64_t i = 0; i < n; i++)
+        bench_lua_walk(bL, -1);
+}
+
+static void
+bench_get_large_lua(uint64_t n)
+{
+    static double values[BENCH_LARGE_SIZE];
+    for (uint64_t i = 0; i < n; i++)
+    {
+        const int len = (int)lua_rawlen(bL, -1);
+        for (int k = 1; k <= len; k++)
+        {
+            lua_rawgeti(bL, -1, k);
+            values[k - 1] = lua_tonumber(bL, -1);
+            lua_pop(bL, 1);
+        }
+        bsink += values[len - 1];
+    }
+}
+
+// slwState_call_fn_at
+//------------------------------------------------------------------------
+static const char* bench_fn_code = "function bench_fn(a, b) return a + b end";
+
+static void
+bench_call_setup_cslw()
+{
+    bench_setup_cslw();
+    bench_check(slwState_runstring(bslw, bench_fn_code));
+    lua_settop(bL, 0);
+}
+
+static void
+bench_call_setup_lua()
+{
+    bench_setup_lua();
+    bench_check(luaL_dostring(bL, bench_fn_code) == 0);
+    lua_settop(bL, 0);
+}
+
+static void
+bench_call_cslw(uint64_t n)
+{
+    slwTableValue a = slwt_tnumber(1.5);
+    slwTableValue b = slwt_tnumber(2.5);
+    for (uint64_t i = 0; i < n; i++)
+    {
+        lua_getglobal(bL, "bench_fn");
+        if (!slwState_call_fn_at(bslw, -1, &a, &b, NULL))
+            bench_check(false);
+        bsink += slwStack_tonumber(bslw, -1);
+        lua_settop(bL, 0);
+    }
+}
+
+static void
+bench_call_lua(uint64_t n)
+{
+    for (uint64_t i = 0; i < n; i++)
+    {
+        lua_getglobal(bL, "bench_fn");
+        lua_pushnumber(bL, 1.5);
+        lua_pushnumber(bL, 2.5);
+        if (lua_pcall(bL, 2, LUA_MULTRET, 0) != 0)
+            bench_check(false);
+        bsink += lua_tonumber(bL, -1);
+        lua_settop(bL, 0);
+    }
+}
+
+// slwState_set* / slwState_get*
+//------------------------------------------------------------------------
+static void
+bench_global_number_cslw(uint64_t n)
+{
+    for (uint64_t i = 0; i < n; i++)
+    {
+        slwState_setnumber(bslw, "bench_g", (double)i);
+        bsink += slwState_getnumber(bslw, "bench_g").value.d;
+        slwStack_pop(bslw, 1);
+    }
+}
+
+static void
+bench_global_number_lua(uint64_t n)
+{
+    for (uint64_t i = 0; i < n; i++)
+    {
+        lua_pushnumber(bL, (double)i);
+        lua_setglobal(bL, "bench_g");
+        lua_getglobal(bL, "bench_g");
+        bsink += lua_tonumber(bL, -1);
+        lua_pop(bL, 1);
+    }
+}
+
+static void
+bench_global_int_cslw(uint64_t n)
+{
+    for (uint64_t i = 0; i < n; i++)
+    {
+        slwState_setint(bslw, "bench_g", i);
+        bsink += slwState_getint(bslw, "bench_g").value.l;
+        slwStack_pop(bslw, 1);
+    }
+}
+
+static void
+bench_global_int_lua(uint64_t n)
+{
+    for (uint64_t i = 0; i < n; i++)
+    {
+        lua_pushinteger(bL, (lua_Integer)i);
+        lua_setglobal(bL, "bench_g");
+        lua_getglobal(bL, "bench_g");
+        bsink += (double)lua_tointeger(bL, -1);
+        lua_pop(bL, 1);
+    }
+}
+
+static void
+bench_global_string_cslw(uint64_t n)
+{
+    for (uint64_t i = 0; i < n; i++)
+    {
+        slwState_setstring(bslw, "bench_g", bkeys[i & 15]);
+        bsink += (double)(size_t)slwState_getstring(bslw, "bench_g").value.s;
+        slwStack_pop(bslw, 1);
+    }
+}
+
+static void
+bench_global_string_lua(uint64_t n)
+{
+    for (uint64_t i = 0; i < n; i++)
+    {
+        lua_pushstring(bL, bkeys[i & 15]);
+        lua_setglobal(bL, "bench_g");
+        lua_getglobal(bL, "bench_g");
+        bsink += (double)(size_t)lua_tostring(bL, -1);
+        lua_pop(bL, 1);
+    }
+}
+
+// Harness
+//------------------------------------------------------------------------
+typedef struct benchCase
+{
+    const char* name;
+    const char* impl;
+    void (*setup)();
+    void (*run)(uint64_t n);
+} benchCase;
+
+static const benchCase bcases[] = {
+    { "state_new",          "cslw", bench_noop,                  bench_state_new_cslw },
+    { "state_new",          "lua",  bench_noop,                  bench_state_new_lua },
+    { "table_push",         "cslw", bench_push_setup_cslw,       bench_push_cslw },
+    { "table_push",         "lua",  bench_setup_lua,             bench_push_lua },
+    { "table_get_at_flat",  "cslw", bench_get_flat_setup_cslw,   bench_get_cslw },
+    { "table_get_at_flat",  "lua",  bench_get_flat_setup_lua,    bench_get_lua },
+    { "table_get_at_nested","cslw", bench_get_nested_setup_cslw, bench_get_cslw },
+    { "table_get_at_nested","lua",  bench_get_nested_setup_lua,  bench_get_lua },
+    { "table_get_at_large", "cslw", bench_get_large_setup_cslw,  bench_get_cslw },
+    { "table_get_at_large", "lua",  bench_get_large_setup_lua,   bench_get_large_lua },
+    { "call_fn_at",         "cslw", bench_call_setup_cslw,       bench_call_cslw },
+    { "call_fn_at",         "lua",  bench_call_setup_lua,        bench_call_lua },
+    { "global_number",      "cslw", bench_setup_cslw,            bench_global_number_cslw },
+    { "global_number",      "lua",  bench_setup_lua,             bench_global_number_lua },
+    { "global_int",         "cslw", bench_setup_cslw,            bench_global_int_cslw },
+    { "global_int",         "lua",  bench_setup_lua,             bench_global_int_lua },
+    { "global_string",      "cslw", bench_setup_cslw,            bench_global_string_cslw },
+    { "global_string",      "lua",  bench_setup_lua,             bench_global_string_lua },
+};
+
+typedef struct benchResult
+{
+    double mean;
+    double p50;
+    double p90;
+    double p99;
+    double allocs;
+} benchResult;
+
+static int
+bench_cmp(const void* a, const void* b)
+{
+    const double x = *(const double*)a;
+    const double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double
+bench_percentile(const double* sorted, int count, double p)
+{
+    int idx = (int)(p / 100.0 * (count - 1) + 0.5);
+    return sorted[idx];
+}
+
+static benchResult
+bench_measure(const benchCase* bc)
+{
+    static double samples[BENCH_MAX_BATCHES];
+
+    bc->setup();
+
+    // Grow the batch until it's long enough for the clock to be accurate, this also warms up.
+    uint64_t batch = 1;
+    for (;;)
+    {
+        const uint64_t start = bench_clock_ns();
+        bc->run(batch);
+        if (bench_clock_ns() - start >= BENCH_BATCH_NS)
+            break;
+        batch *= 2;
+    }
+
+    int count = 0;
+    uint64_t totalNs = 0;
+    uint64_t totalOps = 0;
+    const uint64_t allocs = bench_allocs;
+
+    while (count < BENCH_MAX_BATCHES && (totalNs < BENCH_MIN_NS || count < 10))
+    {
+        const uint64_t start = bench_clock_ns();
+        bc->run(batch);
+        const uint64_t elapsed = bench_clock_ns() - start;
+
+        samples[count++] = (double)elapsed / (double)batch;
+        totalNs += elapsed;
+        totalOps += batch;
+    }
+
+    benchResult result;
+    result.allocs = (double)(bench_allocs - allocs) / (double)totalOps;
+    result.mean = (double)totalNs / (double)totalOps;
+
+    qsort(samples, count, sizeof(double), bench_cmp);
+    result.p50 = bench_percentile(samples, count, 50.0);
+    result.p90 = bench_percentile(samples, count, 90.0);
+    result.p99 = bench_percentile(samples, count, 99.0);
+
+    bench_teardown();
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    bool json = false;
+    const char* filter = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--json") == 0)
+            json = true;
+        else
+            filter = argv[i];
+    }
+
+    if (!json)
+        printf("%-22s %-5s %12s %12s %12s %12s %10s\n", "case", "impl", "ns/op", "p50", "p90", "p99", "allocs/op");
+
+    for (size_t i = 0; i < sizeof(bcases) / sizeof(bcases[0]); i++)
+    {
+        const benchCase* bc = &bcases[i];
+        if (filter && !strstr(bc->name, filter))
+            continue;
+
+        const benchResult r = bench_measure(bc);
+        if (json)
+        {
+            printf("{\"case\":\"%s\",\"impl\":\"%s\",\"ns_per_op\":%.2f,\"p50\":%.2f,\"p90\":%.2f,\"p99\":%.2f,\"allocs_per_op\":%.2f}\n",
+                bc->name, bc->impl, r.mean, r.p50, r.p90, r.p99, r.allocs);
+        } else
+        {
+            printf("%-22s %-5s %12.1f %12.1f %12.1f %12.1f %10.2f\n",
+                bc->name, bc->impl, r.mean, r.p50, r.p90, r.p99, r.allocs);
+        }
+        fflush(stdout);
+    }
+
+    return 0;
+}
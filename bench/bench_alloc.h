@@ -0,0 +1,27 @@
+#ifndef CSLW_BENCH_ALLOC_H
+#define CSLW_BENCH_ALLOC_H
+
+// Force-included (`-include`) into the library when it's built for the benchmarks,
+// every allocation that goes through `slw_*` (Lua's included) bumps `bench_allocs`.
+
+// This comes before anything else in the library, so it has to set the library's feature macro.
+#if !defined(_WIN32) && !defined(_XOPEN_SOURCE)
+    #define _XOPEN_SOURCE 700
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+extern uint64_t bench_allocs;
+
+void* bench_malloc(size_t sz);
+void* bench_calloc(size_t c, size_t sz);
+void* bench_realloc(void* b, size_t sz);
+void  bench_free(void* b);
+
+#define slw_malloc(sz)     bench_malloc(sz)
+#define slw_calloc(c, sz)  bench_calloc(c, sz)
+#define slw_realloc(b, sz) bench_realloc(b, sz)
+#define slw_free(b)        bench_free(b)
+
+#endif
@@ -0,0 +1,101 @@
+#include "cslw/cslw.h"
+
+#include <stdio.h>
+#include <math.h>
+
+typedef struct Vec2
+{
+    double x;
+    double y;
+} Vec2;
+
+extern const slwClass Vec2Class;
+
+int l_vec2_new(lua_State* L)
+{
+    slwState view = slwState_view(L);
+
+    Vec2* v = slwClass_new(&view, &Vec2Class);
+    v->x = luaL_optnumber(L, 1, 0.0);
+    v->y = luaL_optnumber(L, 2, 0.0);
+    return 1;
+}
+
+int l_vec2_length(lua_State* L)
+{
+    slwState view = slwState_view(L);
+    Vec2* v = slwClass_check(&view, 1);
+
+    slwStack_pushnumber(&view, sqrt(v->x * v->x + v->y * v->y));
+    return 1;
+}
+
+// Computed on every access, plain members are bound as fields instead
+int l_vec2_get_angle(lua_State* L)
+{
+    slwState view = slwState_view(L);
+    Vec2* v = slwClass_check(&view, 1);
+
+    slwStack_pushnumber(&view, atan2(v->y, v->x));
+    return 1;
+}
+
+void vec2_gc(void* self)
+{
+    Vec2* v = self;
+    printf("vec2 (%g, %g) collected\n", v->x, v->y);
+}
+
+const slwClassMethod Vec2Methods[] = {
+    { "length", l_vec2_length },
+    { NULL, NULL }
+};
+
+const slwClassProperty Vec2Properties[] = {
+    { "angle", l_vec2_get_angle, NULL },
+    { NULL, NULL, NULL }
+};
+
+const slwClassField Vec2Fields[] = {
+    slw_field(Vec2, x, slw_field_number),
+    slw_field(Vec2, y, slw_field_number),
+    slw_field_end
+};
+
+const slwClass Vec2Class = {
+    .name = "Vec2",
+    .size = sizeof(Vec2),
+    .methods = Vec2Methods,
+    .properties = Vec2Properties,
+    .fields = Vec2Fields,
+    .gc = vec2_gc,
+    .close = vec2_gc,
+};
+
+int main(void)
+{
+    slwState* slw = slwState_new_with(slw_lib_all);
+    if (!slw)
+    {
+        fprintf(stderr, "Failed to create state\n");
+        return 1;
+    }
+
+    slwClass_register(slw, &Vec2Class);
+    slwState_setcfunction(slw, "Vec2", l_vec2_new);
+
+    if (!slwState_runstring(slw,
+        "local v = Vec2(3, 4)\n"
+        "print(v.x, v.y, v:length(), v.angle)\n"
+        "v.x = 6; v.y = 8\n"
+        "print(v:length())\n"
+        "print(pcall(v.length, {}))\n"
+        "print(pcall(function() v.x = 'a' end))\n"
+        "print(pcall(function() v.z = 1 end))\n"
+        "do local closed <close> = Vec2(1, 2) end\n"))
+    {
+        printf("Failed: %s\n", lua_tostring(slw->LState, -1));
+    }
+
+    slwState_destroy(slw);
+}
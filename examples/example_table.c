@@ -6,11 +6,8 @@
 
 int l_my_function(lua_State* L)
 {
-#if defined(SLW_GENERICS_SUPPORT)
-    slwState* slw = slwState_new(L);
-#else
-    slwState* slw = slwState_new_from_luas(L);
-#endif
+    slwState view = slwState_view(L);
+    slwState* slw = &view;
     printf("l_my_function called\n");
 
     slwTable* tbl = slwTable_get_at(slw, -1);
@@ -1,6 +1,12 @@
 #ifndef CSLW_H
 #define CSLW_H
 
+// The single header (`make single`) carries the implementation too, its feature macro has to
+// come before the first system header.
+#if defined(CSLW_IMPLEMENTATION) && !defined(_WIN32) && !defined(_XOPEN_SOURCE)
+    #define _XOPEN_SOURCE 700
+#endif
+
 #if defined(CLW_USE_LUAJIT)
     #include "luajit.h"
 #endif
@@ -10,11 +16,24 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
 
 // Type Definitions
 //------------------------------------------------------------------------
 typedef struct slwTableValue slwTableValue;
 typedef struct slwTable slwTable;
+typedef struct _slwTableBinding _slwTableBinding;
+typedef struct slwProfiler slwProfiler;
+typedef struct slwCStats slwCStats;
+typedef struct slwClass slwClass;
+typedef struct slwStore slwStore;
+typedef struct slwChannel slwChannel;
+typedef struct slwJsonDecoder slwJsonDecoder;
+typedef struct slwEventHandler slwEventHandler;
+typedef struct slwPath slwPath;
 
 // Definitions
 //------------------------------------------------------------------------
@@ -37,6 +56,53 @@ typedef struct slwTable slwTable;
     #define SLW_RECURSION_DEPTH 32
 #endif
 
+// How deep arrays and objects can nest in a JSON document being decoded, the decoder isn't recursive.
+#if !defined(SLW_JSON_MAX_DEPTH)
+    #define SLW_JSON_MAX_DEPTH 128
+#endif
+
+// How many VM instructions run between two budget checks, the clock is only read this often.
+#if !defined(SLW_BUDGET_CHECK_INTERVAL)
+    #define SLW_BUDGET_CHECK_INTERVAL 1000
+#endif
+
+// Error message raised inside the Lua State when a budget runs out.
+#define SLW_BUDGET_ERROR "cslw: execution budget exceeded"
+
+// How many VM instructions run between two profiler clock checks (count hook profiler only).
+#if !defined(SLW_PROFILER_CHECK_INTERVAL)
+    #define SLW_PROFILER_CHECK_INTERVAL 1000
+#endif
+
+// POSIX builds sample from a SIGPROF timer and pay nothing between samples,
+// otherwise the profiler falls back to a count hook that checks the clock (much slower, see `slwProfiler_start`).
+#if !defined(SLW_PROFILER_USE_SIGNAL)
+    #if defined(_WIN32)
+        #define SLW_PROFILER_USE_SIGNAL 0
+    #else
+        #define SLW_PROFILER_USE_SIGNAL 1
+    #endif
+#endif
+
+// How many states can be profiled at the same time with SIGPROF.
+#if !defined(SLW_PROFILER_MAX_STATES)
+    #define SLW_PROFILER_MAX_STATES 64
+#endif
+
+// Deeper frames are cut off from profiler samples.
+#if !defined(SLW_PROFILER_MAX_DEPTH)
+    #define SLW_PROFILER_MAX_DEPTH 64
+#endif
+
+// Wraps C functions registered through `slwState_setcfunction`, `slwState_setcclosure` and `slwTable_setcfunction`
+// to record call counts and latencies, see `slwCStats_enable`. When it's 0, nothing is wrapped.
+#if !defined(SLW_ENABLE_CSTATS)
+    #define SLW_ENABLE_CSTATS 0
+#endif
+
+// Latency histogram size, 4 buckets for every power of two nanoseconds.
+#define SLW_CSTATS_BUCKETS 252
+
 #if defined(NDEBUG) && !defined(_DEBUG)
     #define SLW_RELEASE
 #else
@@ -89,6 +155,9 @@ typedef struct slwTable slwTable;
 
 #define SLW_INTERNAL static
 
+// Used for the wrappers defined in this header, every translation unit gets its own inlinable copy.
+#define SLW_HEADER_INLINE static SLW_INLINE
+
 #if !defined(slw_malloc)
 #define slw_malloc(sz) malloc(sz)
 #endif
@@ -123,6 +192,12 @@ typedef struct slwTable slwTable;
     #endif
 #endif
 
+// Lua 5.1/LuaJIT integers are `ptrdiff_t`
+#if !defined(LUA_MAXINTEGER)
+    #define LUA_MAXINTEGER PTRDIFF_MAX
+    #define LUA_MININTEGER PTRDIFF_MIN
+#endif
+
 #if LUA_VERSION_NUM >= 504 && defined(LUA_COMPAT_BITLIB)
     #define __cslw_bit32_manual 1
 #else
@@ -157,17 +232,70 @@ typedef struct slwTable slwTable;
                     slw_lib_coroutine | slw_lib_os    | slw_lib_utf8   | slw_lib_bit32 | \
                     slw_lib_jit       | slw_lib_ffi
 
+// cslw's own libraries, `slw_lib_all` is only the standard ones.
+#define slw_lib_msgpack     1 << 12
+#define slw_lib_json        1 << 13
+#define slw_lib_cslw        1 << 14
+
+// Not a library: the requested ones besides `base`, `package`, `string` and `jit` are opened on first access,
+// see `slwState_openlibraries`.
+#define slw_lib_lazy        1 << 15
+
+// Types of `slwClassField`s, the C type of the struct member is in the comment.
+#define slw_field_string      1 // const char*, read-only from Lua
+#define slw_field_number      2 // double
+#define slw_field_float       3 // float
+#define slw_field_int         4 // int32_t
+#define slw_field_int64       5 // int64_t
+#define slw_field_bool        6 // bool
+#define slw_field_lightudata  7 // void*
+
+// Field names have to be short strings for Lua, those are interned and the field lookup compares their addresses.
+#define SLW_CLASS_MAX_FIELD_NAME 40
+
 // Structures
 //------------------------------------------------------------------------
+typedef struct slwBudget
+{
+    uint64_t maxInstructions; // 0 = unlimited
+    uint64_t timeoutUs;       // 0 = no deadline
+
+    // Runtime data, reset on every budgeted call
+    uint64_t instructions;
+    uint64_t deadline;
+    bool active;
+    bool exceeded;
+} slwBudget;
+
 typedef struct slwState
 {
     lua_State* LState;
+    slwBudget budget;
+    slwProfiler* profiler;
+    // Always here so the layout doesn't depend on `SLW_ENABLE_CSTATS`, only the wrapping does
+    slwCStats* cstats;
+    bool cstatsEnabled;
 } slwState;
 
+struct slwCStats
+{
+    const char* name;
+    lua_CFunction fn;
+    uint64_t calls;   // Calls that raised an error aren't counted
+    uint64_t totalNs;
+    uint64_t maxNs;
+    uint64_t histogram[SLW_CSTATS_BUCKETS];
+    slwCStats* next;
+};
+
+// `slwTableValue.ltype` of integers, held in `slwValue.l`. It's not a Lua type, `lua_type` says LUA_TNUMBER for both.
+#define slw_tinteger 16
+
 typedef union slwValue
 {
     const char* s;
     double d;
+    int64_t l;
     int i;
     bool b;
     slwTable* t;
@@ -175,12 +303,79 @@ typedef union slwValue
     lua_CFunction f;
 } slwValue;
 
+// A Lua string with its length, for strings that can contain zeros.
+typedef struct slwString
+{
+    const char* str;
+    size_t len;
+} slwString;
+
+// Growable byte buffer, reusing one keeps its capacity so steady traffic stops reallocating.
+// Start it zeroed and free it with `slwBuffer_free`.
+typedef struct slwBuffer
+{
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+} slwBuffer;
+
 typedef struct slwReturnValue
 {
     slwValue value;
     bool exists;
+    uint8_t ltype; // Like `slwTableValue`, `slw_tinteger` for `value.l` and `LUA_TNIL` if it doesn't exist
 } slwReturnValue;
 
+// Class Stuff
+typedef struct slwClassMethod
+{
+    const char* name;
+    lua_CFunction fn;
+} slwClassMethod;
+
+// `get` is called with (self, key) and pushes the value, `set` with (self, key, value), either can be NULL.
+typedef struct slwClassProperty
+{
+    const char* name;
+    lua_CFunction get;
+    lua_CFunction set;
+} slwClassProperty;
+
+// A struct member read and written in place by `__index`/`__newindex`, declare them with `slw_field`/`slw_field_ro`.
+typedef struct slwClassField
+{
+    const char* name;
+    uint8_t type;
+    bool readonly;
+    size_t offset;
+    size_t size;
+} slwClassField;
+
+/**
+ * Example:
+ * ```
+ * const slwClassField Vec2Fields[] = {
+ *     slw_field(Vec2, x, slw_field_number),
+ *     slw_field_ro(Vec2, id, slw_field_int),
+ *     slw_field_end
+ * };
+ * ```
+ */
+#define slw_field(T, member, ftype)    { #member, ftype, false, offsetof(T, member), sizeof(((T*)0)->member) }
+#define slw_field_ro(T, member, ftype) { #member, ftype, true,  offsetof(T, member), sizeof(((T*)0)->member) }
+#define slw_field_end                  { NULL, 0, false, 0, 0 }
+
+struct slwClass
+{
+    const char* name;
+    size_t size;
+    const slwClassMethod* methods;      // Ends with {NULL, NULL}, can be NULL
+    const slwClassProperty* properties; // Ends with {NULL, NULL, NULL}, can be NULL
+    const slwClassField* fields;        // Ends with `slw_field_end`, can be NULL
+    void (*gc)(void* self);             // `__gc`, not called for objects that were closed already
+    void (*close)(void* self);          // `__close`
+};
+
 // Table Stuff
 struct slwTableValue
 {
@@ -193,8 +388,38 @@ struct slwTable
 {
     slwTableValue* elements;
     size_t size;
+    struct _slwTableBinding* binding; // Set by `slwTable_bind`, NULL otherwise
 };
 
+// How many elements a `slwCompactTable` holds before it allocates.
+#if !defined(SLW_COMPACT_INLINE)
+    #define SLW_COMPACT_INLINE 8
+#endif
+
+// A `slwTable` stored as separate arrays (key hashes, names, types, values), so a key lookup only walks the dense
+// hash array. Up to `SLW_COMPACT_INLINE` elements live inside the struct, bigger tables use one heap block.
+// Initialize with `slwCompactTable_init`, read the arrays through `slwCompactTable_hashes` and friends.
+typedef struct slwCompactTable
+{
+    size_t size;
+    size_t capacity;
+    void* block; // NULL while the inline arrays are used
+    uint32_t inlineHashes[SLW_COMPACT_INLINE];
+    const char* inlineNames[SLW_COMPACT_INLINE];
+    slwValue inlineValues[SLW_COMPACT_INLINE];
+    uint8_t inlineTypes[SLW_COMPACT_INLINE];
+} slwCompactTable;
+
+// A read-only view of a table in a `slwTable_serialize` blob, read in place. It owns nothing unless it came from
+// `slwTableView_open`, so it can be copied freely.
+typedef struct slwTableView
+{
+    const uint8_t* data; // The whole blob
+    size_t size;
+    size_t table;        // Offset of the viewed table
+    bool mapped;
+} slwTableView;
+
 // Functions
 //------------------------------------------------------------------------
 // TODO: Maybe all stack functions should be: `slwStack_xxx`
@@ -210,7 +435,13 @@ SLW_API void slwState_destroy(slwState* slw);
 SLW_API void slwState_close(slwState* slw);
 
 /**
- * Opens libraries for the `slwState`
+ * Opens libraries for the `slwState`, `slw_lib_msgpack` opens `msgpack` (see `slwMsgpack_openlib`), `slw_lib_json`
+ * opens `json` (see `slwJson_openlib`) and `slw_lib_cslw` opens `cslw` (see `slwTablelib_openlib`).
+ * 
+ * With `slw_lib_lazy` the other libraries are only opened when a global lookup or `require` first asks for them,
+ * then set as globals so later accesses don't go through the `__index` this puts on `_G`'s metatable. It's removed
+ * once they're all open, a metatable you set on `_G` before that leaves the rest only reachable by `require`.
+ * Snapshots open the ones still waiting.
  * 
  * Example:
  * `slwState_openlibraries(slw, slw_lib_package | slw_lib_os)`
@@ -246,6 +477,25 @@ SLW_NODISCARD SLW_API bool slwState_call_fn_at(slwState* slw, const size_t idx,
  */
 SLW_NODISCARD SLW_API bool slwState_call_fn(slwState* slw, const char* name, ...);
 
+/**
+ * Sets an execution budget for every following `slwState_runstring`, `slwState_runfile` and `slwState_call_fn_at` call.
+ * Each call gets `maxInstructions` VM instructions and `timeoutUs` microseconds of wall-clock time, 0 means unlimited.
+ * When a budget runs out, the script is aborted with `SLW_BUDGET_ERROR` and the call returns false.
+ *
+ * Example: `slwState_setbudget(slw, 1000000, 50 * 1000)`
+ */
+SLW_API void slwState_setbudget(slwState* slw, const uint64_t maxInstructions, const uint64_t timeoutUs);
+
+/**
+ * Removes the budget, calls will run without any hook again.
+ */
+SLW_API void slwState_clearbudget(slwState* slw);
+
+/**
+ * Returns true if the last budgeted call was aborted because it ran out of budget.
+ */
+SLW_NODISCARD SLW_API bool slwState_budgetexceeded(slwState* slw);
+
 /**
  * Creates an empty `slwState` and an empty Lua State
  */
@@ -261,14 +511,74 @@ SLW_NODISCARD SLW_API slwState* slwState_new_with(const uint32_t libs);
 
 /**
  * Returns a `slwState` from another `slwState`
+ * 
+ * Both wrap the same Lua State, see `slwState_clone` for a copy.
  */
 SLW_NODISCARD SLW_API slwState* slwState_new_from_slws(slwState* slw);
 
+/**
+ * Creates a new state with the same standard libraries as `slw` and deep-copies the globals and `package.loaded` of `slw` into it.
+ * Tables keep their shared structure (and cycles) and metatables, Lua functions are copied with `lua_dump`/`lua_load`
+ * and get their upvalues copied (upvalues shared between closures stay shared), C functions keep their pointer.
+ * Functions wrapped by `slwCStats_enable` are counted in records of the new state (unwrapped if `slw` has stats off by now).
+ * Additions to the standard library tables are copied, the libraries themselves are the new state's own.
+ * 
+ * Returns NULL if something reachable can't be copied: full userdata, threads, or C closures nested too deep.
+ * Registry-only data (references, class metatables, budgets, ...) isn't copied.
+ */
+SLW_NODISCARD SLW_API slwState* slwState_clone(slwState* slw);
+
+/**
+ * Writes the globals and `package.loaded` of `slw` to a binary file at `path`, for `slwState_restore` to load.
+ * Tables and strings are written once however often they're referenced (cycles too), tables with their metatables,
+ * Lua functions as bytecode with their upvalues. The standard libraries with their C functions and sentinels
+ * (`json.null`), and C functions set as globals, are written by name; other C functions, userdata and threads make
+ * the snapshot fail.
+ * 
+ * Returns false on failiure and pushes an error message.
+ */
+SLW_NODISCARD SLW_API bool slwState_snapshot(slwState* slw, const char* path);
+
+/**
+ * Loads a file written by `slwState_snapshot` into the globals and `package.loaded` of `slw`, in one pass over the
+ * memory-mapped file. `slw` has to have the libraries and C function globals the snapshotted state had, the ones
+ * the snapshot uses are looked up by name. Only restore files you wrote, the bytecode in them isn't verified.
+ * 
+ * Returns false on failiure and pushes an error message, the globals may be partially restored then.
+ */
+SLW_NODISCARD SLW_API bool slwState_restore(slwState* slw, const char* path);
+
 /**
  * Returns a `slwState` from a Lua State
+ * 
+ * This allocates a new `slwState`, C functions called from Lua should use `slwState_view` instead.
  */
 SLW_NODISCARD SLW_API slwState* slwState_new_from_luas(lua_State* L);
 
+/**
+ * Returns a `slwState` for `L` by value, nothing is allocated and there's nothing to free.
+ * Meant for C functions called from Lua, `L` can be a coroutine.
+ * 
+ * Example:
+ * `slwState slw = slwState_view(L);`
+ * 
+ * Budget, profiler and cstats belong to the owning state (`slwState_owner`), don't close or destroy a view.
+ */
+SLW_NODISCARD SLW_HEADER_INLINE slwState
+slwState_view(lua_State* L)
+{
+    SLW_ASSERT(L != NULL);
+    slwState slw = {0};
+    slw.LState = L;
+    return slw;
+}
+
+/**
+ * Returns the `slwState` that created `L` (or the state `L` is a coroutine of) without allocating,
+ * NULL if `L` wasn't created by `slwState_new_empty`/`slwState_new_with`.
+ */
+SLW_NODISCARD SLW_API slwState* slwState_owner(lua_State* L);
+
 #if defined(SLW_GENERICS_SUPPORT)
 #define slwState_new(x) _Generic((x),   \
     default:    slwState_new_empty,     \
@@ -281,44 +591,713 @@ SLW_NODISCARD SLW_API slwState* slwState_new_from_luas(lua_State* L);
 )(x)
 #endif
 
+// Profiler Functions
+//------------------------------------------------------------------------
+/**
+ * Starts sampling the Lua call stack `hz` times per second while Lua code runs, samples are aggregated until
+ * `slwProfiler_reset`. The rate is in wall-clock time, except with `SLW_PROFILER_USE_SIGNAL` outside of Linux where
+ * `ITIMER_PROF` counts the CPU time of the process. Only Lua code is sampled, time spent inside of C functions isn't
+ * counted.
+ * Coroutines are followed while they run through `coroutine.resume` or `coroutine.wrap` (both are swapped for
+ * wrappers until `slwProfiler_stop`), their samples only hold the coroutine's frames. Coroutines resumed from C with
+ * `lua_resume` aren't sampled.
+ * With `SLW_PROFILER_USE_SIGNAL` the SIGPROF timer is process wide, so the last call decides the rate for every state,
+ * and the cost between samples is nothing. Without it a count hook is installed, on Lua 5.4 that makes the VM trace
+ * every instruction: tight loops ran 2-3x slower in testing, whatever the rate.
+ * A profiled state has to be stopped before it's destroyed, `slwState_close` does it (a `lua_State` closed with
+ * `lua_close` has to call `slwProfiler_stop` first). Once it returns the signal handler no longer touches the state.
+ */
+SLW_API bool slwProfiler_start(slwState* slw, const uint32_t hz);
+
+/**
+ * Stops sampling, the collected samples are kept.
+ */
+SLW_API void slwProfiler_stop(slwState* slw);
+
+/**
+ * Throws away every collected sample.
+ */
+SLW_API void slwProfiler_reset(slwState* slw);
+
+/**
+ * Returns the amount of samples taken since the last reset.
+ */
+SLW_NODISCARD SLW_API uint64_t slwProfiler_samples(slwState* slw);
+
+/**
+ * Writes the samples in folded-stack format (`frame;frame;frame count`), ready for flamegraph.pl.
+ */
+SLW_API bool slwProfiler_dump(slwState* slw, FILE* file);
+
+// C Function Statistics
+//------------------------------------------------------------------------
+/**
+ * Starts (or stops) wrapping C functions that get registered from now on, does nothing without `SLW_ENABLE_CSTATS`.
+ * Functions registered before this call aren't measured.
+ */
+SLW_API void slwCStats_enable(slwState* slw, const bool enable);
+
+/**
+ * Returns the first record, follow `next` for the rest. NULL if nothing was recorded.
+ */
+SLW_NODISCARD SLW_API slwCStats* slwCStats_list(slwState* slw);
+
+/**
+ * Clears all counters, the functions stay wrapped.
+ */
+SLW_API void slwCStats_reset(slwState* slw);
+
+/**
+ * Returns the latency in nanoseconds at percentile `p` (0-100), rounded down to its histogram bucket.
+ */
+SLW_NODISCARD SLW_API uint64_t slwCStats_percentile(const slwCStats* stats, const double p);
+
+/**
+ * Writes a table with calls, total/mean time and percentiles for every wrapped function.
+ */
+SLW_API bool slwCStats_dump(slwState* slw, FILE* file);
+
+// Class Functions
+//------------------------------------------------------------------------
+/**
+ * Registers `cls` in the state, its metatable is kept in the registry under the address of `cls`
+ * so `cls` has to outlive the state. Returns false if it's registered already.
+ * 
+ * Methods, properties, `__gc` and `__close` all get the metatable as their first upvalue, see `slwClass_check`.
+ * The metamethods check their first argument the same way, `__metatable` is the class name.
+ * Fields are looked up through a perfect hash over the addresses of their interned names, built here once per state.
+ */
+SLW_API bool slwClass_register(slwState* slw, const slwClass* cls);
+
+/**
+ * Pushes a new zeroed instance of `cls` as full userdata and returns it, NULL (and nothing pushed) if `cls` isn't registered.
+ */
+SLW_NODISCARD SLW_API void* slwClass_new(slwState* slw, const slwClass* cls);
+
+/**
+ * Returns the instance at `idx`, raises a Lua error if it's not an instance of the class.
+ * Only for methods and properties of a class, it compares the metatable against the first upvalue
+ * instead of looking the type up by name like `luaL_checkudata`.
+ */
+SLW_NODISCARD SLW_API void* slwClass_check(slwState* slw, const int idx);
+
+/**
+ * Returns the instance of `cls` at `idx` or NULL, works from any C function.
+ */
+SLW_NODISCARD SLW_API void* slwClass_test(slwState* slw, const int idx, const slwClass* cls);
+
+// Store Functions
+//------------------------------------------------------------------------
+/**
+ * Builds an immutable, hash-indexed copy of `slt` (strings included) in one allocation, with a reference count of 1.
+ * A store never changes after this, so any number of states on any number of threads can read it without locks,
+ * as long as it's handed to the other threads through something that synchronizes (creating the thread, a mutex, ...).
+ */
+SLW_NODISCARD SLW_API slwStore* slwStore_create(const slwTable* slt);
+
+/**
+ * Adds a reference to `store` and returns it, thread-safe.
+ */
+SLW_API slwStore* slwStore_retain(slwStore* store);
+
+/**
+ * Drops a reference to `store`, it's freed with the last one. Thread-safe.
+ */
+SLW_API void slwStore_release(slwStore* store);
+
+/**
+ * Pushes a read-only view of `store`, nested tables are views too. Every view holds a reference
+ * until it's collected, so the creator can release its own reference once the store is mounted.
+ */
+SLW_API void slwStore_push(slwState* slw, slwStore* store);
+
+/**
+ * Sets the global `name` to a read-only view of `store`, see `slwStore_push`.
+ */
+SLW_API void slwState_setstore(slwState* slw, const char* name, slwStore* store);
+
+// Serialization Functions
+//------------------------------------------------------------------------
+/**
+ * Encodes `slt` (nested tables and strings included) into one `slw_malloc`ed blob and sets `size` to its size.
+ * Every reference in it is an offset from its start, so it can be written to a file and memory-mapped by other
+ * processes. Free it with `slw_free`. Returns NULL if `slt` has C functions or light userdata, or is bigger than 4GB.
+ */
+SLW_NODISCARD SLW_API void* slwTable_serialize(const slwTable* slt, size_t* size);
+
+/**
+ * Builds a `slwTable` from a `slwTable_serialize` blob, names and strings point into `data` so it has to outlive
+ * the table. The tables are one allocation, `slwTable_free` on the result frees all of them (don't free the
+ * nested ones). Returns NULL for a malformed blob.
+ */
+SLW_NODISCARD SLW_API slwTable* slwTable_deserialize(const void* data, size_t size);
+
+/**
+ * Views the root table of a `slwTable_serialize` blob without copying or allocating anything, `data` has to be
+ * 8-byte aligned and outlive the view. Returns false if it isn't a blob.
+ * Every access is bounds checked, a corrupt blob gives failed reads instead of bad memory accesses.
+ */
+SLW_NODISCARD SLW_API bool slwTableView_init(slwTableView* view, const void* data, size_t size);
+
+/**
+ * Memory-maps the blob written to `path` and views its root table, close it with `slwTableView_close`.
+ */
+SLW_NODISCARD SLW_API bool slwTableView_open(slwTableView* view, const char* path);
+
+/**
+ * Unmaps a view from `slwTableView_open`, views of its nested tables can't be used after this.
+ */
+SLW_API void slwTableView_close(slwTableView* view);
+
+SLW_NODISCARD SLW_API size_t slwTableView_size(const slwTableView* view);
+
+/**
+ * Reads element `i` (0-based) into `out`, the name and strings point into the blob.
+ * A nested table is `LUA_TTABLE` with its address in `value.u`, see `slwTableView_table`.
+ */
+SLW_NODISCARD SLW_API bool slwTableView_at(const slwTableView* view, const size_t i, slwTableValue* out);
+
+/**
+ * Reads the value of `key` into `out` like `slwTableView_at`, through the blob's hash index.
+ */
+SLW_NODISCARD SLW_API bool slwTableView_get(const slwTableView* view, const char* key, slwTableValue* out);
+
+/**
+ * Views the nested table `val` (read from `view`).
+ */
+SLW_NODISCARD SLW_API bool slwTableView_table(const slwTableView* view, const slwTableValue* val, slwTableView* out);
+
+// MessagePack Functions
+//------------------------------------------------------------------------
+/**
+ * Appends the value at `idx` to `out` as MessagePack, straight from the Lua value. Tables with keys 1..n (and no
+ * others) are arrays, other tables are maps, empty tables are empty arrays. Integers stay integers, strings are
+ * MessagePack strings. Returns false (`out` is left as it was) for functions, userdata, threads and tables nested
+ * deeper than `SLW_RECURSION_DEPTH`.
+ */
+SLW_NODISCARD SLW_API bool slwMsgpack_encode(slwState* slw, const int idx, slwBuffer* out);
+
+/**
+ * Pushes the first MessagePack value in `data` and returns how many bytes it took, so a stream of values can be
+ * read one after the other. Tables are created at their final size. Binary values become strings, extension
+ * values aren't supported. Returns 0 (nothing pushed) for malformed or incomplete input.
+ */
+SLW_NODISCARD SLW_API size_t slwMsgpack_decode(slwState* slw, const void* data, const size_t size);
+
+/**
+ * The `msgpack` library, for `slwState_openlib` or `slw_lib_msgpack`:
+ * `msgpack.encode(value)` returns a string, `msgpack.decode(str [, pos])` returns the value at `pos` (1 by default)
+ * and the position after it.
+ */
+SLW_API int slwMsgpack_openlib(lua_State* L);
+
+/**
+ * Frees what `buf` holds and zeroes it.
+ */
+SLW_HEADER_INLINE void
+slwBuffer_free(slwBuffer* buf)
+{
+    slw_free(buf->data);
+    buf->data = NULL;
+    buf->size = 0;
+    buf->capacity = 0;
+}
+
+// JSON Functions
+//------------------------------------------------------------------------
+/**
+ * Appends the value at `idx` to `out` as JSON, straight from the Lua value. Tables with keys 1..n (and no others) are
+ * arrays, other tables are objects (number keys are written as strings), empty tables are empty arrays. nil and
+ * `json.null` are `null`. Returns false (`out` is left as it was) for NaN, infinity, functions, userdata, threads,
+ * keys that aren't strings or numbers and tables nested deeper than `SLW_RECURSION_DEPTH`.
+ */
+SLW_NODISCARD SLW_API bool slwJson_encode(slwState* slw, const int idx, slwBuffer* out);
+
+/**
+ * Pushes the JSON document in `data`. Tables are created at their final size, `null` is `json.null` (a NULL light
+ * userdata). Returns false and pushes an error message for malformed input.
+ */
+SLW_NODISCARD SLW_API bool slwJson_decode(slwState* slw, const void* data, const size_t size);
+
+/**
+ * Creates a decoder for documents that arrive in pieces, none of them have to be kept after `slwJsonDecoder_feed`.
+ * Only what's needed for the values that are still open is held by the decoder.
+ */
+SLW_NODISCARD SLW_API slwJsonDecoder* slwJsonDecoder_create(slwState* slw);
+
+/**
+ * Reads the next piece of the document, pieces can be split anywhere. Returns false for malformed input, the error
+ * is reported (and the decoder reset) by `slwJsonDecoder_finish`.
+ */
+SLW_API bool slwJsonDecoder_feed(slwJsonDecoder* dec, const void* data, const size_t size);
+
+/**
+ * Ends the document, pushes it and returns true, or pushes an error message and returns false. The decoder can then
+ * read the next document.
+ */
+SLW_NODISCARD SLW_API bool slwJsonDecoder_finish(slwJsonDecoder* dec);
+
+/**
+ * Returns the error message once `slwJsonDecoder_feed` failed, NULL otherwise.
+ */
+SLW_NODISCARD SLW_API const char* slwJsonDecoder_error(const slwJsonDecoder* dec);
+
+SLW_API void slwJsonDecoder_destroy(slwJsonDecoder* dec);
+
+/**
+ * The `json` library, for `slwState_openlib` or `slw_lib_json`:
+ * `json.encode(value)` returns a string, `json.decode(str)` returns the value, `json.decoder()` returns an object
+ * with `feed(str)` and `finish()` for documents that arrive in pieces, `json.null` is `null`.
+ */
+SLW_API int slwJson_openlib(lua_State* L);
+
+// Table Library Functions
+//------------------------------------------------------------------------
+/**
+ * The `cslw` library, for `slwState_openlib` or `slw_lib_cslw`, table helpers that skip metamethods:
+ * `cslw.new(narr, nrec)` creates a presized table, `cslw.clear(t)` removes every key but keeps the memory,
+ * `cslw.copy(src, f, e, t [, dst])` works like `table.move` and `cslw.fill(t, value [, i [, j]])` sets `t[i..j]`.
+ * `table.new` and `table.clear` are added too when the `table` library is open and doesn't have them.
+ */
+SLW_API int slwTablelib_openlib(lua_State* L);
+
+// Event Functions
+//------------------------------------------------------------------------
+/**
+ * Binds the function at `idx` as an event handler. Events are passed to it as tables like `slwTable_push` makes them,
+ * but each handler keeps its argument tables and refills them in place (without metamethods), so dispatching makes
+ * no new tables. Events with the same keys as the last one only overwrite values, other keys are cleared first.
+ * The handler must not keep the table it gets after it returns, it's the next event's table (nested tables are
+ * still new ones). `slw` has to outlive the handler, returns NULL if there's no function at `idx`.
+ */
+SLW_NODISCARD SLW_API slwEventHandler* slwEvent_bind(slwState* slw, const int idx);
+
+/**
+ * Calls the handler with `event`, returns false and pushes the error message if it raised one.
+ */
+SLW_NODISCARD SLW_API bool slwEvent_dispatch(slwEventHandler* handler, const slwTable* event);
+
+/**
+ * Calls the handler once for each of the `count` events, in order, and returns how many were delivered. It stops at
+ * the first error and pushes its message (returning less than `count`).
+ */
+SLW_NODISCARD SLW_API size_t slwEvent_dispatchmany(slwEventHandler* handler, const slwTable* events, const size_t count);
+
+SLW_API void slwEvent_unbind(slwEventHandler* handler);
+
+// Path Functions
+//------------------------------------------------------------------------
+/**
+ * Compiles a dotted path of global keys ("cfg.net.timeout"), returns NULL for empty keys. The keys are interned once
+ * and the table holding the last one is cached, so reads and writes are a couple of raw accesses instead of a walk
+ * (every access is raw, metamethods are skipped).
+ * The cache is checked against the state's path epoch, which cslw bumps after running Lua (`slwState_runstring`,
+ * `slwState_call_fn_at`, ...) and writing globals (`slwState_settable`, `slwState_setmany`, ...). The table holding the
+ * cached one is checked on every access too, so `a.b = {}` from Lua is picked up even in a C function it calls.
+ * Every `slwState_set*` bumps it too. After replacing tables further up through the Lua API directly, call
+ * `slwPath_invalidate`. The path belongs to the state and has to be freed before it's closed.
+ */
+SLW_NODISCARD SLW_API slwPath* slwPath_compile(slwState* slw, const char* str);
+
+/**
+ * Pushes the value at `path` (nil if a table along it is missing), returns false if it's nil.
+ */
+SLW_API bool slwPath_push(slwPath* path);
+
+/**
+ * Sets the value at `path` (`slwt_tnil` removes it), missing tables along it are created like `slwState_settable2`
+ * does. Returns false if something along the path isn't a table.
+ */
+SLW_API bool slwPath_set(slwPath* path, slwTableValue val);
+
+/**
+ * Typed reads that leave the stack as it was, the fallback (or NULL) is returned for a missing value or another type.
+ * The string is only valid while the table still holds it.
+ */
+SLW_NODISCARD SLW_API double slwPath_getnumber(slwPath* path, double fallback);
+SLW_NODISCARD SLW_API bool slwPath_getbool(slwPath* path, bool fallback);
+SLW_NODISCARD SLW_API const char* slwPath_getstring(slwPath* path);
+
+/**
+ * Makes every path of the state walk again on its next access.
+ */
+SLW_API void slwPath_invalidate(slwState* slw);
+
+SLW_API void slwPath_free(slwPath* path);
+
+// Table Binding Functions
+//------------------------------------------------------------------------
+/**
+ * Pushes `slt` like `slwTable_push` and keeps it bound to the pushed table, nested tables are bound too. From then on
+ * `slwTable_set*` and `slwTable_setval` mark what they change and `slwTable_sync` writes only that (raw) into the
+ * same Lua table. Binding an already bound `slt` syncs it and pushes its table again. A table follows one state,
+ * returns false (nothing bound, but still pushed) if it's bound to another one or there's no memory to track it.
+ * The state has to outlive the binding, see `slwTable_unbind`.
+ */
+SLW_API bool slwTable_bind(slwState* slw, slwTable* slt);
+
+/**
+ * Writes the elements changed since the last sync into the bound table, then syncs the nested tables. Returns false
+ * if `slt` isn't bound.
+ */
+SLW_API bool slwTable_sync(slwTable* slt);
+
+/**
+ * Marks the element at `index` as changed, for elements written straight through `elements`.
+ */
+SLW_API void slwTable_touch(slwTable* slt, const size_t index);
+
+/**
+ * Forgets the Lua table `slt` (and the nested tables bound with it) is bound to, the Lua table itself stays as it is.
+ * `slwTable_free` does this for the freed table alone.
+ */
+SLW_API void slwTable_unbind(slwTable* slt);
+
+// Compact Table Functions
+//------------------------------------------------------------------------
+SLW_HEADER_INLINE void
+slwCompactTable_init(slwCompactTable* sct)
+{
+    sct->size = 0;
+    sct->capacity = SLW_COMPACT_INLINE;
+    sct->block = NULL;
+}
+
+/**
+ * Frees the heap block (if the table grew past the inline arrays), the table is empty and usable afterwards.
+ */
+SLW_API void slwCompactTable_free(slwCompactTable* sct);
+
+// The heap block is laid out as values, names, hashes then types
+SLW_HEADER_INLINE slwValue*
+slwCompactTable_values(const slwCompactTable* sct)
+{
+    return sct->block ? (slwValue*)sct->block : (slwValue*)sct->inlineValues;
+}
+
+SLW_HEADER_INLINE const char**
+slwCompactTable_names(const slwCompactTable* sct)
+{
+    return sct->block ? (const char**)((slwValue*)sct->block + sct->capacity) : (const char**)sct->inlineNames;
+}
+
+SLW_HEADER_INLINE uint32_t*
+slwCompactTable_hashes(const slwCompactTable* sct)
+{
+    return sct->block ? (uint32_t*)(slwCompactTable_names(sct) + sct->capacity) : (uint32_t*)sct->inlineHashes;
+}
+
+SLW_HEADER_INLINE uint8_t*
+slwCompactTable_types(const slwCompactTable* sct)
+{
+    return sct->block ? (uint8_t*)(slwCompactTable_hashes(sct) + sct->capacity) : (uint8_t*)sct->inlineTypes;
+}
+
+/**
+ * Returns the index of `name`, or `SIZE_MAX` if it isn't in the table.
+ */
+SLW_NODISCARD SLW_API size_t slwCompactTable_find(const slwCompactTable* sct, const char* name);
+
+/**
+ * Sets `name` to `val` (`val.name` is ignored), a NULL `name` appends an indexed element. Like `slwTable`, the table
+ * doesn't own names or strings. Returns false if growing failed.
+ */
+SLW_API bool slwCompactTable_set(slwCompactTable* sct, const char* name, slwTableValue val);
+
+/**
+ * Reads the element `name` into `out`, returns false if it isn't in the table.
+ */
+SLW_NODISCARD SLW_API bool slwCompactTable_get(const slwCompactTable* sct, const char* name, slwTableValue* out);
+
+/**
+ * Appends every element of `slt`, returns false if growing failed.
+ */
+SLW_API bool slwCompactTable_append(slwCompactTable* sct, const slwTable* slt);
+
+/**
+ * Pushes the table as a Lua table, the same way `slwTable_push` does.
+ */
+SLW_API void slwCompactTable_push(slwState* slw, const slwCompactTable* sct);
+
+// Channel Functions
+//------------------------------------------------------------------------
+// Channel modes, a single-producer/single-consumer channel skips the compare-and-swap on both ends.
+#define slw_channel_spsc 0
+#define slw_channel_mpmc 1
+
+/**
+ * Creates a bounded lock-free channel for passing values between states (and threads), with a reference count of 1.
+ * `capacity` is rounded up to a power of two. Messages are nil, booleans, integers, numbers, strings and
+ * tables of those, copied into a compact binary form.
+ */
+SLW_NODISCARD SLW_API slwChannel* slwChannel_create(const size_t capacity, const uint32_t mode);
+
+/**
+ * Adds a reference to `ch` and returns it, thread-safe.
+ */
+SLW_API slwChannel* slwChannel_retain(slwChannel* ch);
+
+/**
+ * Drops a reference to `ch`, it's freed (with the messages still in it) with the last one. Thread-safe.
+ */
+SLW_API void slwChannel_release(slwChannel* ch);
+
+/**
+ * Closes `ch`, sends fail from now on and receives fail once it's drained.
+ */
+SLW_API void slwChannel_close(slwChannel* ch);
+
+/**
+ * Sends a copy of the value at `idx`. Returns false if the channel is full or closed, or the value can't be sent.
+ */
+SLW_NODISCARD SLW_API bool slwChannel_trysend(slwState* slw, slwChannel* ch, const int idx);
+
+/**
+ * Same as `slwChannel_trysend`, but blocks the thread while the channel is full.
+ */
+SLW_API bool slwChannel_send(slwState* slw, slwChannel* ch, const int idx);
+
+/**
+ * Pushes the next value and returns true, returns false (nothing pushed) if there's none.
+ */
+SLW_NODISCARD SLW_API bool slwChannel_tryrecv(slwState* slw, slwChannel* ch);
+
+/**
+ * Same as `slwChannel_tryrecv`, but blocks the thread until there's a value. Only returns false once the channel is closed and drained.
+ */
+SLW_API bool slwChannel_recv(slwState* slw, slwChannel* ch);
+
+/**
+ * Pushes `ch` as a Lua object holding a reference, with the methods
+ * `ch:send(v)`, `ch:try_send(v)`, `ch:recv()`, `ch:try_recv()` and `ch:close()`.
+ * 
+ * `recv` returns nil once the channel is closed and drained, `try_recv` returns `true, v` or `false`.
+ * Inside a coroutine `send`/`recv` yield the channel instead of blocking, resume it to try again.
+ * Outside of one they block the thread.
+ */
+SLW_API void slwChannel_push(slwState* slw, slwChannel* ch);
+
 // Stack Functions
 //------------------------------------------------------------------------
-SLW_API void slwStack_pop(slwState* slw, const int32_t n);
-
-SLW_NODISCARD SLW_API bool slwStack_isboolean(slwState* slw, const int32_t idx);
-SLW_NODISCARD SLW_API bool slwStack_iscfunction(slwState* slw, const int32_t idx);
-SLW_NODISCARD SLW_API bool slwStack_isfunction(slwState* slw, const int32_t idx);
-SLW_NODISCARD SLW_API bool slwStack_islightuserdata(slwState* slw, const int32_t idx);
-SLW_NODISCARD SLW_API bool slwStack_isnil(slwState* slw, const int32_t idx);
-SLW_NODISCARD SLW_API bool slwStack_isnone(slwState* slw, const int32_t idx);
-SLW_NODISCARD SLW_API bool slwStack_isnoneornil(slwState* slw, const int32_t idx);
-SLW_NODISCARD SLW_API bool slwStack_isnumber(slwState* slw, const int32_t idx);
-SLW_NODISCARD SLW_API bool slwStack_isstring(slwState* slw, const int32_t idx);
-SLW_NODISCARD SLW_API bool slwStack_istable(slwState* slw, const int32_t idx);
-SLW_NODISCARD SLW_API bool slwStack_isthread(slwState* slw, const int32_t idx);
-SLW_NODISCARD SLW_API bool slwStack_isuserdata(slwState* slw, const int32_t idx);
-
-SLW_NODISCARD SLW_API bool          slwStack_toboolean(slwState* slw, const int32_t idx);
-SLW_NODISCARD SLW_API lua_CFunction slwStack_tocfunction(slwState* slw, const int32_t idx);
-SLW_NODISCARD SLW_API int64_t       slwStack_tointeger(slwState* slw, const int32_t idx);
-SLW_NODISCARD SLW_API const char*   slwStack_tolstring(slwState* slw, const int32_t idx, size_t* len);
-SLW_NODISCARD SLW_API double        slwStack_tonumber(slwState* slw, const int32_t idx);
-SLW_NODISCARD SLW_API const void*   slwStack_topointer(slwState* slw, const int32_t idx);
-SLW_NODISCARD SLW_API const char*   slwStack_tostring(slwState* slw, const int32_t idx);
-SLW_NODISCARD SLW_API void*         slwStack_tothread(slwState* slw, const int32_t idx);
-SLW_NODISCARD SLW_API void*         slwStack_touserdata(slwState* slw, const int32_t idx);
-
-SLW_API void slwStack_setglobal(slwState* slw, const char* name);
+// These are a single Lua call each, they live in the header so they inline into the caller.
+SLW_HEADER_INLINE void
+slwStack_pop(slwState* slw, const int32_t n)
+{
+    SLW_CHECKSTATE(slw);
+    lua_pop(slw->LState, n);
+}
+
+SLW_NODISCARD SLW_HEADER_INLINE bool
+slwStack_isboolean(slwState* slw, const int32_t idx)
+{
+    SLW_CHECKSTATE(slw);
+    return lua_isboolean(slw->LState, idx);
+}
+
+SLW_NODISCARD SLW_HEADER_INLINE bool
+slwStack_iscfunction(slwState* slw, const int32_t idx)
+{
+    SLW_CHECKSTATE(slw);
+    return lua_iscfunction(slw->LState, idx);
+}
+
+SLW_NODISCARD SLW_HEADER_INLINE bool
+slwStack_isfunction(slwState* slw, const int32_t idx)
+{
+    SLW_CHECKSTATE(slw);
+    return lua_isfunction(slw->LState, idx);
+}
+
+SLW_NODISCARD SLW_HEADER_INLINE bool
+slwStack_islightuserdata(slwState* slw, const int32_t idx)
+{
+    SLW_CHECKSTATE(slw);
+    return lua_islightuserdata(slw->LState, idx);
+}
+
+SLW_NODISCARD SLW_HEADER_INLINE bool
+slwStack_isnil(slwState* slw, const int32_t idx)
+{
+    SLW_CHECKSTATE(slw);
+    return lua_isnil(slw->LState, idx);
+}
+
+SLW_NODISCARD SLW_HEADER_INLINE bool
+slwStack_isnone(slwState* slw, const int32_t idx)
+{
+    SLW_CHECKSTATE(slw);
+    return lua_isnone(slw->LState, idx);
+}
+
+SLW_NODISCARD SLW_HEADER_INLINE bool
+slwStack_isnoneornil(slwState* slw, const int32_t idx)
+{
+    SLW_CHECKSTATE(slw);
+    return lua_isnoneornil(slw->LState, idx);
+}
+
+SLW_NODISCARD SLW_HEADER_INLINE bool
+slwStack_isnumber(slwState* slw, const int32_t idx)
+{
+    SLW_CHECKSTATE(slw);
+    return lua_isnumber(slw->LState, idx);
+}
+
+SLW_NODISCARD SLW_HEADER_INLINE bool
+slwStack_isstring(slwState* slw, const int32_t idx)
+{
+    SLW_CHECKSTATE(slw);
+    return lua_isstring(slw->LState, idx);
+}
+
+SLW_NODISCARD SLW_HEADER_INLINE bool
+slwStack_istable(slwState* slw, const int32_t idx)
+{
+    SLW_CHECKSTATE(slw);
+    return lua_istable(slw->LState, idx);
+}
+
+SLW_NODISCARD SLW_HEADER_INLINE bool
+slwStack_isthread(slwState* slw, const int32_t idx)
+{
+    SLW_CHECKSTATE(slw);
+    return lua_isthread(slw->LState, idx);
+}
+
+SLW_NODISCARD SLW_HEADER_INLINE bool
+slwStack_isuserdata(slwState* slw, const int32_t idx)
+{
+    SLW_CHECKSTATE(slw);
+    return lua_isuserdata(slw->LState, idx);
+}
+
+SLW_NODISCARD SLW_HEADER_INLINE bool
+slwStack_toboolean(slwState* slw, const int32_t idx)
+{
+    SLW_CHECKSTATE(slw);
+    return lua_toboolean(slw->LState, idx);
+}
+
+SLW_NODISCARD SLW_HEADER_INLINE lua_CFunction
+slwStack_tocfunction(slwState* slw, const int32_t idx)
+{
+    SLW_CHECKSTATE(slw);
+    return lua_tocfunction(slw->LState, idx);
+}
+
+SLW_NODISCARD SLW_HEADER_INLINE int64_t
+slwStack_tointeger(slwState* slw, const int32_t idx)
+{
+    SLW_CHECKSTATE(slw);
+    return lua_tointeger(slw->LState, idx);
+}
+
+SLW_NODISCARD SLW_HEADER_INLINE const char*
+slwStack_tolstring(slwState* slw, const int32_t idx, size_t* len)
+{
+    SLW_CHECKSTATE(slw);
+    return lua_tolstring(slw->LState, idx, len);
+}
+
+SLW_NODISCARD SLW_HEADER_INLINE double
+slwStack_tonumber(slwState* slw, const int32_t idx)
+{
+    SLW_CHECKSTATE(slw);
+    return lua_tonumber(slw->LState, idx);
+}
+
+SLW_NODISCARD SLW_HEADER_INLINE const void*
+slwStack_topointer(slwState* slw, const int32_t idx)
+{
+    SLW_CHECKSTATE(slw);
+    return lua_topointer(slw->LState, idx);
+}
+
+SLW_NODISCARD SLW_HEADER_INLINE const char*
+slwStack_tostring(slwState* slw, const int32_t idx)
+{
+    SLW_CHECKSTATE(slw);
+    return lua_tostring(slw->LState, idx);
+}
+
+SLW_NODISCARD SLW_HEADER_INLINE void*
+slwStack_tothread(slwState* slw, const int32_t idx)
+{
+    SLW_CHECKSTATE(slw);
+    return lua_tothread(slw->LState, idx);
+}
+
+SLW_NODISCARD SLW_HEADER_INLINE void*
+slwStack_touserdata(slwState* slw, const int32_t idx)
+{
+    SLW_CHECKSTATE(slw);
+    return lua_touserdata(slw->LState, idx);
+}
+
+SLW_HEADER_INLINE void
+slwStack_setglobal(slwState* slw, const char* name)
+{
+    SLW_CHECKSTATE(slw);
+    lua_setglobal(slw->LState, name);
+}
 
 SLW_API const char* slwStack_pushfstring(slwState* slw, const char* fmt, ...);
-SLW_API void slwStack_pushstring(slwState* slw, const char* str);
-SLW_API void slwStack_pushnumber(slwState* slw, double num);
-SLW_API void slwStack_pushint(slwState* slw, int64_t num);
-SLW_API void slwStack_pushboolean(slwState* slw, bool b);
-SLW_API void slwStack_pushcfunction(slwState* lwState, lua_CFunction fn);
-SLW_API void slwStack_pushlightudata(slwState* lwState, void* data);
-SLW_API void slwStack_pushcclosure(slwState* lwState, lua_CFunction fn, int n);
-SLW_API void slwStack_pushnil(slwState* slw);
+
+SLW_HEADER_INLINE void
+slwStack_pushstring(slwState* slw, const char* str)
+{
+    SLW_CHECKSTATE(slw);
+    lua_pushstring(slw->LState, str);
+}
+
+SLW_HEADER_INLINE void
+slwStack_pushnumber(slwState* slw, double num)
+{
+    SLW_CHECKSTATE(slw);
+    lua_pushnumber(slw->LState, num);
+}
+
+SLW_HEADER_INLINE void
+slwStack_pushint(slwState* slw, int64_t num)
+{
+    SLW_CHECKSTATE(slw);
+    lua_pushinteger(slw->LState, num);
+}
+
+SLW_HEADER_INLINE void
+slwStack_pushboolean(slwState* slw, bool b)
+{
+    SLW_CHECKSTATE(slw);
+    lua_pushboolean(slw->LState, b);
+}
+
+SLW_HEADER_INLINE void
+slwStack_pushcfunction(slwState* slw, lua_CFunction fn)
+{
+    SLW_CHECKSTATE(slw);
+    lua_pushcfunction(slw->LState, fn);
+}
+
+SLW_HEADER_INLINE void
+slwStack_pushlightudata(slwState* slw, void* data)
+{
+    SLW_CHECKSTATE(slw);
+    lua_pushlightuserdata(slw->LState, data);
+}
+
+SLW_HEADER_INLINE void
+slwStack_pushcclosure(slwState* slw, lua_CFunction fn, int n)
+{
+    SLW_CHECKSTATE(slw);
+    lua_pushcclosure(slw->LState, fn, n);
+}
+
+SLW_HEADER_INLINE void
+slwStack_pushnil(slwState* slw)
+{
+    SLW_CHECKSTATE(slw);
+    lua_pushnil(slw->LState);
+}
 
 #if defined(SLW_GENERICS_SUPPORT)
     #define slwState_push(s, x) _Generic((x),           \
@@ -337,16 +1316,16 @@ SLW_API void slwStack_pushnil(slwState* slw);
 
 // Set Functions (Globals)
 //------------------------------------------------------------------------
-SLW_API void slwState_setstring(slwState* slw, const char* name, const char* str);
 SLW_API const char* slwState_setfstring(slwState* slw, const char* name, const char* fmt, ...);
-SLW_API void slwState_setnumber(slwState* slw, const char* name, double num);
-SLW_API void slwState_setint(slwState* slw, const char* name, uint64_t num);
-SLW_API void slwState_setbool(slwState* slw, const char* name, bool b);
 SLW_API void slwState_setcfunction(slwState* slw, const char* name, lua_CFunction fn);
-SLW_API void slwState_setlightudata(slwState* slw, const char* name, void* data);
 SLW_API void slwState_setcclosure(slwState* slw, const char* name, lua_CFunction fn, int n);
 SLW_API void slwState_settable(slwState* slw, const char* name, slwTable* slt);
 
+/**
+ * Sets the global `name` to a read-only proxy of `slt`, see `slwTable_pushproxy`.
+ */
+SLW_API void slwState_settableproxy(slwState* slw, const char* name, slwTable* slt);
+
 /**
  * `slwState_settable2`
  * This function is similar to `slwState_settable`, the difference is that it uses variadic arguments for the keys
@@ -355,7 +1334,61 @@ SLW_API void slwState_settable(slwState* slw, const char* name, slwTable* slt);
  * slwState_settable2(slw, "myKey1", "myKey2", "finalKey", slwt_tstring("Hello Sailor!")
  */
 SLW_API void slwState_settable2(slwState* slw, ...);
-SLW_API void slwState_setnil(slwState* slw, const char* name);
+
+SLW_HEADER_INLINE void
+slwState_setstring(slwState* slw, const char* name, const char* str)
+{
+    SLW_CHECKSTATE(slw);
+    lua_pushstring(slw->LState, str);
+    lua_setglobal(slw->LState, name);
+    slwPath_invalidate(slw);
+}
+
+SLW_HEADER_INLINE void
+slwState_setnumber(slwState* slw, const char* name, double num)
+{
+    SLW_CHECKSTATE(slw);
+    lua_pushnumber(slw->LState, num);
+    lua_setglobal(slw->LState, name);
+    slwPath_invalidate(slw);
+}
+
+SLW_HEADER_INLINE void
+slwState_setint(slwState* slw, const char* name, uint64_t num)
+{
+    SLW_CHECKSTATE(slw);
+    lua_pushinteger(slw->LState, num);
+    lua_setglobal(slw->LState, name);
+    slwPath_invalidate(slw);
+}
+
+SLW_HEADER_INLINE void
+slwState_setbool(slwState* slw, const char* name, bool b)
+{
+    SLW_CHECKSTATE(slw);
+    lua_pushboolean(slw->LState, b);
+    lua_setglobal(slw->LState, name);
+    slwPath_invalidate(slw);
+}
+
+SLW_HEADER_INLINE void
+slwState_setlightudata(slwState* slw, const char* name, void* data)
+{
+    SLW_CHECKSTATE(slw);
+    lua_pushlightuserdata(slw->LState, data);
+
+    lua_setglobal(slw->LState, name);
+    slwPath_invalidate(slw);
+}
+
+SLW_HEADER_INLINE void
+slwState_setnil(slwState* slw, const char* name)
+{
+    SLW_CHECKSTATE(slw);
+    lua_pushnil(slw->LState);
+    lua_setglobal(slw->LState, name);
+    slwPath_invalidate(slw);
+}
 
 #if defined(SLW_GENERICS_SUPPORT)
 #define slwState_set(s, x, y) _Generic((y),        \
@@ -374,10 +1407,17 @@ SLW_API void slwState_setnil(slwState* slw, const char* name);
 
 // Get Functions (Globals)
 //------------------------------------------------------------------------
+/**
+ * Numbers are read into `value.l` if they're integers (`lua_isinteger`) and into `value.d` otherwise, `ltype` says
+ * which (`slw_tinteger` or `LUA_TNUMBER`).
+ */
 SLW_NODISCARD SLW_API slwReturnValue slwState_type_to_c(slwState* slw, const int type, const int idx);
 SLW_NODISCARD SLW_API slwReturnValue slwState_get(slwState* slw, const char* name);
 SLW_NODISCARD SLW_API slwReturnValue slwState_getstring(slwState* slw, const char* name);
 SLW_NODISCARD SLW_API slwReturnValue slwState_getnumber(slwState* slw, const char* name);
+/**
+ * The integer is in the 64-bit `value.l`, not `value.i` (an `int`).
+ */
 SLW_NODISCARD SLW_API slwReturnValue slwState_getint(slwState* slw, const char* name);
 SLW_NODISCARD SLW_API slwReturnValue slwState_getbool(slwState* slw, const char* name);
 SLW_NODISCARD SLW_API slwReturnValue slwState_getfunction(slwState* slw, const char* name);
@@ -385,11 +1425,79 @@ SLW_NODISCARD SLW_API slwReturnValue slwState_getcfunction(slwState* lwState, co
 SLW_NODISCARD SLW_API slwReturnValue slwState_getuserdata(slwState* lwState, const char* name);
 SLW_NODISCARD SLW_API slwReturnValue slwState_getnil(slwState* slw, const char* name);
 
+// Batch Functions (Globals)
+//------------------------------------------------------------------------
+/**
+ * Sets the globals `values[i].name` to `values[i]` (`slwt_tnil` removes them), fetching `_G` once and setting them
+ * raw (no `__newindex` on `_G`). Leaves the stack as it was.
+ */
+SLW_API void slwState_setmany(slwState* slw, const slwTableValue* values, const size_t count);
+
+/**
+ * Reads the globals `values[i].name` into `values[i].value`, fetching `_G` once and reading them raw. An `ltype` of
+ * `LUA_TNIL` takes any type (and is set to it), any other `ltype` has to match exactly (numbers aren't converted
+ * from strings). Integers are read as `slw_tinteger` unless `ltype` is `LUA_TNUMBER`, which takes any number. Entries of globals that are missing or of another type are left as they were, so they can hold
+ * defaults. Returns how many were read and leaves the stack as it was, so strings are only valid while the global
+ * still holds them. Tables are read with `slwTable_get_at`, functions with `lua_tocfunction` (NULL for Lua functions).
+ * 
+ * Example:
+ * `slwTableValue vals[] = { slwt_tnumber(1.0), slwt_tstring("unnamed") };`
+ * `vals[0].name = "speed"; vals[1].name = "name";`
+ * `slwState_getmany(slw, vals, 2);`
+ */
+SLW_API size_t slwState_getmany(slwState* slw, slwTableValue* values, const size_t count);
+
+/**
+ * Like `slwState_getnumber` but leaves the stack as it was, returns `fallback` if `name` isn't a number.
+ */
+SLW_HEADER_INLINE double
+slwState_readnumber(slwState* slw, const char* name, double fallback)
+{
+    slwTableValue val = { name, LUA_TNUMBER, { .d = fallback } };
+    (void)slwState_getmany(slw, &val, 1);
+    return val.value.d;
+}
+
+/**
+ * Like `slwState_getint` but leaves the stack as it was, returns `fallback` if `name` isn't an integer.
+ */
+SLW_HEADER_INLINE int64_t
+slwState_readint(slwState* slw, const char* name, int64_t fallback)
+{
+    slwTableValue val = { name, slw_tinteger, { .l = fallback } };
+    (void)slwState_getmany(slw, &val, 1);
+    return val.value.l;
+}
+
+/**
+ * Like `slwState_getbool` but leaves the stack as it was, returns `fallback` if `name` isn't a boolean.
+ */
+SLW_HEADER_INLINE bool
+slwState_readbool(slwState* slw, const char* name, bool fallback)
+{
+    slwTableValue val = { name, LUA_TBOOLEAN, { .b = fallback } };
+    (void)slwState_getmany(slw, &val, 1);
+    return val.value.b;
+}
+
+/**
+ * Like `slwState_getstring` but leaves the stack as it was, returns NULL if `name` isn't a string. The string is
+ * only valid while the global still holds it.
+ */
+SLW_HEADER_INLINE const char*
+slwState_readstring(slwState* slw, const char* name)
+{
+    slwTableValue val = { name, LUA_TSTRING, { .s = NULL } };
+    (void)slwState_getmany(slw, &val, 1);
+    return val.value.s;
+}
+
 #define slwt_tlightuserdata(x) ((slwTableValue) {.ltype = LUA_TLIGHTUSERDATA,   .value.u = x})
 #define slwt_tfunction(x)      ((slwTableValue) {.ltype = LUA_TFUNCTION,   .value.f = x})
 #define slwt_tboolean(x)       ((slwTableValue) {.ltype = LUA_TBOOLEAN, .value.b = x})
 #define slwt_tstring(x)        ((slwTableValue) {.ltype = LUA_TSTRING,  .value.s = x})
 #define slwt_tnumber(x)        ((slwTableValue) {.ltype = LUA_TNUMBER,  .value.d = x})
+#define slwt_tinteger(x)       ((slwTableValue) {.ltype = slw_tinteger, .value.l = x})
 #define slwt_ttable(x)         ((slwTableValue) {.ltype = LUA_TTABLE,   .value.t = x})
 #define slwt_tnil              ((slwTableValue) {.ltype = LUA_TNIL})
 
@@ -397,12 +1505,32 @@ SLW_NODISCARD SLW_API slwTable*        slwTable_create();
 SLW_NODISCARD SLW_API slwTable*        slwTable_createkv(slwState* slw, ...);
 SLW_NODISCARD SLW_API slwTable*        slwTable_createi(slwState* slw, ...);
 SLW_API void                           slwTable_free(slwTable* slt);
+/**
+ * Frees `slt` and the tables nested in it, like the ones `slwTable_get_at` makes. `slwTable_free` only frees `slt`,
+ * don't use this one on tables that share nested tables or don't own them.
+ */
+SLW_API void                           slwTable_free_deep(slwTable* slt);
 
 SLW_API void                           slwTable_push(slwState* slw, slwTable* slt);
+
+/**
+ * Pushes a read-only userdata proxy of `slt` instead of copying it into a Lua table, `__index`, `__len` and `__pairs`
+ * read straight from `slt` and nested tables are proxied when they're accessed. A proxy is a few bytes
+ * (plus a small hash index for key-value tables with more than 8 keys) no matter how big `slt` is.
+ * 
+ * The same `slt` gives the same proxy while it's alive. `slt` has to outlive the state, values can be
+ * changed in place but keys can't be added or removed once it's proxied.
+ */
+SLW_API void                           slwTable_pushproxy(slwState* slw, slwTable* slt);
 SLW_NODISCARD SLW_API slwTable*        slwTable_get_at(slwState* slw, const int32_t idx);
-SLW_NODISCARD SLW_API slwTable*        slwTable_get(slwState* slw);
 SLW_NODISCARD SLW_API slwTableValue*   slwTable_getkey(slwTable* slt, const char* key);
 
+SLW_HEADER_INLINE slwTable*
+slwTable_get(slwState* slw)
+{
+    return slwTable_get_at(slw, -1);
+}
+
 /**
  * This is the same as `slwState_settable2`, the difference is that it modifies the table in the Lua State instead of the table structure.
  * You can use this in conjuction with `slwState_settable2`.
@@ -448,4 +1576,279 @@ SLW_API void             slwTable_dump(slwState* slw, slwTable* slt, const char*
  */
 SLW_API void             slwTable_dumpg(slwState* slw, const char* name);
 
-#endif
\ No newline at end of file
+// Binding Functions
+//------------------------------------------------------------------------
+#if defined(SLW_GENERICS_SUPPORT)
+/**
+ * Generates `static int slwBind_<fn>(lua_State* L)`, a `lua_CFunction` that decodes its arguments as the listed C types,
+ * calls `fn` directly and pushes the result. Takes 1 to 8 arguments.
+ * 
+ * Argument types: `bool`, `float`, `double`, every standard integer type (range checked, floats with a fraction
+ * are rejected), `const char*`, `slwString` (keeps the length), `void*` (any userdata or nil) and `slwTable*`
+ * (converted after all other arguments passed their checks, freed after the call).
+ * Return types are the same, a returned `slwTable*` is pushed and freed.
+ * 
+ * Example:
+ * ```
+ * double scale(int64_t n, const char* unit, slwTable* opts);
+ * SLW_BIND(scale, double, (int64_t, const char*, slwTable*))
+ * 
+ * slwState_setcfunction(slw, "scale", slwBind_scale);
+ * ```
+ */
+#define SLW_BIND(fn, ret, args)                                       \
+    static int slwBind_##fn(lua_State* L)                             \
+    {                                                                 \
+        _SLW_BIND_EACH(_SLW_BIND_DECODE, _SLW_BIND_UNPAREN args)      \
+        _SLW_BIND_EACH(_SLW_BIND_FILL, _SLW_BIND_UNPAREN args)        \
+        ret _slw_ret = fn(_SLW_BIND_PARAMS(_SLW_BIND_UNPAREN args));  \
+        _SLW_BIND_EACH(_SLW_BIND_RELEASE, _SLW_BIND_UNPAREN args)     \
+        _slwBind_push(L, _slw_ret);                                   \
+        return 1;                                                     \
+    }
+
+/**
+ * Same as `SLW_BIND` for functions returning `void`, the wrapper returns nothing to Lua.
+ */
+#define SLW_BIND_VOID(fn, args)                                       \
+    static int slwBind_##fn(lua_State* L)                             \
+    {                                                                 \
+        _SLW_BIND_EACH(_SLW_BIND_DECODE, _SLW_BIND_UNPAREN args)      \
+        _SLW_BIND_EACH(_SLW_BIND_FILL, _SLW_BIND_UNPAREN args)        \
+        fn(_SLW_BIND_PARAMS(_SLW_BIND_UNPAREN args));                 \
+        _SLW_BIND_EACH(_SLW_BIND_RELEASE, _SLW_BIND_UNPAREN args)     \
+        return 0;                                                     \
+    }
+
+#define _SLW_BIND_UNPAREN(...) __VA_ARGS__
+#define _SLW_BIND_CAT(a, b) _SLW_BIND_CAT_(a, b)
+#define _SLW_BIND_CAT_(a, b) a##b
+#define _SLW_BIND_NARGS(...) _SLW_BIND_NARGS_(__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define _SLW_BIND_NARGS_(_1, _2, _3, _4, _5, _6, _7, _8, N, ...) N
+
+#define _SLW_BIND_EACH(m, ...) _SLW_BIND_CAT(_SLW_BIND_EACH, _SLW_BIND_NARGS(__VA_ARGS__))(m, __VA_ARGS__)
+#define _SLW_BIND_EACH1(m, a)                      m(1, a)
+#define _SLW_BIND_EACH2(m, a, b)                   _SLW_BIND_EACH1(m, a) m(2, b)
+#define _SLW_BIND_EACH3(m, a, b, c)                _SLW_BIND_EACH2(m, a, b) m(3, c)
+#define _SLW_BIND_EACH4(m, a, b, c, d)             _SLW_BIND_EACH3(m, a, b, c) m(4, d)
+#define _SLW_BIND_EACH5(m, a, b, c, d, e)          _SLW_BIND_EACH4(m, a, b, c, d) m(5, e)
+#define _SLW_BIND_EACH6(m, a, b, c, d, e, f)       _SLW_BIND_EACH5(m, a, b, c, d, e) m(6, f)
+#define _SLW_BIND_EACH7(m, a, b, c, d, e, f, g)    _SLW_BIND_EACH6(m, a, b, c, d, e, f) m(7, g)
+#define _SLW_BIND_EACH8(m, a, b, c, d, e, f, g, h) _SLW_BIND_EACH7(m, a, b, c, d, e, f, g) m(8, h)
+
+#define _SLW_BIND_PARAMS(...) _SLW_BIND_CAT(_SLW_BIND_PARAMS, _SLW_BIND_NARGS(__VA_ARGS__))
+#define _SLW_BIND_PARAMS1 _slw_a1
+#define _SLW_BIND_PARAMS2 _SLW_BIND_PARAMS1, _slw_a2
+#define _SLW_BIND_PARAMS3 _SLW_BIND_PARAMS2, _slw_a3
+#define _SLW_BIND_PARAMS4 _SLW_BIND_PARAMS3, _slw_a4
+#define _SLW_BIND_PARAMS5 _SLW_BIND_PARAMS4, _slw_a5
+#define _SLW_BIND_PARAMS6 _SLW_BIND_PARAMS5, _slw_a6
+#define _SLW_BIND_PARAMS7 _SLW_BIND_PARAMS6, _slw_a7
+#define _SLW_BIND_PARAMS8 _SLW_BIND_PARAMS7, _slw_a8
+
+// Every argument is checked before any `slwTable` is built, so a bad argument can't leak one
+#define _SLW_BIND_DECODE(i, T)  T _slw_a##i = _Generic(*(T*)0,           \
+    bool:               _slwBind_toboolean,                                \
+    float:              _slwBind_tonumber,                                 \
+    double:             _slwBind_tonumber,                                 \
+    signed char:        _slwBind_toschar,                                  \
+    short:              _slwBind_toshort,                                  \
+    int:                _slwBind_toint,                                    \
+    long:               _slwBind_tolong,                                   \
+    long long:          _slwBind_tollong,                                  \
+    unsigned char:      _slwBind_touchar,                                  \
+    unsigned short:     _slwBind_toushort,                                 \
+    unsigned int:       _slwBind_touint,                                   \
+    unsigned long:      _slwBind_toulong,                                  \
+    unsigned long long: _slwBind_toullong,                                 \
+    const char*:        _slwBind_tostring,                                 \
+    slwString:          _slwBind_tolstring,                                \
+    void*:              _slwBind_touserdata,                               \
+    slwTable*:          _slwBind_checktable                                \
+    )(L, i);
+#define _SLW_BIND_FILL(i, T)    _Generic(_slw_a##i, slwTable*: _slwBind_filltable, default: _slwBind_nop)(L, i, (void*)&_slw_a##i);
+#define _SLW_BIND_RELEASE(i, T) _Generic(_slw_a##i, slwTable*: _slwBind_freetable, default: _slwBind_nop)(L, i, (void*)&_slw_a##i);
+
+#define _slwBind_push(L, v) _Generic((v),          \
+    bool:               _slwBind_pushboolean,      \
+    float:              _slwBind_pushnumber,       \
+    double:             _slwBind_pushnumber,       \
+    signed char:        _slwBind_pushinteger,      \
+    short:              _slwBind_pushinteger,      \
+    int:                _slwBind_pushinteger,      \
+    long:               _slwBind_pushinteger,      \
+    long long:          _slwBind_pushinteger,      \
+    unsigned char:      _slwBind_pushinteger,      \
+    unsigned short:     _slwBind_pushinteger,      \
+    unsigned int:       _slwBind_pushinteger,      \
+    unsigned long:      _slwBind_pushinteger,      \
+    unsigned long long: _slwBind_pushinteger,      \
+    const char*:        _slwBind_pushstring,       \
+    char*:              _slwBind_pushstring,       \
+    slwString:          _slwBind_pushlstring,      \
+    void*:              _slwBind_pushlightudata,   \
+    slwTable*:          _slwBind_pushtable         \
+    )(L, v)
+
+SLW_HEADER_INLINE int
+_slwBind_typeerror(lua_State* L, int i, const char* expected)
+{
+    return luaL_argerror(L, i, lua_pushfstring(L, "%s expected, got %s", expected, luaL_typename(L, i)));
+}
+
+SLW_HEADER_INLINE bool
+_slwBind_toboolean(lua_State* L, int i)
+{
+    return lua_toboolean(L, i);
+}
+
+SLW_HEADER_INLINE lua_Number
+_slwBind_tonumber(lua_State* L, int i)
+{
+    int isnum;
+    const lua_Number n = lua_tonumberx(L, i, &isnum);
+    if (!isnum)
+        _slwBind_typeerror(L, i, "number");
+    return n;
+}
+
+// `lua_tointegerx` fails for floats without an exact integer value, unlike `(T)lua_tonumber`
+SLW_HEADER_INLINE lua_Integer
+_slwBind_tointeger(lua_State* L, int i, lua_Integer min, lua_Integer max)
+{
+    int isnum;
+    const lua_Integer n = lua_tointegerx(L, i, &isnum);
+    if (!isnum)
+        _slwBind_typeerror(L, i, lua_isnumber(L, i) ? "integer" : "number");
+    if (n < min || n > max)
+        luaL_argerror(L, i, "integer out of range");
+    return n;
+}
+
+SLW_HEADER_INLINE signed char        _slwBind_toschar(lua_State* L, int i)  { return (signed char)_slwBind_tointeger(L, i, SCHAR_MIN, SCHAR_MAX); }
+SLW_HEADER_INLINE short              _slwBind_toshort(lua_State* L, int i)  { return (short)_slwBind_tointeger(L, i, SHRT_MIN, SHRT_MAX); }
+SLW_HEADER_INLINE int                _slwBind_toint(lua_State* L, int i)    { return (int)_slwBind_tointeger(L, i, INT_MIN, INT_MAX); }
+SLW_HEADER_INLINE long               _slwBind_tolong(lua_State* L, int i)   { return (long)_slwBind_tointeger(L, i, LONG_MIN, LONG_MAX); }
+SLW_HEADER_INLINE long long          _slwBind_tollong(lua_State* L, int i)  { return (long long)_slwBind_tointeger(L, i, LUA_MININTEGER, LUA_MAXINTEGER); }
+SLW_HEADER_INLINE unsigned char      _slwBind_touchar(lua_State* L, int i)  { return (unsigned char)_slwBind_tointeger(L, i, 0, UCHAR_MAX); }
+SLW_HEADER_INLINE unsigned short     _slwBind_toushort(lua_State* L, int i) { return (unsigned short)_slwBind_tointeger(L, i, 0, USHRT_MAX); }
+SLW_HEADER_INLINE unsigned int       _slwBind_touint(lua_State* L, int i)   { return (unsigned int)_slwBind_tointeger(L, i, 0, UINT_MAX); }
+// Lua integers are 64 bit, so the top half of the unsigned 64 bit range isn't reachable
+SLW_HEADER_INLINE unsigned long      _slwBind_toulong(lua_State* L, int i)  { return (unsigned long)_slwBind_tointeger(L, i, 0, (lua_Integer)(ULONG_MAX > LUA_MAXINTEGER ? LUA_MAXINTEGER : ULONG_MAX)); }
+SLW_HEADER_INLINE unsigned long long _slwBind_toullong(lua_State* L, int i) { return (unsigned long long)_slwBind_tointeger(L, i, 0, LUA_MAXINTEGER); }
+
+SLW_HEADER_INLINE const char*
+_slwBind_tostring(lua_State* L, int i)
+{
+    const char* str = lua_tolstring(L, i, NULL);
+    if (!str)
+        _slwBind_typeerror(L, i, "string");
+    return str;
+}
+
+SLW_HEADER_INLINE slwString
+_slwBind_tolstring(lua_State* L, int i)
+{
+    slwString str;
+    str.str = lua_tolstring(L, i, &str.len);
+    if (!str.str)
+        _slwBind_typeerror(L, i, "string");
+    return str;
+}
+
+SLW_HEADER_INLINE void*
+_slwBind_touserdata(lua_State* L, int i)
+{
+    void* p = lua_touserdata(L, i);
+    if (!p && !lua_isnil(L, i))
+        _slwBind_typeerror(L, i, "userdata");
+    return p;
+}
+
+SLW_HEADER_INLINE slwTable*
+_slwBind_checktable(lua_State* L, int i)
+{
+    if (!lua_istable(L, i))
+        _slwBind_typeerror(L, i, "table");
+    return NULL;
+}
+
+SLW_HEADER_INLINE void
+_slwBind_filltable(lua_State* L, int i, void* arg)
+{
+    // `slwTable_get_at` walks the table relative to the top
+    slwState view = slwState_view(L);
+    lua_pushvalue(L, i);
+    *(slwTable**)arg = slwTable_get_at(&view, -1);
+    lua_pop(L, 1);
+}
+
+SLW_HEADER_INLINE void
+_slwBind_freetable(lua_State* L, int i, void* arg)
+{
+    (void)L;
+    (void)i;
+    if (*(slwTable**)arg)
+        slwTable_free_deep(*(slwTable**)arg);
+}
+
+SLW_HEADER_INLINE void
+_slwBind_nop(lua_State* L, int i, void* arg)
+{
+    (void)L;
+    (void)i;
+    (void)arg;
+}
+
+SLW_HEADER_INLINE void
+_slwBind_pushboolean(lua_State* L, bool b)
+{
+    lua_pushboolean(L, b);
+}
+
+SLW_HEADER_INLINE void
+_slwBind_pushnumber(lua_State* L, lua_Number n)
+{
+    lua_pushnumber(L, n);
+}
+
+SLW_HEADER_INLINE void
+_slwBind_pushinteger(lua_State* L, lua_Integer n)
+{
+    lua_pushinteger(L, n);
+}
+
+SLW_HEADER_INLINE void
+_slwBind_pushstring(lua_State* L, const char* str)
+{
+    lua_pushstring(L, str);
+}
+
+SLW_HEADER_INLINE void
+_slwBind_pushlstring(lua_State* L, slwString str)
+{
+    lua_pushlstring(L, str.str, str.len);
+}
+
+SLW_HEADER_INLINE void
+_slwBind_pushlightudata(lua_State* L, void* p)
+{
+    lua_pushlightuserdata(L, p);
+}
+
+SLW_HEADER_INLINE void
+_slwBind_pushtable(lua_State* L, slwTable* slt)
+{
+    if (!slt)
+    {
+        lua_pushnil(L);
+        return;
+    }
+
+    slwState view = slwState_view(L);
+    slwTable_push(&view, slt);
+    slwTable_free(slt);
+}
+#endif
+
+#endif
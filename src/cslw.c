@@ -1,16 +1,38 @@
 #define SLW_TABLE_MAX_KEYS 32
 
+#if !defined(_WIN32) && !defined(_XOPEN_SOURCE)
+    #define _XOPEN_SOURCE 700 // clock_gettime, sigaction, setitimer
+#endif
+
 #include "cslw/cslw.h"
 #include <stdlib.h>
 #include <assert.h>
 #include <memory.h>
 #include <string.h>
 #include <stdio.h>
+#include <signal.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <time.h>
+    #include <sched.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+#if SLW_PROFILER_USE_SIGNAL
+    #include <sys/time.h>
+#endif
 
 // Some Compatibility
 // From: https://github.com/lunarmodules/lua-compat-5.3/blob/master/c-api/compat-5.3.h
 //------------------------------------------------------------------------
-#if !defined(COMPAT53_API)
+// Only for the versions that don't have these, on the others they would replace the real ones
+#if !defined(COMPAT53_API) && LUA_VERSION_NUM < 503
 int lua_isinteger(lua_State *L, int index) {
     if (lua_type(L, index) == LUA_TNUMBER) {
         lua_Number n = lua_tonumber(L, index);
@@ -20,7 +42,9 @@ int lua_isinteger(lua_State *L, int index) {
     }
     return 0;
 }
+#endif
 
+#if !defined(COMPAT53_API) && LUA_VERSION_NUM < 502
 int lua_absindex (lua_State *L, int i) {
     if (i < 0 && i > LUA_REGISTRYINDEX)
         i += lua_gettop(L) + 1;
@@ -64,409 +88,7576 @@ void luaL_requiref (lua_State *L, const char *modname, lua_CFunction openf, int
 
 // Internal Functions (Mainly helper functions)
 //------------------------------------------------------------------------
-SLW_INLINE SLW_INTERNAL bool _is_integer(const double d) { return (int)d == d; }
+// Whole and in the range of `int64_t` (the cast alone is undefined outside of it)
+SLW_INLINE SLW_INTERNAL bool _is_integer(const double d) { return d >= -9223372036854775808.0 && d < 9223372036854775808.0 && (double)(int64_t)d == d; }
 
-SLW_INTERNAL void
-_slwTable_push_value(slwState* slw, slwTableValue el)
+// Monotonic clock in nanoseconds
+SLW_INTERNAL uint64_t
+_slw_clock_ns()
 {
-    lua_State* L = slw->LState;
+#if defined(_WIN32)
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (freq.QuadPart == 0)
+        QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (uint64_t)((double)now.QuadPart * (1000000000.0 / (double)freq.QuadPart));
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
 
-    switch (el.ltype)
-    {
-        case LUA_TSTRING:
-            lua_pushstring(L, el.value.s);
-            break;
-        case LUA_TNUMBER:
-            lua_pushnumber(L, el.value.d);
-            break;
-        case LUA_TBOOLEAN:
-            lua_pushboolean(L, el.value.b);
-            break;
-        case LUA_TTABLE:
-            slwTable_push(slw, el.value.t);
-            break;
-        case LUA_TLIGHTUSERDATA:
-            lua_pushlightuserdata(L, el.value.u);
-            break;
-        case LUA_TFUNCTION:
-            lua_pushcfunction(L, el.value.f);
-            break;
-        default:
-            // TODO: Actual error/warn functions? (Not really for this, but for everything else)
-            printf("[CSLW] Tried pushing unknown type: %d (name: %s)\n", el.ltype, el.name);
-            break;
-    }
+// Atomics, the GCC/Clang builtins or their Interlocked equivalents
+SLW_INTERNAL int64_t
+_slw_atomic_add(volatile int64_t* value, int64_t n)
+{
+#if defined(_MSC_VER)
+    return InterlockedExchangeAdd64((volatile LONG64*)value, n) + n;
+#else
+    return __atomic_add_fetch(value, n, __ATOMIC_ACQ_REL);
+#endif
+}
+
+SLW_INTERNAL SLW_INLINE uint64_t
+_slw_atomic_load(volatile uint64_t* value)
+{
+#if defined(_MSC_VER)
+    return (uint64_t)InterlockedOr64((volatile LONG64*)value, 0);
+#else
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+#endif
+}
+
+SLW_INTERNAL SLW_INLINE void
+_slw_atomic_store(volatile uint64_t* value, uint64_t n)
+{
+#if defined(_MSC_VER)
+    InterlockedExchange64((volatile LONG64*)value, (LONG64)n);
+#else
+    __atomic_store_n(value, n, __ATOMIC_RELEASE);
+#endif
+}
+
+SLW_INTERNAL SLW_INLINE bool
+_slw_atomic_cas(volatile uint64_t* value, uint64_t expected, uint64_t desired)
+{
+#if defined(_MSC_VER)
+    return (uint64_t)InterlockedCompareExchange64((volatile LONG64*)value, (LONG64)desired, (LONG64)expected) == expected;
+#else
+    return __atomic_compare_exchange_n(value, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+#endif
 }
 
+// Waits a little longer every call: spins first, then gives up the time slice, then sleeps.
 SLW_INTERNAL void
-_slwTable_set_value(slwTable* slt, const char* key, slwTableValue val)
+_slw_backoff(uint32_t* spins)
 {
-    slwTableValue* sltTable = slwTable_getkey(slt, key);
-    if (sltTable)
+    if (*spins < 64)
     {
-        sltTable->value = val.value;
-        sltTable->ltype = val.ltype;
+        (*spins)++;
         return;
     }
 
-    val.name = key;
-    slt->elements = (slwTableValue*)slw_realloc(slt->elements, sizeof(slwTableValue) * (slt->size + 1));
-    slt->elements[slt->size++] = val;
+#if defined(_WIN32)
+    if ((*spins)++ < 128)
+        SwitchToThread();
+    else
+        Sleep(1);
+#else
+    if ((*spins)++ < 128)
+    {
+        sched_yield();
+    } else
+    {
+        struct timespec ts = { 0, 50000 };
+        nanosleep(&ts, NULL);
+    }
+#endif
 }
 
-// Functions
-//------------------------------------------------------------------------
-// Primary Functions
-SLW_API void
-slwState_destroy(slwState* slw)
+// Encoders write into the public `slwBuffer`
+typedef slwBuffer _slwBuffer;
+
+SLW_INTERNAL bool
+_slwBuffer_reserve(_slwBuffer* buf, size_t n)
 {
-    SLW_CHECKSTATE(slw);
-    if (slw->LState)
-        slwState_close(slw);
+    if (buf->size + n <= buf->capacity)
+        return true;
 
-    free(slw);
-    slw = NULL;
+    size_t capacity = buf->capacity ? buf->capacity : 64;
+    while (capacity < buf->size + n)
+        capacity *= 2;
+
+    uint8_t* data = (uint8_t*)slw_realloc(buf->data, capacity);
+    if (!data)
+        return false;
+
+    buf->data = data;
+    buf->capacity = capacity;
+    return true;
 }
 
-SLW_API slwState*
-slwState_new_empty()
+SLW_INTERNAL SLW_INLINE bool
+_slwBuffer_write(_slwBuffer* buf, const void* data, size_t n)
 {
-    lua_State* L = luaL_newstate();
-    if (!L) return NULL;
+    if (!_slwBuffer_reserve(buf, n))
+        return false;
 
-    slwState* slw = (slwState*)slw_malloc(sizeof(slwState));
-    slw->LState = L;
+    memcpy(buf->data + buf->size, data, n);
+    buf->size += n;
+    return true;
+}
 
-    return slw;
+SLW_INTERNAL SLW_INLINE bool
+_slwBuffer_byte(_slwBuffer* buf, uint8_t b)
+{
+    return _slwBuffer_write(buf, &b, 1);
 }
 
-SLW_API slwState*
-slwState_new_with(const uint32_t libs)
+// LEB128
+SLW_INTERNAL bool
+_slwBuffer_varint(_slwBuffer* buf, uint64_t n)
 {
-    slwState* slw = slwState_new_empty();
-    if (!slw) return NULL;
+    uint8_t bytes[10];
+    size_t len = 0;
+    do
+    {
+        bytes[len] = (uint8_t)(n & 0x7F);
+        n >>= 7;
+        if (n)
+            bytes[len] |= 0x80;
+        len++;
+    } while (n);
+
+    return _slwBuffer_write(buf, bytes, len);
+}
 
-    slwState_openlibraries(slw, libs);
-    return slw;
+SLW_INTERNAL bool
+_slw_readvarint(const uint8_t** p, const uint8_t* end, uint64_t* n)
+{
+    *n = 0;
+    for (int shift = 0; *p < end && shift < 64; shift += 7)
+    {
+        const uint8_t b = *(*p)++;
+        *n |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
 }
 
-SLW_API slwState*
-slwState_new_from_slws(slwState* slw)
+// Hooks
+//----------------------------------
+// Only the addresses are used, they're the registry keys for the active `slwBudget*` and `slwProfiler*`
+// and the owning `slwState*`.
+SLW_INTERNAL const char _slwBudgetKey = 0;
+SLW_INTERNAL const char _slwProfilerKey = 0;
+SLW_INTERNAL const char _slwStateKey = 0;
+
+struct slwProfilerEntry
 {
-    SLW_CHECKSTATE(slw);
-    SLW_CHECKSTATE(slw);
+    char* stack;
+    uint64_t hash;
+    uint64_t count;
+};
 
-    slwState* newSLW = (slwState*)slw_malloc(sizeof(slwState));
-    if (!newSLW)
-        return NULL;
+struct slwProfiler
+{
+    lua_State* L;
+    uint64_t periodNs;
+    uint64_t nextSample;
+    uint64_t samples;
 
-    newSLW->LState = slw->LState;
+    // Set by the SIGPROF handler, consumed by the hook
+    volatile sig_atomic_t pending;
+    volatile uint64_t pendingAt;
 
-    return newSLW;
+    // Innermost coroutine resumed through `coroutine.resume`/`wrap`, NULL while `L` runs
+    lua_State* volatile running;
+
+    struct slwProfilerEntry* entries;
+    size_t capacity;
+    size_t size;
+};
+
+SLW_INTERNAL void*
+_slw_registry_getp(lua_State* L, const void* key)
+{
+    lua_pushlightuserdata(L, (void*)key);
+    lua_rawget(L, LUA_REGISTRYINDEX);
+    void* p = lua_touserdata(L, -1);
+    lua_pop(L, 1);
+    return p;
 }
 
-SLW_API slwState* slwState_new_from_luas(lua_State* L)
+SLW_INTERNAL void
+_slw_registry_setp(lua_State* L, const void* key, void* p)
 {
-    SLW_ASSERT(L != NULL);
+    lua_pushlightuserdata(L, (void*)key);
+    if (p)
+        lua_pushlightuserdata(L, p);
+    else
+        lua_pushnil(L);
+    lua_rawset(L, LUA_REGISTRYINDEX);
+}
 
-    slwState* slw = (slwState*)slw_malloc(sizeof(slwState));
-    if (!slw)
-        return NULL;
+// Pushes `_G` straight from the registry, without `lua_getglobal`'s lookup of a name
+SLW_INTERNAL SLW_INLINE void
+_slw_pushglobals(lua_State* L)
+{
+#if LUA_VERSION_NUM >= 502
+    lua_rawgeti(L, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
+#else
+    lua_pushvalue(L, LUA_GLOBALSINDEX);
+#endif
+}
 
-    slw->LState = L;
+SLW_INTERNAL uint64_t
+_slw_fnv1a(const char* str, size_t len)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= (uint8_t)str[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
 
-    return slw;
+SLW_INTERNAL void
+_slwProfiler_add(slwProfiler* prof, const char* stack, size_t len)
+{
+    // Keep the load factor under 70%
+    if ((prof->size + 1) * 10 > prof->capacity * 7)
+    {
+        const size_t capacity = prof->capacity ? prof->capacity * 2 : 256;
+        struct slwProfilerEntry* entries = (struct slwProfilerEntry*)slw_calloc(capacity, sizeof(struct slwProfilerEntry));
+        if (!entries)
+            return;
+
+        for (size_t i = 0; i < prof->capacity; i++)
+        {
+            struct slwProfilerEntry* el = &prof->entries[i];
+            if (!el->stack)
+                continue;
+
+            size_t slot = el->hash & (capacity - 1);
+            while (entries[slot].stack)
+                slot = (slot + 1) & (capacity - 1);
+            entries[slot] = *el;
+        }
+
+        slw_free(prof->entries);
+        prof->entries = entries;
+        prof->capacity = capacity;
+    }
+
+    const uint64_t hash = _slw_fnv1a(stack, len);
+    size_t slot = hash & (prof->capacity - 1);
+    while (prof->entries[slot].stack)
+    {
+        struct slwProfilerEntry* el = &prof->entries[slot];
+        if (el->hash == hash && strcmp(el->stack, stack) == 0)
+        {
+            el->count++;
+            return;
+        }
+        slot = (slot + 1) & (prof->capacity - 1);
+    }
+
+    char* copy = (char*)slw_malloc(len + 1);
+    if (!copy)
+        return;
+    memcpy(copy, stack, len + 1);
+
+    prof->entries[slot].stack = copy;
+    prof->entries[slot].hash = hash;
+    prof->entries[slot].count = 1;
+    prof->size++;
 }
 
-SLW_API void
-slwState_close(slwState* slw)
+// Walks the Lua stack and records it in folded form, root first: `main (a.lua);update (a.lua:12);sqrt [C]`
+SLW_INTERNAL void
+_slwProfiler_sample(lua_State* L, slwProfiler* prof)
 {
-    SLW_CHECKSTATE(slw);
-    lua_close(slw->LState);
-    slw->LState = NULL;
+    lua_Debug ar;
+
+    int depth = 0;
+    while (depth < SLW_PROFILER_MAX_DEPTH && lua_getstack(L, depth, &ar))
+        ++depth;
+
+    if (depth == 0)
+        return;
+
+    char stack[SLW_PROFILER_MAX_DEPTH * 64];
+    size_t len = 0;
+
+    for (int level = depth - 1; level >= 0; --level)
+    {
+        if (!lua_getstack(L, level, &ar) || !lua_getinfo(L, "Sn", &ar))
+            continue;
+
+        char frame[128];
+        int n;
+        if (*ar.what == 'C')
+            n = snprintf(frame, sizeof(frame), "%s [C]", ar.name ? ar.name : "?");
+        else if (*ar.what == 'm')
+            n = snprintf(frame, sizeof(frame), "main (%s)", ar.short_src);
+        else
+            n = snprintf(frame, sizeof(frame), "%s (%s:%d)", ar.name ? ar.name : "?", ar.short_src, ar.linedefined);
+
+        if (n < 0)
+            continue;
+        if ((size_t)n >= sizeof(frame))
+            n = sizeof(frame) - 1;
+        if (len + n + 2 > sizeof(stack))
+            break;
+
+        if (len)
+            stack[len++] = ';';
+
+        // ';' separates frames in the folded format
+        for (int i = 0; i < n; i++)
+            stack[len++] = frame[i] == ';' ? ':' : frame[i];
+    }
+
+    stack[len] = '\0';
+
+    prof->samples++;
+    _slwProfiler_add(prof, stack, len);
 }
 
-SLW_API void
-slwState_openlibraries(slwState* slw, const uint32_t libs)
+SLW_INTERNAL void _slw_hook(lua_State* L, lua_Debug* ar);
+
+// Installs the count hook with the smallest interval the active budget and profiler need, or removes it.
+SLW_INTERNAL void
+_slw_updatehook(lua_State* L)
 {
-    SLW_CHECKSTATE(slw);
+    slwBudget* budget = (slwBudget*)_slw_registry_getp(L, &_slwBudgetKey);
+    slwProfiler* prof = (slwProfiler*)_slw_registry_getp(L, &_slwProfilerKey);
 
-    luaopen_base(slw->LState);
-    if (libs & slw_lib_package)
-        slwState_openlib(slw, "package", luaopen_package);
-    if (libs & slw_lib_table)
-        slwState_openlib(slw, "table", luaopen_table);
-    if (libs & slw_lib_string)
-        slwState_openlib(slw, "string", luaopen_string);
-    if (libs & slw_lib_math)
-        slwState_openlib(slw, "math", luaopen_math);
-    if (libs & slw_lib_debug)
-        slwState_openlib(slw, "debug", luaopen_debug);
-    if (libs & slw_lib_io)
-        slwState_openlib(slw, "io", luaopen_io);
-#if CLW_USING_LUAJIT == 0
-    if (libs & slw_lib_coroutine)
-        slwState_openlib(slw, "coroutine", luaopen_coroutine);
-#endif
-    if (libs & slw_lib_os)
-        slwState_openlib(slw, "os", luaopen_os);
-#if CLW_USING_LUAJIT == 0
-    if (libs & slw_lib_utf8)
-        slwState_openlib(slw, "utf8", luaopen_utf8);
+    uint64_t interval = 0;
+    if (budget)
+    {
+        interval = SLW_BUDGET_CHECK_INTERVAL;
+        if (budget->maxInstructions && budget->maxInstructions - budget->instructions < interval)
+            interval = budget->maxInstructions - budget->instructions;
+    }
+#if !SLW_PROFILER_USE_SIGNAL
+    if (prof && (interval == 0 || SLW_PROFILER_CHECK_INTERVAL < interval))
+        interval = SLW_PROFILER_CHECK_INTERVAL;
 #else
-    if (libs & slw_lib_jit)
-        slwState_openlib(slw, "jit", luaopen_jit);
-    if (libs & slw_lib_ffi)
-        slwState_openlib(slw, "ffi", luaopen_ffi);
+    (void)prof;
 #endif
-#if __cslw_bit32_manual
-    if (libs && slw_lib_bit32)
-        slwState_openlib(slw, "bit32", luaopen_bit32);
+
+    if (interval)
+        lua_sethook(L, _slw_hook, LUA_MASKCOUNT, (int)interval);
+    else
+        lua_sethook(L, NULL, 0, 0);
+}
+
+SLW_INTERNAL void
+_slw_hook(lua_State* L, lua_Debug* ar)
+{
+    (void)ar;
+
+    // The count that just ran out, `lua_sethook` resets the counter so this is exact.
+    const int count = lua_gethookcount(L);
+
+    slwProfiler* prof = (slwProfiler*)_slw_registry_getp(L, &_slwProfilerKey);
+#if SLW_PROFILER_USE_SIGNAL
+    if (prof && prof->pending)
+    {
+        prof->pending = 0;
+
+        // A tick that arrived while the state was busy in C or idle isn't Lua time, drop it.
+        if (_slw_clock_ns() - prof->pendingAt <= prof->periodNs)
+            _slwProfiler_sample(L, prof);
+
+        _slw_updatehook(L);
+    }
+#else
+    if (prof)
+    {
+        const uint64_t now = _slw_clock_ns();
+        if (now >= prof->nextSample)
+        {
+            prof->nextSample = now + prof->periodNs;
+            _slwProfiler_sample(L, prof);
+        }
+    }
 #endif
+
+    slwBudget* budget = (slwBudget*)_slw_registry_getp(L, &_slwBudgetKey);
+    if (!budget)
+        return;
+
+    budget->instructions += count;
+
+    if (!budget->exceeded)
+    {
+        if (budget->maxInstructions && budget->instructions >= budget->maxInstructions)
+            budget->exceeded = true;
+        else if (budget->deadline && _slw_clock_ns() >= budget->deadline)
+            budget->exceeded = true;
+    }
+
+    if (budget->exceeded)
+    {
+        // Fire on the next instruction again, that way a `pcall` inside of the script can't swallow the abort.
+        lua_sethook(L, _slw_hook, LUA_MASKCOUNT, 1);
+
+        lua_pushstring(L, SLW_BUDGET_ERROR);
+        lua_error(L);
+        return;
+    }
+
+    if (budget->maxInstructions && budget->maxInstructions - budget->instructions < (uint64_t)count)
+        _slw_updatehook(L);
 }
 
-SLW_API void
-slwState_openlib(slwState* slw, const char* name, lua_CFunction func)
+// Calls upvalue 1 with the arguments while the profiler follows `co`: the signal arms its hook on it, the count
+// hook is installed on it (coroutines made before `slwProfiler_start` don't inherit it)
+SLW_INTERNAL int
+_slwProfiler_follow(lua_State* L, lua_State* co)
 {
-    SLW_CHECKSTATE(slw);
-    lua_State* L = slw->LState;
-    luaL_requiref(L, name, func, 1);
-    lua_pop(L, 1);
+    slwProfiler* prof = (slwProfiler*)_slw_registry_getp(L, &_slwProfilerKey);
+    lua_State* prev = NULL;
+    if (prof && co)
+    {
+        prev = prof->running;
+        prof->running = co;
+        _slw_updatehook(co);
+    }
+
+    lua_pushvalue(L, lua_upvalueindex(1));
+    lua_insert(L, 1);
+    const int status = lua_pcall(L, lua_gettop(L) - 1, LUA_MULTRET, 0);
+
+    if (prof && co)
+    {
+        prof->running = prev;
+        _slw_updatehook(co);
+    }
+
+    if (status != 0)
+        return lua_error(L);
+    return lua_gettop(L);
 }
 
-SLW_API bool
-slwState_runstring(slwState* slw, const char* str)
+// `coroutine.resume` while profiling, upvalue 1 is the original
+SLW_INTERNAL int
+_slwProfiler_resume(lua_State* L)
 {
-    SLW_CHECKSTATE(slw);
-    lua_State* L = slw->LState;
-    return (luaL_loadstring(L, str) || lua_pcall(L, 0, LUA_MULTRET, 0)) == 0;
+    return _slwProfiler_follow(L, lua_tothread(L, 1));
 }
 
-SLW_API bool
-slwState_runfile(slwState* slw, const char* filename)
+// What `coroutine.wrap` returns while profiling, upvalue 1 is the original function and 2 its coroutine
+SLW_INTERNAL int
+_slwProfiler_wrapped(lua_State* L)
 {
-    SLW_CHECKSTATE(slw);
-    lua_State* L = slw->LState;
-    return (luaL_loadfile(L, filename) || lua_pcall(L, 0, LUA_MULTRET, 0)) == 0;
+    return _slwProfiler_follow(L, lua_tothread(L, lua_upvalueindex(2)));
 }
 
-SLW_API bool
-slwState_call_fn_at(slwState* slw, const size_t idx, ...)
+// `coroutine.wrap` while profiling, upvalue 1 is the original. Its function keeps the coroutine as its first upvalue
+// (LuaJIT's doesn't, those are returned as they are).
+SLW_INTERNAL int
+_slwProfiler_wrap(lua_State* L)
 {
-    SLW_CHECKSTATE(slw);
-    lua_State* L = slw->LState;
+    lua_pushvalue(L, lua_upvalueindex(1));
+    lua_insert(L, 1);
+    lua_call(L, lua_gettop(L) - 1, 1);
 
-    if (!lua_isfunction(L, idx))
+    if (lua_getupvalue(L, -1, 1) != NULL && lua_type(L, -1) == LUA_TTHREAD)
+    {
+        lua_pushcclosure(L, _slwProfiler_wrapped, 2);
+        return 1;
+    }
+
+    lua_settop(L, 1);
+    return 1;
+}
+
+// Swaps `coroutine[name]` for `func` with the original as its upvalue, or back to the original
+SLW_INTERNAL void
+_slwProfiler_swap(lua_State* L, const char* name, lua_CFunction func, bool install)
+{
+    luaL_getsubtable(L, LUA_REGISTRYINDEX, "_LOADED");
+    lua_getfield(L, -1, "coroutine");
+    if (!lua_istable(L, -1))
+    {
+        lua_pop(L, 2);
+        return;
+    }
+
+    lua_getfield(L, -1, name);
+    const bool swapped = lua_tocfunction(L, -1) == func;
+    if (install && !swapped && lua_iscfunction(L, -1))
+    {
+        lua_pushcclosure(L, func, 1);
+        lua_setfield(L, -2, name);
+    } else if (!install && swapped)
+    {
+        lua_getupvalue(L, -1, 1);
+        lua_setfield(L, -3, name);
+        lua_pop(L, 1);
+    } else
+    {
+        lua_pop(L, 1);
+    }
+    lua_pop(L, 2);
+}
+
+#if SLW_PROFILER_USE_SIGNAL
+// The slots hold `slwProfiler*`s, read by the handler with atomic loads. Starting and stopping (from any thread)
+// take the lock, the handler never does, it counts itself in `_slwProfilerBusy` instead.
+SLW_INTERNAL volatile uint64_t _slwProfilers[SLW_PROFILER_MAX_STATES];
+SLW_INTERNAL volatile uint64_t _slwProfilerLock = 0;
+SLW_INTERNAL volatile int64_t _slwProfilerBusy = 0;
+SLW_INTERNAL struct sigaction _slwProfilerOldAction;
+SLW_INTERNAL int _slwProfilerCount = 0;
+
+// The handler only arms a one-shot hook, `_slw_hook` walks the stack once the VM is at a safe point.
+// `lua_sethook` is the one Lua function that's safe to call from a signal handler.
+SLW_INTERNAL void
+_slwProfiler_signal(int sig)
+{
+    (void)sig;
+
+    _slw_atomic_add(&_slwProfilerBusy, 1);
+    const uint64_t now = _slw_clock_ns();
+    for (int i = 0; i < SLW_PROFILER_MAX_STATES; i++)
+    {
+        slwProfiler* prof = (slwProfiler*)(uintptr_t)_slw_atomic_load(&_slwProfilers[i]);
+        if (!prof)
+            continue;
+
+        lua_State* L = prof->running ? prof->running : prof->L;
+        prof->pendingAt = now;
+        prof->pending = 1;
+        lua_sethook(L, _slw_hook, LUA_MASKCOUNT, 1);
+    }
+    _slw_atomic_add(&_slwProfilerBusy, -1);
+}
+
+SLW_INTERNAL void
+_slwProfiler_lock(void)
+{
+    uint32_t spins = 0;
+    while (!_slw_atomic_cas(&_slwProfilerLock, 0, 1))
+        _slw_backoff(&spins);
+}
+
+SLW_INTERNAL void
+_slwProfiler_unlock(void)
+{
+    _slw_atomic_store(&_slwProfilerLock, 0);
+}
+
+#if defined(__linux__)
+// ITIMER_PROF only ticks as fast as the kernel does (often 250Hz), a POSIX timer on the monotonic clock doesn't
+// (a CPU-time one is checked on the same kernel tick). Ticks while the state is idle are dropped by the hook.
+SLW_INTERNAL timer_t _slwProfilerTimer;
+SLW_INTERNAL bool _slwProfilerHasTimer = false;
+#endif
+
+SLW_INTERNAL bool
+_slwProfiler_settimer(const uint64_t periodNs)
+{
+#if defined(__linux__)
+    if (!_slwProfilerHasTimer)
+    {
+        if (periodNs == 0)
+            return true;
+
+        struct sigevent event;
+        memset(&event, 0, sizeof(event));
+        event.sigev_notify = SIGEV_SIGNAL;
+        event.sigev_signo = SIGPROF;
+        if (timer_create(CLOCK_MONOTONIC, &event, &_slwProfilerTimer) != 0)
+            return false;
+        _slwProfilerHasTimer = true;
+    }
+
+    struct itimerspec timer;
+    timer.it_interval.tv_sec = periodNs / 1000000000ull;
+    timer.it_interval.tv_nsec = periodNs % 1000000000ull;
+    timer.it_value = timer.it_interval;
+    if (timer_settime(_slwProfilerTimer, 0, &timer, NULL) != 0)
+        return false;
+
+    if (periodNs == 0)
+    {
+        timer_delete(_slwProfilerTimer);
+        _slwProfilerHasTimer = false;
+    }
+    return true;
+#else
+    struct itimerval timer;
+    timer.it_interval.tv_sec = periodNs / 1000000000ull;
+    timer.it_interval.tv_usec = (periodNs % 1000000000ull) / 1000;
+    timer.it_value = timer.it_interval;
+    return setitimer(ITIMER_PROF, &timer, NULL) == 0;
+#endif
+}
+
+SLW_INTERNAL bool
+_slwProfiler_attach(slwProfiler* prof)
+{
+    _slwProfiler_lock();
+    int slot = -1;
+    for (int i = 0; i < SLW_PROFILER_MAX_STATES; i++)
+    {
+        const uint64_t held = _slw_atomic_load(&_slwProfilers[i]);
+        if (held == (uintptr_t)prof)
+        {
+            const bool ok = _slwProfiler_settimer(prof->periodNs);
+            _slwProfiler_unlock();
+            return ok;
+        }
+        if (slot == -1 && !held)
+            slot = i;
+    }
+
+    if (slot == -1)
+    {
+        _slwProfiler_unlock();
+        return false;
+    }
+
+    if (_slwProfilerCount++ == 0)
+    {
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = _slwProfiler_signal;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGPROF, &action, &_slwProfilerOldAction);
+    }
+
+    _slw_atomic_store(&_slwProfilers[slot], (uintptr_t)prof);
+
+    // The timer is process wide, the last started profiler decides the rate.
+    const bool ok = _slwProfiler_settimer(prof->periodNs);
+    _slwProfiler_unlock();
+    return ok;
+}
+
+SLW_INTERNAL void
+_slwProfiler_detach(slwProfiler* prof)
+{
+    _slwProfiler_lock();
+    for (int i = 0; i < SLW_PROFILER_MAX_STATES; i++)
+    {
+        if (!_slw_atomic_cas(&_slwProfilers[i], (uintptr_t)prof, 0))
+            continue;
+
+        if (--_slwProfilerCount == 0)
+        {
+            _slwProfiler_settimer(0);
+            sigaction(SIGPROF, &_slwProfilerOldAction, NULL);
+        }
+        break;
+    }
+    _slwProfiler_unlock();
+
+    // A handler on another thread may still have loaded `prof`, the state can't go away before it's done
+    uint32_t spins = 0;
+    while (_slw_atomic_add(&_slwProfilerBusy, 0) != 0)
+        _slw_backoff(&spins);
+
+    prof->pending = 0;
+}
+#endif
+
+SLW_INTERNAL void _slwPath_bump(lua_State* L);
+
+// `lua_pcall` with the budget of the state applied, if there is one.
+// Whatever ran may have replaced tables along compiled paths, so they walk again afterwards.
+SLW_INTERNAL int
+_slwState_pcall(slwState* slw, int nargs, int nresults)
+{
+    lua_State* L = slw->LState;
+    slwBudget* budget = &slw->budget;
+
+    // No budget or we're already inside of a budgeted call (C function calling back into Lua)
+    if ((!budget->maxInstructions && !budget->timeoutUs) || budget->active)
+    {
+        const int status = lua_pcall(L, nargs, nresults, 0);
+        _slwPath_bump(L);
+        return status;
+    }
+
+    budget->instructions = 0;
+    budget->deadline = budget->timeoutUs ? _slw_clock_ns() + budget->timeoutUs * 1000 : 0;
+    budget->exceeded = false;
+    budget->active = true;
+
+    _slw_registry_setp(L, &_slwBudgetKey, budget);
+    _slw_updatehook(L);
+
+    const int status = lua_pcall(L, nargs, nresults, 0);
+
+    _slw_registry_setp(L, &_slwBudgetKey, NULL);
+    _slw_updatehook(L);
+    budget->active = false;
+
+    _slwPath_bump(L);
+    return status;
+}
+
+// C Function Statistics
+//----------------------------------
+#if SLW_ENABLE_CSTATS
+SLW_INTERNAL int
+_slw_log2(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(x);
+#else
+    int r = 0;
+    while (x >>= 1)
+        ++r;
+    return r;
+#endif
+}
+
+// Log-bucketed like HDR histograms, every power of two is split into 4 linear sub-buckets (<= 25% error).
+SLW_INTERNAL SLW_INLINE int
+_slwCStats_bucket(const uint64_t ns)
+{
+    if (ns < 4)
+        return (int)ns;
+
+    const int msb = _slw_log2(ns);
+    return (msb - 1) * 4 + (int)((ns >> (msb - 2)) & 3);
+}
+
+SLW_INTERNAL uint64_t
+_slwCStats_bucket_value(const int bucket)
+{
+    if (bucket < 4)
+        return bucket;
+
+    const int msb = bucket / 4 + 1;
+    return (uint64_t)(4 + bucket % 4) << (msb - 2);
+}
+
+// Wraps every C function registered while stats are enabled.
+SLW_INTERNAL int
+_slwCStats_call(lua_State* L)
+{
+    // The record is the last upvalue, the ones in front belong to the wrapped closure.
+    int idx = 1;
+    while (!lua_isnone(L, lua_upvalueindex(idx + 1)))
+        ++idx;
+    slwCStats* stats = (slwCStats*)lua_touserdata(L, lua_upvalueindex(idx));
+
+    const uint64_t start = _slw_clock_ns();
+    const int nret = stats->fn(L);
+    const uint64_t ns = _slw_clock_ns() - start;
+
+    stats->calls++;
+    stats->totalNs += ns;
+    if (ns > stats->maxNs)
+        stats->maxNs = ns;
+    stats->histogram[_slwCStats_bucket(ns)]++;
+
+    return nret;
+}
+
+SLW_INTERNAL slwCStats*
+_slwCStats_get(slwState* slw, const char* name, lua_CFunction fn)
+{
+    for (slwCStats* stats = slw->cstats; stats; stats = stats->next)
+    {
+        if (stats->fn == fn && strcmp(stats->name, name) == 0)
+            return stats;
+    }
+
+    const size_t len = strlen(name);
+    slwCStats* stats = (slwCStats*)slw_calloc(1, sizeof(slwCStats) + len + 1);
+    if (!stats)
+        return NULL;
+
+    char* nameCopy = (char*)(stats + 1);
+    memcpy(nameCopy, name, len + 1);
+
+    stats->name = nameCopy;
+    stats->fn = fn;
+    stats->next = slw->cstats;
+    slw->cstats = stats;
+    return stats;
+}
+#endif
+
+// Pushes a C closure that's about to be registered under `name`, wrapped for stats if they're enabled.
+SLW_INTERNAL SLW_INLINE void
+_slw_pushcclosure(slwState* slw, const char* name, lua_CFunction fn, int n)
+{
+#if SLW_ENABLE_CSTATS
+    if (slw->cstatsEnabled && name)
+    {
+        slwCStats* stats = _slwCStats_get(slw, name, fn);
+        if (stats)
+        {
+            lua_pushlightuserdata(slw->LState, stats);
+            lua_pushcclosure(slw->LState, _slwCStats_call, n + 1);
+            return;
+        }
+    }
+#else
+    (void)name;
+#endif
+
+    lua_pushcclosure(slw->LState, fn, n);
+}
+
+// Classes
+//----------------------------------
+// Instances are `cls->size` bytes followed by this, set once `__close` ran.
+#define _SLW_CLASS_CLOSED(cls, ud) ((bool*)((char*)(ud) + (cls)->size))
+
+// Perfect hash from the address of an interned field name to its field, Lua short strings are unique
+// per state so a key is a field iff its address is the one in its slot.
+typedef struct _slwFieldSlot
+{
+    const char* key;
+    const slwClassField* field;
+} _slwFieldSlot;
+
+typedef struct _slwFieldHash
+{
+    uint64_t mult;
+    uint32_t shift;
+    _slwFieldSlot slots[];
+} _slwFieldHash;
+
+SLW_INTERNAL SLW_INLINE size_t
+_slwFieldHash_slot(uint64_t mult, uint32_t shift, const char* key)
+{
+    return (size_t)(((uint64_t)(uintptr_t)key * mult) >> shift);
+}
+
+SLW_INTERNAL uint64_t
+_slw_splitmix64(uint64_t* state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Pushes the hash for `cls->fields` as userdata and a table anchoring the names (so their addresses stay valid).
+SLW_INTERNAL void
+_slwFieldHash_push(lua_State* L, const slwClass* cls)
+{
+    size_t count = 0;
+    while (cls->fields[count].name)
+        count++;
+
+    lua_createtable(L, (int)count, 0);
+    const int names = lua_gettop(L);
+    const char** keys = (const char**)slw_malloc(count * sizeof(const char*));
+    for (size_t i = 0; i < count; i++)
+    {
+        const slwClassField* field = &cls->fields[i];
+        SLW_ASSERT(strlen(field->name) <= SLW_CLASS_MAX_FIELD_NAME);
+
+        lua_pushstring(L, field->name);
+        keys[i] = lua_tostring(L, -1);
+        lua_rawseti(L, names, (int)i + 1);
+    }
+
+    // Load factor <= 0.5, random odd multipliers until one doesn't collide, a bigger table if none do
+    uint32_t bits = 1;
+    while (((size_t)1 << bits) < count * 2)
+        bits++;
+
+    uint64_t seed = 0;
+    uint64_t mult = 0;
+    uint8_t* used = NULL;
+    for (bool found = false; !found; bits++)
+    {
+        const size_t size = (size_t)1 << bits;
+        used = (uint8_t*)slw_realloc(used, size);
+        for (int attempt = 0; attempt < 64 && !found; attempt++)
+        {
+            mult = _slw_splitmix64(&seed) | 1;
+            memset(used, 0, size);
+
+            found = true;
+            for (size_t i = 0; i < count && found; i++)
+            {
+                const size_t slot = _slwFieldHash_slot(mult, 64 - bits, keys[i]);
+                found = !used[slot];
+                used[slot] = 1;
+            }
+        }
+
+        if (found)
+            break;
+    }
+    slw_free(used);
+
+    const size_t size = (size_t)1 << bits;
+    _slwFieldHash* hash = (_slwFieldHash*)lua_newuserdata(L, sizeof(_slwFieldHash) + size * sizeof(_slwFieldSlot));
+    memset(hash->slots, 0, size * sizeof(_slwFieldSlot));
+    hash->mult = mult;
+    hash->shift = 64 - bits;
+    for (size_t i = 0; i < count; i++)
+    {
+        _slwFieldSlot* slot = &hash->slots[_slwFieldHash_slot(mult, hash->shift, keys[i])];
+        slot->key = keys[i];
+        slot->field = &cls->fields[i];
+    }
+    slw_free(keys);
+
+    lua_insert(L, -2);
+}
+
+// Field for the key at 2 if there is one, `hashIdx` is the upvalue holding the hash (nil without fields)
+SLW_INTERNAL SLW_INLINE const slwClassField*
+_slwClass_findfield(lua_State* L, int hashIdx)
+{
+    const _slwFieldHash* hash = (const _slwFieldHash*)lua_touserdata(L, hashIdx);
+    if (!hash || lua_type(L, 2) != LUA_TSTRING)
+        return NULL;
+
+    const char* key = lua_tostring(L, 2);
+    const _slwFieldSlot* slot = &hash->slots[_slwFieldHash_slot(hash->mult, hash->shift, key)];
+    return slot->key == key ? slot->field : NULL;
+}
+
+// Userdata at 1 if its metatable is upvalue 1, raises otherwise so a metamethod can't be fed a foreign object
+SLW_INTERNAL void*
+_slwClass_self(lua_State* L)
+{
+    void* self = lua_touserdata(L, 1);
+    if (self && lua_getmetatable(L, 1))
+    {
+        const bool same = lua_rawequal(L, -1, lua_upvalueindex(1));
+        lua_pop(L, 1);
+        if (same)
+            return self;
+    }
+
+    lua_getfield(L, lua_upvalueindex(1), "__name");
+    const char* msg = lua_pushfstring(L, "%s expected, got %s", lua_tostring(L, -1), luaL_typename(L, 1));
+    luaL_argerror(L, 1, msg);
+    return NULL;
+}
+
+SLW_INTERNAL int
+_slwClass_getfield(lua_State* L, const void* self, const slwClassField* field)
+{
+    const char* member = (const char*)self + field->offset;
+    switch (field->type)
+    {
+        case slw_field_string:
+            lua_pushstring(L, *(const char* const*)member);
+            break;
+        case slw_field_number:
+            lua_pushnumber(L, *(const double*)member);
+            break;
+        case slw_field_float:
+            lua_pushnumber(L, *(const float*)member);
+            break;
+        case slw_field_int:
+            lua_pushinteger(L, *(const int32_t*)member);
+            break;
+        case slw_field_int64:
+            lua_pushinteger(L, (lua_Integer)*(const int64_t*)member);
+            break;
+        case slw_field_bool:
+            lua_pushboolean(L, *(const bool*)member);
+            break;
+        case slw_field_lightudata:
+            lua_pushlightuserdata(L, *(void* const*)member);
+            break;
+        default:
+            lua_pushnil(L);
+            break;
+    }
+    return 1;
+}
+
+SLW_INTERNAL int
+_slwClass_setfield(lua_State* L, void* self, const slwClass* cls, const slwClassField* field)
+{
+    if (field->readonly || field->type == slw_field_string)
+        return luaL_error(L, "%s: field '%s' is read-only", cls->name, field->name);
+
+    char* member = (char*)self + field->offset;
+    switch (field->type)
+    {
+        case slw_field_number:
+            *(double*)member = luaL_checknumber(L, 3);
+            break;
+        case slw_field_float:
+            *(float*)member = (float)luaL_checknumber(L, 3);
+            break;
+        case slw_field_int:
+            *(int32_t*)member = (int32_t)luaL_checkinteger(L, 3);
+            break;
+        case slw_field_int64:
+            *(int64_t*)member = (int64_t)luaL_checkinteger(L, 3);
+            break;
+        case slw_field_bool:
+            *(bool*)member = lua_toboolean(L, 3);
+            break;
+        case slw_field_lightudata:
+            luaL_checktype(L, 3, LUA_TLIGHTUSERDATA);
+            *(void**)member = lua_touserdata(L, 3);
+            break;
+    }
+    return 0;
+}
+
+// Upvalues: metatable, members (name -> method or property lightuserdata), field hash, field names
+SLW_INTERNAL int
+_slwClass_index(lua_State* L)
+{
+    const void* self = _slwClass_self(L);
+    const slwClassField* field = _slwClass_findfield(L, lua_upvalueindex(3));
+    if (field)
+        return _slwClass_getfield(L, self, field);
+
+    lua_pushvalue(L, 2);
+    lua_rawget(L, lua_upvalueindex(2));
+    if (lua_type(L, -1) != LUA_TLIGHTUSERDATA)
+        return 1;
+
+    const slwClassProperty* prop = (const slwClassProperty*)lua_touserdata(L, -1);
+    if (!prop->get)
+        return 0;
+
+    lua_settop(L, 2);
+    return prop->get(L);
+}
+
+// Upvalues: metatable, members, field hash, class
+SLW_INTERNAL int
+_slwClass_newindex(lua_State* L)
+{
+    const slwClass* cls = (const slwClass*)lua_touserdata(L, lua_upvalueindex(4));
+    void* self = _slwClass_self(L);
+    const slwClassField* field = _slwClass_findfield(L, lua_upvalueindex(3));
+    if (field)
+        return _slwClass_setfield(L, self, cls, field);
+
+    lua_pushvalue(L, 2);
+    lua_rawget(L, lua_upvalueindex(2));
+    const slwClassProperty* prop = lua_type(L, -1) == LUA_TLIGHTUSERDATA ? (const slwClassProperty*)lua_touserdata(L, -1) : NULL;
+    if (!prop || !prop->set)
+        return luaL_error(L, "%s: can't set field '%s'", cls->name, lua_tostring(L, 2));
+
+    lua_settop(L, 3);
+    return prop->set(L);
+}
+
+// Upvalues: metatable, class
+SLW_INTERNAL int
+_slwClass_gc(lua_State* L)
+{
+    const slwClass* cls = (const slwClass*)lua_touserdata(L, lua_upvalueindex(2));
+    void* self = _slwClass_self(L);
+    if (!*_SLW_CLASS_CLOSED(cls, self))
+        cls->gc(self);
+    return 0;
+}
+
+// Upvalues: metatable, class
+SLW_INTERNAL int
+_slwClass_close(lua_State* L)
+{
+    const slwClass* cls = (const slwClass*)lua_touserdata(L, lua_upvalueindex(2));
+    void* self = _slwClass_self(L);
+    if (!*_SLW_CLASS_CLOSED(cls, self))
+    {
+        *_SLW_CLASS_CLOSED(cls, self) = true;
+        cls->close(self);
+    }
+    return 0;
+}
+
+// Pushes the metatable of `cls`, or nil if it isn't registered
+SLW_INTERNAL void
+_slwClass_pushmetatable(lua_State* L, const slwClass* cls)
+{
+    lua_pushlightuserdata(L, (void*)cls);
+    lua_rawget(L, LUA_REGISTRYINDEX);
+}
+
+SLW_INTERNAL void
+_slwTable_push_value(slwState* slw, slwTableValue el)
+{
+    lua_State* L = slw->LState;
+
+    switch (el.ltype)
+    {
+        case LUA_TSTRING:
+            lua_pushstring(L, el.value.s);
+            break;
+        case LUA_TNUMBER:
+            lua_pushnumber(L, el.value.d);
+            break;
+        case slw_tinteger:
+            lua_pushinteger(L, (lua_Integer)el.value.l);
+            break;
+        case LUA_TBOOLEAN:
+            lua_pushboolean(L, el.value.b);
+            break;
+        case LUA_TTABLE:
+            slwTable_push(slw, el.value.t);
+            break;
+        case LUA_TLIGHTUSERDATA:
+            lua_pushlightuserdata(L, el.value.u);
+            break;
+        case LUA_TFUNCTION:
+            _slw_pushcclosure(slw, el.name, el.value.f, 0);
+            break;
+        default:
+            // TODO: Actual error/warn functions? (Not really for this, but for everything else)
+            printf("[CSLW] Tried pushing unknown type: %d (name: %s)\n", el.ltype, el.name);
+            break;
+    }
+}
+
+// Table Proxies
+//----------------------------------
+// Only the addresses are used, registry keys for the proxy metatable and the weak `slwTable*` -> proxy cache.
+SLW_INTERNAL const char _slwProxyMetaKey = 0;
+SLW_INTERNAL const char _slwProxyCacheKey = 0;
+
+// Key-value tables bigger than this get a hash index, smaller ones are scanned.
+#define _SLW_PROXY_HASH_MIN 8
+
+typedef struct _slwTableProxy
+{
+    slwTable* slt;
+    uint32_t mask;     // 0 without an index
+    uint32_t slots[];  // Element index + 1, 0 is empty
+} _slwTableProxy;
+
+// Lengths first, `key` can be longer than `name` and can have embedded zeros
+SLW_INTERNAL SLW_INLINE bool
+_slwTableProxy_keyeq(const char* name, const char* key, size_t len)
+{
+    return name && strlen(name) == len && memcmp(name, key, len) == 0;
+}
+
+// Index of the element named `key` or -1
+SLW_INTERNAL int64_t
+_slwTableProxy_find(const _slwTableProxy* proxy, const char* key, size_t len)
+{
+    const slwTable* slt = proxy->slt;
+    if (!proxy->mask)
+    {
+        for (size_t i = 0; i < slt->size; i++)
+        {
+            if (_slwTableProxy_keyeq(slt->elements[i].name, key, len))
+                return (int64_t)i;
+        }
+        return -1;
+    }
+
+    for (uint32_t slot = (uint32_t)_slw_fnv1a(key, len) & proxy->mask; proxy->slots[slot]; slot = (slot + 1) & proxy->mask)
+    {
+        const uint32_t i = proxy->slots[slot] - 1;
+        if (_slwTableProxy_keyeq(slt->elements[i].name, key, len))
+            return i;
+    }
+    return -1;
+}
+
+// Index of the element for the key at `idx` or -1
+SLW_INTERNAL int64_t
+_slwTableProxy_findkey(lua_State* L, const _slwTableProxy* proxy, int idx)
+{
+    const slwTable* slt = proxy->slt;
+    if (slt->size == 0)
+        return -1;
+
+    // Indexed table
+    if (!slt->elements[0].name)
+    {
+        if (lua_type(L, idx) != LUA_TNUMBER)
+            return -1;
+
+        const lua_Integer i = lua_tointeger(L, idx);
+        return (i >= 1 && (size_t)i <= slt->size && (lua_Number)i == lua_tonumber(L, idx)) ? (int64_t)i - 1 : -1;
+    }
+
+    if (lua_type(L, idx) != LUA_TSTRING)
+        return -1;
+
+    size_t len;
+    const char* key = lua_tolstring(L, idx, &len);
+    return _slwTableProxy_find(proxy, key, len);
+}
+
+// Pushes the proxy of `slt`, the metatable and the cache are at `mt` and `cache`
+SLW_INTERNAL void
+_slwTableProxy_push(lua_State* L, slwTable* slt, int mt, int cache)
+{
+    lua_pushlightuserdata(L, slt);
+    lua_rawget(L, cache);
+    if (!lua_isnil(L, -1))
+        return;
+    lua_pop(L, 1);
+
+    uint32_t capacity = 0;
+    if (slt->size > _SLW_PROXY_HASH_MIN && slt->elements[0].name)
+    {
+        capacity = 16;
+        while (capacity < slt->size * 2)
+            capacity <<= 1;
+    }
+
+    _slwTableProxy* proxy = (_slwTableProxy*)lua_newuserdata(L, sizeof(_slwTableProxy) + capacity * sizeof(uint32_t));
+    proxy->slt = slt;
+    proxy->mask = capacity ? capacity - 1 : 0;
+    if (capacity)
+    {
+        memset(proxy->slots, 0, capacity * sizeof(uint32_t));
+        for (uint32_t i = 0; i < slt->size; i++)
+        {
+            const char* name = slt->elements[i].name;
+            const size_t len = strlen(name);
+
+            // First one wins, same as `slwTable_getkey`
+            if (_slwTableProxy_find(proxy, name, len) >= 0)
+                continue;
+
+            uint32_t slot = (uint32_t)_slw_fnv1a(name, len) & proxy->mask;
+            while (proxy->slots[slot])
+                slot = (slot + 1) & proxy->mask;
+            proxy->slots[slot] = i + 1;
+        }
+    }
+
+    lua_pushvalue(L, mt);
+    lua_setmetatable(L, -2);
+
+    lua_pushlightuserdata(L, slt);
+    lua_pushvalue(L, -2);
+    lua_rawset(L, cache);
+}
+
+SLW_INTERNAL void
+_slwTableProxy_pushvalue(lua_State* L, const slwTableValue* el)
+{
+    if (el->ltype == LUA_TTABLE)
+    {
+        _slwTableProxy_push(L, el->value.t, lua_upvalueindex(1), lua_upvalueindex(2));
+        return;
+    }
+
+    slwState view = slwState_view(L);
+    _slwTable_push_value(&view, *el);
+}
+
+// Upvalues: metatable, cache
+SLW_INTERNAL int
+_slwTableProxy_index(lua_State* L)
+{
+    const _slwTableProxy* proxy = (const _slwTableProxy*)luaL_checkudata(L, 1, "slwTable");
+    const int64_t i = _slwTableProxy_findkey(L, proxy, 2);
+    if (i < 0)
+        return 0;
+
+    _slwTableProxy_pushvalue(L, &proxy->slt->elements[i]);
+    return 1;
+}
+
+SLW_INTERNAL int
+_slwTableProxy_newindex(lua_State* L)
+{
+    return luaL_error(L, "attempt to modify a read-only slwTable");
+}
+
+SLW_INTERNAL int
+_slwTableProxy_len(lua_State* L)
+{
+    const _slwTableProxy* proxy = (const _slwTableProxy*)luaL_checkudata(L, 1, "slwTable");
+    const slwTable* slt = proxy->slt;
+    lua_pushinteger(L, (slt->size && !slt->elements[0].name) ? (lua_Integer)slt->size : 0);
+    return 1;
+}
+
+// Upvalues: metatable, cache
+SLW_INTERNAL int
+_slwTableProxy_next(lua_State* L)
+{
+    const _slwTableProxy* proxy = (const _slwTableProxy*)luaL_checkudata(L, 1, "slwTable");
+    const slwTable* slt = proxy->slt;
+
+    int64_t i = 0;
+    if (!lua_isnoneornil(L, 2))
+    {
+        i = _slwTableProxy_findkey(L, proxy, 2);
+        if (i < 0)
+            return luaL_error(L, "invalid key to 'next'");
+        i++;
+    }
+
+    if ((size_t)i >= slt->size)
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    const slwTableValue* el = &slt->elements[i];
+    if (el->name)
+        lua_pushstring(L, el->name);
+    else
+        lua_pushinteger(L, (lua_Integer)i + 1);
+
+    _slwTableProxy_pushvalue(L, el);
+    return 2;
+}
+
+// Upvalues: next
+SLW_INTERNAL int
+_slwTableProxy_pairs(lua_State* L)
+{
+    luaL_checkudata(L, 1, "slwTable");
+    lua_pushvalue(L, lua_upvalueindex(1));
+    lua_pushvalue(L, 1);
+    lua_pushnil(L);
+    return 3;
+}
+
+// Pushes the proxy metatable and cache, creating them the first time.
+SLW_INTERNAL void
+_slwTableProxy_pushmeta(lua_State* L)
+{
+    lua_pushlightuserdata(L, (void*)&_slwProxyMetaKey);
+    lua_rawget(L, LUA_REGISTRYINDEX);
+    if (!lua_isnil(L, -1))
+    {
+        lua_pushlightuserdata(L, (void*)&_slwProxyCacheKey);
+        lua_rawget(L, LUA_REGISTRYINDEX);
+        return;
+    }
+    lua_pop(L, 1);
+
+    // `luaL_newmetatable` so `luaL_checkudata(L, i, "slwTable")` works for C functions
+    luaL_newmetatable(L, "slwTable");
+    const int mt = lua_gettop(L);
+
+    lua_newtable(L);
+    const int cache = lua_gettop(L);
+    lua_newtable(L);
+    lua_pushstring(L, "v");
+    lua_setfield(L, -2, "__mode");
+    lua_setmetatable(L, cache);
+
+    lua_pushvalue(L, mt);
+    lua_pushvalue(L, cache);
+    lua_pushcclosure(L, _slwTableProxy_index, 2);
+    lua_setfield(L, mt, "__index");
+
+    lua_pushcfunction(L, _slwTableProxy_newindex);
+    lua_setfield(L, mt, "__newindex");
+
+    lua_pushcfunction(L, _slwTableProxy_len);
+    lua_setfield(L, mt, "__len");
+
+    lua_pushvalue(L, mt);
+    lua_pushvalue(L, cache);
+    lua_pushcclosure(L, _slwTableProxy_next, 2);
+    lua_pushcclosure(L, _slwTableProxy_pairs, 1);
+    lua_setfield(L, mt, "__pairs");
+
+    lua_pushlightuserdata(L, (void*)&_slwProxyMetaKey);
+    lua_pushvalue(L, mt);
+    lua_rawset(L, LUA_REGISTRYINDEX);
+
+    lua_pushlightuserdata(L, (void*)&_slwProxyCacheKey);
+    lua_pushvalue(L, cache);
+    lua_rawset(L, LUA_REGISTRYINDEX);
+}
+
+// Shared Stores
+//----------------------------------
+SLW_INTERNAL const char _slwStoreMetaKey = 0;
+SLW_INTERNAL const char _slwStoreCacheKey = 0;
+
+#define _SLW_STORE_ALIGN(x) (((x) + 7) & ~(size_t)7)
+
+typedef struct _slwStoreTable _slwStoreTable;
+
+typedef struct _slwStoreEntry
+{
+    const char* key; // NULL in indexed tables
+    size_t keyLen;
+    uint8_t ltype;
+    size_t len;      // Strings
+    union
+    {
+        const char* s;
+        double d;
+        int64_t l;
+        bool b;
+        void* u;
+        lua_CFunction f;
+        const _slwStoreTable* t;
+    } value;
+} _slwStoreEntry;
+
+struct _slwStoreTable
+{
+    size_t size;
+    uint32_t mask;    // 0 for indexed tables
+    _slwStoreEntry* entries;
+    uint32_t* slots;  // Entry index + 1, 0 is empty
+};
+
+struct slwStore
+{
+    volatile int64_t refs;
+    const _slwStoreTable* root;
+    size_t bytes;
+};
+
+SLW_INTERNAL SLW_INLINE uint32_t
+_slwStore_capacity(const slwTable* slt)
+{
+    if (slt->size == 0 || !slt->elements[0].name)
+        return 0;
+
+    uint32_t capacity = 8;
+    while (capacity < slt->size * 2)
+        capacity <<= 1;
+    return capacity;
+}
+
+// Bytes `_slwStore_build` needs for `slt`
+SLW_INTERNAL size_t
+_slwStore_measure(const slwTable* slt, int depth)
+{
+    SLW_ASSERT(depth < SLW_RECURSION_DEPTH);
+
+    size_t bytes = _SLW_STORE_ALIGN(sizeof(_slwStoreTable))
+                 + _SLW_STORE_ALIGN(slt->size * sizeof(_slwStoreEntry))
+                 + _SLW_STORE_ALIGN(_slwStore_capacity(slt) * sizeof(uint32_t));
+
+    for (size_t i = 0; i < slt->size; i++)
+    {
+        const slwTableValue* el = &slt->elements[i];
+        if (el->name)
+            bytes += _SLW_STORE_ALIGN(strlen(el->name) + 1);
+        if (el->ltype == LUA_TSTRING && el->value.s)
+            bytes += _SLW_STORE_ALIGN(strlen(el->value.s) + 1);
+        else if (el->ltype == LUA_TTABLE && el->value.t)
+            bytes += _slwStore_measure(el->value.t, depth + 1);
+    }
+
+    return bytes;
+}
+
+SLW_INTERNAL void*
+_slwStore_take(char** cursor, size_t bytes)
+{
+    void* p = *cursor;
+    *cursor += _SLW_STORE_ALIGN(bytes);
+    return p;
+}
+
+SLW_INTERNAL const char*
+_slwStore_copystr(char** cursor, const char* str, size_t len)
+{
+    char* copy = (char*)_slwStore_take(cursor, len + 1);
+    memcpy(copy, str, len + 1);
+    return copy;
+}
+
+SLW_INTERNAL const _slwStoreEntry*
+_slwStore_find(const _slwStoreTable* tbl, const char* key, size_t len)
+{
+    if (!tbl->mask)
+        return NULL;
+
+    for (uint32_t slot = (uint32_t)_slw_fnv1a(key, len) & tbl->mask; tbl->slots[slot]; slot = (slot + 1) & tbl->mask)
+    {
+        const _slwStoreEntry* entry = &tbl->entries[tbl->slots[slot] - 1];
+        if (entry->keyLen == len && memcmp(entry->key, key, len) == 0)
+            return entry;
+    }
+    return NULL;
+}
+
+SLW_INTERNAL const _slwStoreTable*
+_slwStore_build(char** cursor, const slwTable* slt)
+{
+    _slwStoreTable* tbl = (_slwStoreTable*)_slwStore_take(cursor, sizeof(_slwStoreTable));
+    const uint32_t capacity = _slwStore_capacity(slt);
+
+    tbl->size = slt->size;
+    tbl->mask = capacity ? capacity - 1 : 0;
+    tbl->entries = (_slwStoreEntry*)_slwStore_take(cursor, slt->size * sizeof(_slwStoreEntry));
+    tbl->slots = (uint32_t*)_slwStore_take(cursor, capacity * sizeof(uint32_t));
+    memset(tbl->slots, 0, capacity * sizeof(uint32_t));
+
+    for (size_t i = 0; i < slt->size; i++)
+    {
+        const slwTableValue* el = &slt->elements[i];
+        _slwStoreEntry* entry = &tbl->entries[i];
+        memset(entry, 0, sizeof(_slwStoreEntry));
+        entry->ltype = el->ltype;
+
+        switch (el->ltype)
+        {
+            case LUA_TSTRING:
+                entry->len = el->value.s ? strlen(el->value.s) : 0;
+                entry->value.s = el->value.s ? _slwStore_copystr(cursor, el->value.s, entry->len) : "";
+                break;
+            case LUA_TNUMBER:
+                entry->value.d = el->value.d;
+                break;
+            case slw_tinteger:
+                entry->value.l = el->value.l;
+                break;
+            case LUA_TBOOLEAN:
+                entry->value.b = el->value.b;
+                break;
+            case LUA_TTABLE:
+                entry->value.t = el->value.t ? _slwStore_build(cursor, el->value.t) : NULL;
+                if (!entry->value.t)
+                    entry->ltype = LUA_TNIL;
+                break;
+            case LUA_TLIGHTUSERDATA:
+                entry->value.u = el->value.u;
+                break;
+            case LUA_TFUNCTION:
+                entry->value.f = el->value.f;
+                break;
+            default:
+                entry->ltype = LUA_TNIL;
+                break;
+        }
+
+        if (!el->name)
+            continue;
+
+        entry->keyLen = strlen(el->name);
+        entry->key = _slwStore_copystr(cursor, el->name, entry->keyLen);
+
+        // First one wins, same as `slwTable_getkey`
+        if (capacity && !_slwStore_find(tbl, entry->key, entry->keyLen))
+        {
+            uint32_t slot = (uint32_t)_slw_fnv1a(entry->key, entry->keyLen) & tbl->mask;
+            while (tbl->slots[slot])
+                slot = (slot + 1) & tbl->mask;
+            tbl->slots[slot] = (uint32_t)i + 1;
+        }
+    }
+
+    return tbl;
+}
+
+// Lua views, the userdata holds a reference to the store until it's collected
+typedef struct _slwStoreView
+{
+    slwStore* store;
+    const _slwStoreTable* tbl;
+} _slwStoreView;
+
+// Entry for the key at `idx` or NULL
+SLW_INTERNAL const _slwStoreEntry*
+_slwStoreView_findkey(lua_State* L, const _slwStoreTable* tbl, int idx)
+{
+    if (tbl->size == 0)
+        return NULL;
+
+    if (!tbl->mask)
+    {
+        if (lua_type(L, idx) != LUA_TNUMBER)
+            return NULL;
+
+        const lua_Integer i = lua_tointeger(L, idx);
+        return (i >= 1 && (size_t)i <= tbl->size && (lua_Number)i == lua_tonumber(L, idx)) ? &tbl->entries[i - 1] : NULL;
+    }
+
+    if (lua_type(L, idx) != LUA_TSTRING)
+        return NULL;
+
+    size_t len;
+    const char* key = lua_tolstring(L, idx, &len);
+    return _slwStore_find(tbl, key, len);
+}
+
+// Pushes the view of `tbl`, the metatable and the cache are at `mt` and `cache`
+SLW_INTERNAL void
+_slwStoreView_push(lua_State* L, slwStore* store, const _slwStoreTable* tbl, int mt, int cache)
+{
+    lua_pushlightuserdata(L, (void*)tbl);
+    lua_rawget(L, cache);
+    if (!lua_isnil(L, -1) && ((const _slwStoreView*)lua_touserdata(L, -1))->tbl)
+        return;
+    lua_pop(L, 1);
+
+    _slwStoreView* view = (_slwStoreView*)lua_newuserdata(L, sizeof(_slwStoreView));
+    view->store = slwStore_retain(store);
+    view->tbl = tbl;
+
+    lua_pushvalue(L, mt);
+    lua_setmetatable(L, -2);
+
+    lua_pushlightuserdata(L, (void*)tbl);
+    lua_pushvalue(L, -2);
+    lua_rawset(L, cache);
+}
+
+// Upvalues: metatable, cache
+SLW_INTERNAL void
+_slwStoreView_pushvalue(lua_State* L, slwStore* store, const _slwStoreEntry* entry)
+{
+    switch (entry->ltype)
+    {
+        case LUA_TSTRING:
+            lua_pushlstring(L, entry->value.s, entry->len);
+            break;
+        case LUA_TNUMBER:
+            lua_pushnumber(L, entry->value.d);
+            break;
+        case slw_tinteger:
+            lua_pushinteger(L, (lua_Integer)entry->value.l);
+            break;
+        case LUA_TBOOLEAN:
+            lua_pushboolean(L, entry->value.b);
+            break;
+        case LUA_TTABLE:
+            _slwStoreView_push(L, store, entry->value.t, lua_upvalueindex(1), lua_upvalueindex(2));
+            break;
+        case LUA_TLIGHTUSERDATA:
+            lua_pushlightuserdata(L, entry->value.u);
+            break;
+        case LUA_TFUNCTION:
+            lua_pushcfunction(L, entry->value.f);
+            break;
+        default:
+            lua_pushnil(L);
+            break;
+    }
+}
+
+// The view at 1, raises an error for anything else or a view `__gc` already released
+SLW_INTERNAL const _slwStoreView*
+_slwStoreView_check(lua_State* L)
+{
+    const _slwStoreView* view = (const _slwStoreView*)luaL_checkudata(L, 1, "slwStore");
+    if (!view->tbl)
+        luaL_error(L, "attempt to use a released slwStore");
+    return view;
+}
+
+// Upvalues: metatable, cache
+SLW_INTERNAL int
+_slwStoreView_index(lua_State* L)
+{
+    const _slwStoreView* view = _slwStoreView_check(L);
+    const _slwStoreEntry* entry = _slwStoreView_findkey(L, view->tbl, 2);
+    if (!entry)
+        return 0;
+
+    _slwStoreView_pushvalue(L, view->store, entry);
+    return 1;
+}
+
+SLW_INTERNAL int
+_slwStoreView_newindex(lua_State* L)
+{
+    return luaL_error(L, "attempt to modify a read-only slwStore");
+}
+
+SLW_INTERNAL int
+_slwStoreView_len(lua_State* L)
+{
+    const _slwStoreView* view = _slwStoreView_check(L);
+    lua_pushinteger(L, view->tbl->mask ? 0 : (lua_Integer)view->tbl->size);
+    return 1;
+}
+
+// Upvalues: metatable, cache
+SLW_INTERNAL int
+_slwStoreView_next(lua_State* L)
+{
+    const _slwStoreView* view = _slwStoreView_check(L);
+    const _slwStoreTable* tbl = view->tbl;
+
+    size_t i = 0;
+    if (!lua_isnoneornil(L, 2))
+    {
+        const _slwStoreEntry* entry = _slwStoreView_findkey(L, tbl, 2);
+        if (!entry)
+            return luaL_error(L, "invalid key to 'next'");
+        i = (size_t)(entry - tbl->entries) + 1;
+    }
+
+    if (i >= tbl->size)
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    const _slwStoreEntry* entry = &tbl->entries[i];
+    if (entry->key)
+        lua_pushlstring(L, entry->key, entry->keyLen);
+    else
+        lua_pushinteger(L, (lua_Integer)i + 1);
+
+    _slwStoreView_pushvalue(L, view->store, entry);
+    return 2;
+}
+
+// Upvalues: next
+SLW_INTERNAL int
+_slwStoreView_pairs(lua_State* L)
+{
+    (void)_slwStoreView_check(L);
+    lua_pushvalue(L, lua_upvalueindex(1));
+    lua_pushvalue(L, 1);
+    lua_pushnil(L);
+    return 3;
+}
+
+SLW_INTERNAL int
+_slwStoreView_gc(lua_State* L)
+{
+    _slwStoreView* view = (_slwStoreView*)luaL_checkudata(L, 1, "slwStore");
+    if (view->store)
+        slwStore_release(view->store);
+    view->store = NULL;
+    view->tbl = NULL;
+    return 0;
+}
+
+// Pushes the view metatable and cache, creating them the first time.
+SLW_INTERNAL void
+_slwStoreView_pushmeta(lua_State* L)
+{
+    lua_pushlightuserdata(L, (void*)&_slwStoreMetaKey);
+    lua_rawget(L, LUA_REGISTRYINDEX);
+    if (!lua_isnil(L, -1))
+    {
+        lua_pushlightuserdata(L, (void*)&_slwStoreCacheKey);
+        lua_rawget(L, LUA_REGISTRYINDEX);
+        return;
+    }
+    lua_pop(L, 1);
+
+    luaL_newmetatable(L, "slwStore");
+    const int mt = lua_gettop(L);
+
+    lua_newtable(L);
+    const int cache = lua_gettop(L);
+    lua_newtable(L);
+    lua_pushstring(L, "v");
+    lua_setfield(L, -2, "__mode");
+    lua_setmetatable(L, cache);
+
+    lua_pushvalue(L, mt);
+    lua_pushvalue(L, cache);
+    lua_pushcclosure(L, _slwStoreView_index, 2);
+    lua_setfield(L, mt, "__index");
+
+    lua_pushcfunction(L, _slwStoreView_newindex);
+    lua_setfield(L, mt, "__newindex");
+
+    lua_pushcfunction(L, _slwStoreView_len);
+    lua_setfield(L, mt, "__len");
+
+    lua_pushcfunction(L, _slwStoreView_gc);
+    lua_setfield(L, mt, "__gc");
+
+    // Keeps `__gc` out of reach of scripts
+    lua_pushliteral(L, "slwStore");
+    lua_setfield(L, mt, "__metatable");
+
+    lua_pushvalue(L, mt);
+    lua_pushvalue(L, cache);
+    lua_pushcclosure(L, _slwStoreView_next, 2);
+    lua_pushcclosure(L, _slwStoreView_pairs, 1);
+    lua_setfield(L, mt, "__pairs");
+
+    lua_pushlightuserdata(L, (void*)&_slwStoreMetaKey);
+    lua_pushvalue(L, mt);
+    lua_rawset(L, LUA_REGISTRYINDEX);
+
+    lua_pushlightuserdata(L, (void*)&_slwStoreCacheKey);
+    lua_pushvalue(L, cache);
+    lua_rawset(L, LUA_REGISTRYINDEX);
+}
+
+// Binary Values
+//----------------------------------
+// nil, booleans, integers, numbers, strings and tables of those. Tables are the array part (values only)
+// followed by the remaining key/value pairs.
+#define _SLW_VALUE_NIL   0
+#define _SLW_VALUE_FALSE 1
+#define _SLW_VALUE_TRUE  2
+#define _SLW_VALUE_INT   3 // Zigzag varint
+#define _SLW_VALUE_NUM   4 // 8 bytes
+#define _SLW_VALUE_STR   5 // Varint length, bytes
+#define _SLW_VALUE_TABLE 6 // Varint array count, u32 pair count, values, pairs
+
+// Encode errors, otherwise it's the Lua type of the value that can't be encoded
+#define _SLW_VALUE_OK       0
+#define _SLW_VALUE_TOODEEP -1
+#define _SLW_VALUE_NOMEM   -2
+
+SLW_INTERNAL int
+_slwValue_encode(lua_State* L, int idx, _slwBuffer* buf, int depth)
+{
+    idx = lua_absindex(L, idx);
+    const int type = lua_type(L, idx);
+    bool ok = true;
+
+    switch (type)
+    {
+        case LUA_TNIL:
+            ok = _slwBuffer_byte(buf, _SLW_VALUE_NIL);
+            break;
+        case LUA_TBOOLEAN:
+            ok = _slwBuffer_byte(buf, lua_toboolean(L, idx) ? _SLW_VALUE_TRUE : _SLW_VALUE_FALSE);
+            break;
+        case LUA_TNUMBER:
+            if (lua_isinteger(L, idx))
+            {
+                const int64_t n = (int64_t)lua_tointeger(L, idx);
+                ok = _slwBuffer_byte(buf, _SLW_VALUE_INT) && _slwBuffer_varint(buf, ((uint64_t)n << 1) ^ (uint64_t)(n >> 63));
+            } else
+            {
+                const double d = (double)lua_tonumber(L, idx);
+                ok = _slwBuffer_byte(buf, _SLW_VALUE_NUM) && _slwBuffer_write(buf, &d, sizeof(d));
+            }
+            break;
+        case LUA_TSTRING:
+        {
+            size_t len;
+            const char* str = lua_tolstring(L, idx, &len);
+            ok = _slwBuffer_byte(buf, _SLW_VALUE_STR) && _slwBuffer_varint(buf, len) && _slwBuffer_write(buf, str, len);
+            break;
+        }
+        case LUA_TTABLE:
+        {
+            if (depth >= SLW_RECURSION_DEPTH || !lua_checkstack(L, 3))
+                return _SLW_VALUE_TOODEEP;
+
+#if LUA_VERSION_NUM > 501
+            const size_t count = lua_rawlen(L, idx);
+#else
+            const size_t count = lua_objlen(L, idx);
+#endif
+            const uint32_t zero = 0;
+            if (!_slwBuffer_byte(buf, _SLW_VALUE_TABLE) || !_slwBuffer_varint(buf, count))
+                return _SLW_VALUE_NOMEM;
+
+            const size_t pairsAt = buf->size;
+            if (!_slwBuffer_write(buf, &zero, sizeof(zero)))
+                return _SLW_VALUE_NOMEM;
+
+            for (size_t i = 1; i <= count; i++)
+            {
+                lua_rawgeti(L, idx, (lua_Integer)i);
+                const int err = _slwValue_encode(L, -1, buf, depth + 1);
+                lua_pop(L, 1);
+                if (err != _SLW_VALUE_OK)
+                    return err;
+            }
+
+            uint32_t pairs = 0;
+            lua_pushnil(L);
+            while (lua_next(L, idx) != 0)
+            {
+                // Already in the array part
+                if (lua_type(L, -2) == LUA_TNUMBER && lua_isinteger(L, -2))
+                {
+                    const lua_Integer i = lua_tointeger(L, -2);
+                    if (i >= 1 && (size_t)i <= count)
+                    {
+                        lua_pop(L, 1);
+                        continue;
+                    }
+                }
+
+                int err = _slwValue_encode(L, -2, buf, depth + 1);
+                if (err == _SLW_VALUE_OK)
+                    err = _slwValue_encode(L, -1, buf, depth + 1);
+                lua_pop(L, 1);
+                if (err != _SLW_VALUE_OK)
+                {
+                    lua_pop(L, 1);
+                    return err;
+                }
+                pairs++;
+            }
+
+            memcpy(buf->data + pairsAt, &pairs, sizeof(pairs));
+            break;
+        }
+        default:
+            return type;
+    }
+
+    return ok ? _SLW_VALUE_OK : _SLW_VALUE_NOMEM;
+}
+
+// Pushes the value at `*p`, returns false for malformed input (nothing pushed)
+SLW_INTERNAL bool
+_slwValue_decode(lua_State* L, const uint8_t** p, const uint8_t* end, int depth)
+{
+    if (*p >= end || depth >= SLW_RECURSION_DEPTH || !lua_checkstack(L, 3))
+        return false;
+
+    uint64_t n;
+    switch (*(*p)++)
+    {
+        case _SLW_VALUE_NIL:
+            lua_pushnil(L);
+            return true;
+        case _SLW_VALUE_FALSE:
+            lua_pushboolean(L, 0);
+            return true;
+        case _SLW_VALUE_TRUE:
+            lua_pushboolean(L, 1);
+            return true;
+        case _SLW_VALUE_INT:
+            if (!_slw_readvarint(p, end, &n))
+                return false;
+            lua_pushinteger(L, (lua_Integer)(int64_t)((n >> 1) ^ (~(n & 1) + 1)));
+            return true;
+        case _SLW_VALUE_NUM:
+        {
+            double d;
+            if ((size_t)(end - *p) < sizeof(d))
+                return false;
+            memcpy(&d, *p, sizeof(d));
+            *p += sizeof(d);
+            lua_pushnumber(L, (lua_Number)d);
+            return true;
+        }
+        case _SLW_VALUE_STR:
+            if (!_slw_readvarint(p, end, &n) || (uint64_t)(end - *p) < n)
+                return false;
+            lua_pushlstring(L, (const char*)*p, (size_t)n);
+            *p += n;
+            return true;
+        case _SLW_VALUE_TABLE:
+        {
+            uint32_t pairs;
+            if (!_slw_readvarint(p, end, &n) || (size_t)(end - *p) < sizeof(pairs))
+                return false;
+            memcpy(&pairs, *p, sizeof(pairs));
+            *p += sizeof(pairs);
+
+            lua_createtable(L, n > INT_MAX ? 0 : (int)n, pairs > INT_MAX ? 0 : (int)pairs);
+            for (uint64_t i = 1; i <= n; i++)
+            {
+                if (!_slwValue_decode(L, p, end, depth + 1))
+                {
+                    lua_pop(L, 1);
+                    return false;
+                }
+                lua_rawseti(L, -2, (lua_Integer)i);
+            }
+
+            for (uint32_t i = 0; i < pairs; i++)
+            {
+                if (!_slwValue_decode(L, p, end, depth + 1))
+                {
+                    lua_pop(L, 1);
+                    return false;
+                }
+                if (!_slwValue_decode(L, p, end, depth + 1))
+                {
+                    lua_pop(L, 2);
+                    return false;
+                }
+
+                if (lua_isnil(L, -2))
+                    lua_pop(L, 2);
+                else
+                    lua_rawset(L, -3);
+            }
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+// Channels
+//----------------------------------
+// Bounded MPMC queue by Dmitry Vyukov, every cell has a sequence number telling producers and consumers whose turn it is.
+// SPSC channels use the same cells, just without the compare-and-swap.
+#define _SLW_CACHELINE 64
+
+typedef struct _slwChannelCell
+{
+    volatile uint64_t seq;
+    uint8_t* data;
+    size_t size;
+} _slwChannelCell;
+
+struct slwChannel
+{
+    volatile int64_t refs;
+    volatile uint64_t closed;
+    uint32_t mode;
+    uint64_t mask;
+
+    // Producers and consumers each get their own cache line
+    char pad0[_SLW_CACHELINE];
+    volatile uint64_t head;
+    char pad1[_SLW_CACHELINE - sizeof(uint64_t)];
+    volatile uint64_t tail;
+    char pad2[_SLW_CACHELINE - sizeof(uint64_t)];
+
+    _slwChannelCell cells[];
+};
+
+SLW_INTERNAL bool
+_slwChannel_enqueue(slwChannel* ch, uint8_t* data, size_t size)
+{
+    _slwChannelCell* cell;
+    uint64_t pos = _slw_atomic_load(&ch->head);
+    for (;;)
+    {
+        cell = &ch->cells[pos & ch->mask];
+        const int64_t diff = (int64_t)(_slw_atomic_load(&cell->seq) - pos);
+        if (diff == 0)
+        {
+            if (ch->mode == slw_channel_spsc)
+            {
+                _slw_atomic_store(&ch->head, pos + 1);
+                break;
+            }
+            if (_slw_atomic_cas(&ch->head, pos, pos + 1))
+                break;
+        } else if (diff < 0)
+        {
+            return false;
+        }
+        pos = _slw_atomic_load(&ch->head);
+    }
+
+    cell->data = data;
+    cell->size = size;
+    _slw_atomic_store(&cell->seq, pos + 1);
+    return true;
+}
+
+SLW_INTERNAL bool
+_slwChannel_dequeue(slwChannel* ch, uint8_t** data, size_t* size)
+{
+    _slwChannelCell* cell;
+    uint64_t pos = _slw_atomic_load(&ch->tail);
+    for (;;)
+    {
+        cell = &ch->cells[pos & ch->mask];
+        const int64_t diff = (int64_t)(_slw_atomic_load(&cell->seq) - (pos + 1));
+        if (diff == 0)
+        {
+            if (ch->mode == slw_channel_spsc)
+            {
+                _slw_atomic_store(&ch->tail, pos + 1);
+                break;
+            }
+            if (_slw_atomic_cas(&ch->tail, pos, pos + 1))
+                break;
+        } else if (diff < 0)
+        {
+            return false;
+        }
+        pos = _slw_atomic_load(&ch->tail);
+    }
+
+    *data = cell->data;
+    *size = cell->size;
+    _slw_atomic_store(&cell->seq, pos + ch->mask + 1);
+    return true;
+}
+
+// Encodes the value at `idx` into `buf`, raising a Lua error if it can't be sent
+SLW_INTERNAL void
+_slwChannel_encode_or_error(lua_State* L, int idx, _slwBuffer* buf)
+{
+    const int err = _slwValue_encode(L, idx, buf, 0);
+    if (err == _SLW_VALUE_OK)
+        return;
+
+    slw_free(buf->data);
+    if (err == _SLW_VALUE_TOODEEP)
+        luaL_error(L, "can't send a table nested deeper than %d (or with a cycle)", SLW_RECURSION_DEPTH);
+    else if (err == _SLW_VALUE_NOMEM)
+        luaL_error(L, "not enough memory");
+    else
+        luaL_error(L, "can't send a %s value", lua_typename(L, err));
+}
+
+// Pushes the decoded message and frees it
+SLW_INTERNAL bool
+_slwChannel_pushmessage(lua_State* L, uint8_t* data, size_t size)
+{
+    const uint8_t* p = data;
+    const bool ok = _slwValue_decode(L, &p, data + size, 0);
+    slw_free(data);
+    return ok;
+}
+
+SLW_INTERNAL slwChannel*
+_slwChannel_self(lua_State* L)
+{
+    slwState view = slwState_view(L);
+    return *(slwChannel**)slwClass_check(&view, 1);
+}
+
+#if LUA_VERSION_NUM >= 503
+    #define _SLW_CHANNEL_CANYIELD(L) lua_isyieldable(L)
+#else
+    #define _SLW_CHANNEL_CANYIELD(L) 0
+#endif
+
+SLW_INTERNAL int _slwChannel_send(lua_State* L, slwChannel* ch, _slwBuffer buf);
+SLW_INTERNAL int _slwChannel_lrecv(lua_State* L);
+
+#if LUA_VERSION_NUM >= 503
+// The message was encoded before yielding and left at 3, it's only copied back out
+SLW_INTERNAL int
+_slwChannel_lsend_k(lua_State* L, int status, lua_KContext ctx)
+{
+    (void)status;
+    (void)ctx;
+    lua_settop(L, 3);
+
+    size_t size;
+    const char* data = lua_tolstring(L, 3, &size);
+    _slwBuffer buf = { 0 };
+    if (!_slwBuffer_write(&buf, data, size))
+        return luaL_error(L, "not enough memory");
+    return _slwChannel_send(L, _slwChannel_self(L), buf);
+}
+
+SLW_INTERNAL int
+_slwChannel_lrecv_k(lua_State* L, int status, lua_KContext ctx)
+{
+    (void)status;
+    (void)ctx;
+    lua_settop(L, 1);
+    return _slwChannel_lrecv(L);
+}
+#endif
+
+// Retries pushing the encoded message until it's queued, the queue owns `buf` once it is
+SLW_INTERNAL int
+_slwChannel_send(lua_State* L, slwChannel* ch, _slwBuffer buf)
+{
+    uint32_t spins = 0;
+    for (;;)
+    {
+        if (_slw_atomic_load(&ch->closed))
+        {
+            slw_free(buf.data);
+            return luaL_error(L, "send on a closed channel");
+        }
+
+        if (_slwChannel_enqueue(ch, buf.data, buf.size))
+        {
+            lua_pushboolean(L, 1);
+            return 1;
+        }
+
+#if LUA_VERSION_NUM >= 503
+        if (_SLW_CHANNEL_CANYIELD(L))
+        {
+            lua_settop(L, 2);
+            lua_pushlstring(L, (const char*)buf.data, buf.size);
+            slw_free(buf.data);
+            lua_pushvalue(L, 1);
+            return lua_yieldk(L, 1, 0, _slwChannel_lsend_k);
+        }
+#endif
+        _slw_backoff(&spins);
+    }
+}
+
+SLW_INTERNAL int
+_slwChannel_lsend(lua_State* L)
+{
+    slwChannel* ch = _slwChannel_self(L);
+    luaL_checkany(L, 2);
+
+    if (_slw_atomic_load(&ch->closed))
+        return luaL_error(L, "send on a closed channel");
+
+    _slwBuffer buf = { 0 };
+    _slwChannel_encode_or_error(L, 2, &buf);
+    return _slwChannel_send(L, ch, buf);
+}
+
+SLW_INTERNAL int
+_slwChannel_ltrysend(lua_State* L)
+{
+    slwChannel* ch = _slwChannel_self(L);
+    luaL_checkany(L, 2);
+
+    if (_slw_atomic_load(&ch->closed))
+    {
+        lua_pushboolean(L, 0);
+        return 1;
+    }
+
+    _slwBuffer buf = { 0 };
+    _slwChannel_encode_or_error(L, 2, &buf);
+    const bool sent = _slwChannel_enqueue(ch, buf.data, buf.size);
+    if (!sent)
+        slw_free(buf.data);
+
+    lua_pushboolean(L, sent);
+    return 1;
+}
+
+SLW_INTERNAL int
+_slwChannel_lrecv(lua_State* L)
+{
+    slwChannel* ch = _slwChannel_self(L);
+
+    uint32_t spins = 0;
+    for (;;)
+    {
+        uint8_t* data;
+        size_t size;
+        if (_slwChannel_dequeue(ch, &data, &size) ||
+            (_slw_atomic_load(&ch->closed) && _slwChannel_dequeue(ch, &data, &size)))
+        {
+            if (!_slwChannel_pushmessage(L, data, size))
+                return luaL_error(L, "malformed channel message");
+            return 1;
+        }
+
+        if (_slw_atomic_load(&ch->closed))
+            return 0;
+
+#if LUA_VERSION_NUM >= 503
+        if (_SLW_CHANNEL_CANYIELD(L))
+        {
+            lua_pushvalue(L, 1);
+            return lua_yieldk(L, 1, 0, _slwChannel_lrecv_k);
+        }
+#endif
+        _slw_backoff(&spins);
+    }
+}
+
+SLW_INTERNAL int
+_slwChannel_ltryrecv(lua_State* L)
+{
+    slwChannel* ch = _slwChannel_self(L);
+
+    uint8_t* data;
+    size_t size;
+    if (!_slwChannel_dequeue(ch, &data, &size))
+    {
+        lua_pushboolean(L, 0);
+        return 1;
+    }
+
+    lua_pushboolean(L, 1);
+    if (!_slwChannel_pushmessage(L, data, size))
+        return luaL_error(L, "malformed channel message");
+    return 2;
+}
+
+SLW_INTERNAL int
+_slwChannel_lclose(lua_State* L)
+{
+    slwChannel_close(_slwChannel_self(L));
+    return 0;
+}
+
+SLW_INTERNAL void
+_slwChannel_gc(void* self)
+{
+    slwChannel_release(*(slwChannel**)self);
+}
+
+SLW_INTERNAL const slwClassMethod _slwChannelMethods[] = {
+    { "send",     _slwChannel_lsend },
+    { "try_send", _slwChannel_ltrysend },
+    { "recv",     _slwChannel_lrecv },
+    { "try_recv", _slwChannel_ltryrecv },
+    { "close",    _slwChannel_lclose },
+    { NULL, NULL }
+};
+
+SLW_INTERNAL const slwClass _slwChannelClass = {
+    .name = "slwChannel",
+    .size = sizeof(slwChannel*),
+    .methods = _slwChannelMethods,
+    .gc = _slwChannel_gc,
+};
+
+// State Cloning
+//----------------------------------
+// C closure upvalues are the one thing that can't be remembered before they're copied, so cycles through them are cut here.
+#define _SLW_CLONE_MAX_DEPTH 200
+
+typedef struct _slwClone
+{
+    lua_State* from;
+    lua_State* to;
+    slwState* slw;  // Wraps `to`
+    int seen;   // In `from`: object -> id
+    int made;   // In `to`: id -> object, upvalue id -> { function, index }
+    int nextId;
+    int depth;
+} _slwClone;
+
+typedef struct _slwCloneLib
+{
+    const char* name;
+    uint32_t flag;
+} _slwCloneLib;
+
+SLW_INTERNAL const _slwCloneLib _slwCloneLibs[] = {
+    { "package",   slw_lib_package },
+    { "table",     slw_lib_table },
+    { "string",    slw_lib_string },
+    { "math",      slw_lib_math },
+    { "debug",     slw_lib_debug },
+    { "io",        slw_lib_io },
+    { "coroutine", slw_lib_coroutine },
+    { "os",        slw_lib_os },
+    { "utf8",      slw_lib_utf8 },
+    { "bit32",     slw_lib_bit32 },
+    { "jit",       slw_lib_jit },
+    { "ffi",       slw_lib_ffi },
+    { "msgpack",   slw_lib_msgpack },
+    { "json",      slw_lib_json },
+    { "cslw",      slw_lib_cslw },
+    { NULL, 0 }
+};
+
+// Maps the objects at `fromIdx` and `toIdx` to each other
+SLW_INTERNAL void
+_slwClone_remember(_slwClone* c, int fromIdx, int toIdx)
+{
+    const int id = ++c->nextId;
+
+    lua_pushvalue(c->from, fromIdx);
+    lua_pushinteger(c->from, id);
+    lua_rawset(c->from, c->seen);
+
+    lua_pushvalue(c->to, toIdx);
+    lua_rawseti(c->to, c->made, id);
+}
+
+SLW_INTERNAL int
+_slwClone_writer(lua_State* L, const void* p, size_t size, void* ud)
+{
+    (void)L;
+    return _slwBuffer_write((_slwBuffer*)ud, p, size) ? 0 : 1;
+}
+
+SLW_INTERNAL bool _slwClone_value(_slwClone* c, int idx);
+
+// Copies the upvalues of the Lua function at `fromIdx` into the one at the top of `to`
+SLW_INTERNAL bool
+_slwClone_upvalues(_slwClone* c, int fromIdx)
+{
+    const int fn = lua_gettop(c->to);
+    for (int i = 1; lua_getupvalue(c->from, fromIdx, i) != NULL; i++)
+    {
+#if LUA_VERSION_NUM >= 502
+        // Shared with a closure that was copied already, join the copies too
+        void* id = lua_upvalueid(c->from, fromIdx, i);
+        lua_pushlightuserdata(c->to, id);
+        lua_rawget(c->to, c->made);
+        if (lua_istable(c->to, -1))
+        {
+            lua_rawgeti(c->to, -1, 1);
+            lua_rawgeti(c->to, -2, 2);
+            lua_upvaluejoin(c->to, fn, i, -2, (int)lua_tointeger(c->to, -1));
+            lua_pop(c->to, 3);
+            lua_pop(c->from, 1);
+            continue;
+        }
+        lua_pop(c->to, 1);
+
+        lua_pushlightuserdata(c->to, id);
+        lua_createtable(c->to, 2, 0);
+        lua_pushvalue(c->to, fn);
+        lua_rawseti(c->to, -2, 1);
+        lua_pushinteger(c->to, i);
+        lua_rawseti(c->to, -2, 2);
+        lua_rawset(c->to, c->made);
+#endif
+
+        const bool ok = _slwClone_value(c, -1);
+        lua_pop(c->from, 1);
+        if (!ok)
+            return false;
+
+        lua_setupvalue(c->to, fn, i);
+    }
+
+    return true;
+}
+
+// Copies the pairs and metatable of the table at `fromIdx` into the one at `toIdx`.
+// Merging keeps the tables, functions and userdata the target has already (a fresh state's libraries).
+SLW_INTERNAL bool
+_slwClone_fill(_slwClone* c, int fromIdx, int toIdx, bool merge)
+{
+    lua_State* from = c->from;
+    lua_State* to = c->to;
+    fromIdx = lua_absindex(from, fromIdx);
+    toIdx = lua_absindex(to, toIdx);
+
+    lua_pushnil(from);
+    while (lua_next(from, fromIdx) != 0)
+    {
+        if (!_slwClone_value(c, -2))
+        {
+            lua_pop(from, 2);
+            return false;
+        }
+
+        if (merge)
+        {
+            lua_pushvalue(to, -1);
+            lua_rawget(to, toIdx);
+            const int type = lua_type(to, -1);
+            lua_pop(to, 1);
+            if (type == LUA_TTABLE || type == LUA_TFUNCTION || type == LUA_TUSERDATA)
+            {
+                lua_pop(to, 1);
+                lua_pop(from, 1);
+                continue;
+            }
+        }
+
+        if (!_slwClone_value(c, -1))
+        {
+            lua_pop(to, 1);
+            lua_pop(from, 2);
+            return false;
+        }
+
+        lua_rawset(to, toIdx);
+        lua_pop(from, 1);
+    }
+
+    if (lua_getmetatable(from, fromIdx))
+    {
+        const bool ok = _slwClone_value(c, -1);
+        lua_pop(from, 1);
+        if (!ok)
+            return false;
+
+        lua_setmetatable(to, toIdx);
+    }
+
+    return true;
+}
+
+// Pushes a copy of the value at `idx` in `from` onto `to`, returns false (nothing pushed) if it can't be copied
+SLW_INTERNAL bool
+_slwClone_value(_slwClone* c, int idx)
+{
+    lua_State* from = c->from;
+    lua_State* to = c->to;
+    idx = lua_absindex(from, idx);
+
+    if (!lua_checkstack(from, 8) || !lua_checkstack(to, 8))
+        return false;
+
+    const int type = lua_type(from, idx);
+    switch (type)
+    {
+        case LUA_TNIL:
+            lua_pushnil(to);
+            return true;
+        case LUA_TBOOLEAN:
+            lua_pushboolean(to, lua_toboolean(from, idx));
+            return true;
+        case LUA_TNUMBER:
+            if (lua_isinteger(from, idx))
+                lua_pushinteger(to, lua_tointeger(from, idx));
+            else
+                lua_pushnumber(to, lua_tonumber(from, idx));
+            return true;
+        case LUA_TSTRING:
+        {
+            size_t len;
+            const char* str = lua_tolstring(from, idx, &len);
+            lua_pushlstring(to, str, len);
+            return true;
+        }
+        case LUA_TLIGHTUSERDATA:
+            lua_pushlightuserdata(to, lua_touserdata(from, idx));
+            return true;
+        case LUA_TTABLE:
+        case LUA_TFUNCTION:
+            break;
+        default:
+            return false;
+    }
+
+    lua_pushvalue(from, idx);
+    lua_rawget(from, c->seen);
+    const int id = (int)lua_tointeger(from, -1);
+    lua_pop(from, 1);
+    if (id)
+    {
+        lua_rawgeti(to, c->made, id);
+        return true;
+    }
+
+    if (c->depth >= _SLW_CLONE_MAX_DEPTH)
+        return false;
+    c->depth++;
+
+    bool ok = true;
+    if (type == LUA_TTABLE)
+    {
+        lua_newtable(to);
+        _slwClone_remember(c, idx, lua_gettop(to));
+        ok = _slwClone_fill(c, idx, -1, false);
+    } else if (lua_iscfunction(from, idx))
+    {
+        int count = 0;
+        while (lua_getupvalue(from, idx, count + 1) != NULL)
+        {
+            lua_pop(from, 1);
+            count++;
+        }
+
+        // A stats wrapper's last upvalue is a record `from` frees, it's wrapped again against the clone's
+        const slwCStats* stats = NULL;
+#if SLW_ENABLE_CSTATS
+        if (lua_tocfunction(from, idx) == _slwCStats_call)
+        {
+            lua_getupvalue(from, idx, count--);
+            stats = (const slwCStats*)lua_touserdata(from, -1);
+            lua_pop(from, 1);
+        }
+#endif
+
+        int n = 0;
+        while (ok && n < count)
+        {
+            lua_getupvalue(from, idx, n + 1);
+            ok = _slwClone_value(c, -1);
+            lua_pop(from, 1);
+            n += ok;
+        }
+
+        if (ok)
+        {
+            if (stats)
+                _slw_pushcclosure(c->slw, stats->name, stats->fn, n);
+            else
+                lua_pushcclosure(to, lua_tocfunction(from, idx), n);
+            _slwClone_remember(c, idx, lua_gettop(to));
+        } else
+        {
+            lua_pop(to, n);
+        }
+    } else
+    {
+        _slwBuffer buf = { 0 };
+        lua_pushvalue(from, idx);
+#if LUA_VERSION_NUM >= 503
+        ok = lua_dump(from, _slwClone_writer, &buf, 0) == 0;
+#else
+        ok = lua_dump(from, _slwClone_writer, &buf) == 0;
+#endif
+        lua_pop(from, 1);
+
+        ok = ok && luaL_loadbuffer(to, (const char*)buf.data, buf.size, "=clone") == 0;
+        slw_free(buf.data);
+        if (ok)
+        {
+            _slwClone_remember(c, idx, lua_gettop(to));
+            ok = _slwClone_upvalues(c, idx);
+        } else
+        {
+            // The load error message
+            lua_pop(to, lua_gettop(to) > 0 && lua_isstring(to, -1));
+        }
+    }
+
+    c->depth--;
+    if (!ok && type == LUA_TTABLE)
+        lua_pop(to, 1);
+    else if (!ok && type == LUA_TFUNCTION && lua_isfunction(to, -1))
+        lua_pop(to, 1);
+    return ok;
+}
+
+// Libraries `L` loaded, as `slw_lib_*` flags
+SLW_INTERNAL uint32_t
+_slwClone_libs(lua_State* L)
+{
+    uint32_t libs = 0;
+    luaL_getsubtable(L, LUA_REGISTRYINDEX, "_LOADED");
+    for (const _slwCloneLib* lib = _slwCloneLibs; lib->name; lib++)
+    {
+        lua_getfield(L, -1, lib->name);
+        if (lua_istable(L, -1))
+            libs |= lib->flag;
+        lua_pop(L, 1);
+    }
+    lua_pop(L, 1);
+    return libs;
+}
+
+// Lazy Libraries
+//----------------------------------
+// `slw_lib_lazy` leaves a name -> luaopen_* table as the first upvalue of the `__index` it sets on `_G`, and of
+// the `package.preload` loaders. A library's entry is removed when it's opened, and `__index` is put back the way
+// it was once they're all gone.
+
+SLW_INTERNAL int _slwLazy_index(lua_State* L);
+
+// Restores the `__index` `_G` had before `_slwLazy_install`, dropping the metatable if it was only there for it
+SLW_INTERNAL void
+_slwLazy_uninstall(lua_State* L)
+{
+    _slw_pushglobals(L);
+    if (!lua_getmetatable(L, -1))
+    {
+        lua_pop(L, 1);
+        return;
+    }
+
+    lua_pushliteral(L, "__index");
+    lua_rawget(L, -2);
+    if (lua_tocfunction(L, -1) == _slwLazy_index)
+    {
+        lua_pushliteral(L, "__index");
+        lua_getupvalue(L, -2, 2);
+        lua_rawset(L, -4);
+
+        lua_pushnil(L);
+        if (lua_next(L, -3) == 0)
+        {
+            lua_pushnil(L);
+            lua_setmetatable(L, -4);
+        } else
+        {
+            lua_pop(L, 2);
+        }
+    }
+    lua_pop(L, 3);
+}
+
+// Opens the library `name` if it's waiting in the table at `lazy`, pushing it.
+// Returns false, pushing nothing, if it isn't.
+SLW_INTERNAL bool
+_slwLazy_open(lua_State* L, int lazy, const char* name)
+{
+    lua_pushstring(L, name);
+    lua_rawget(L, lazy);
+    const lua_CFunction func = lua_tocfunction(L, -1);
+    lua_pop(L, 1);
+    if (!func)
+        return false;
+
+    // Gone before it opens, so a library that looks itself up while opening doesn't recurse
+    lua_pushstring(L, name);
+    lua_pushnil(L);
+    lua_rawset(L, lazy);
+
+    lua_pushnil(L);
+    const bool last = lua_next(L, lazy) == 0;
+    if (!last)
+        lua_pop(L, 2);
+
+    luaL_requiref(L, name, func, 1);
+    if (last)
+        _slwLazy_uninstall(L);
+    return true;
+}
+
+// `__index` of `_G`: opens the library, which sets it as a global so later lookups never get here
+SLW_INTERNAL int
+_slwLazy_index(lua_State* L)
+{
+    if (lua_type(L, 2) == LUA_TSTRING && _slwLazy_open(L, lua_upvalueindex(1), lua_tostring(L, 2)))
+        return 1;
+
+    // Everything else goes to the `__index` `_G` had before
+    const int type = lua_type(L, lua_upvalueindex(2));
+    if (type == LUA_TNIL)
+        return 0;
+
+    if (type == LUA_TFUNCTION)
+    {
+        lua_pushvalue(L, lua_upvalueindex(2));
+        lua_pushvalue(L, 1);
+        lua_pushvalue(L, 2);
+        lua_call(L, 2, 1);
+    } else
+    {
+        lua_pushvalue(L, 2);
+        lua_gettable(L, lua_upvalueindex(2));
+    }
+    return 1;
+}
+
+// `package.preload` loader, `require` of a library nothing has touched yet
+SLW_INTERNAL int
+_slwLazy_preload(lua_State* L)
+{
+    const char* name = luaL_checkstring(L, 1);
+    if (!_slwLazy_open(L, lua_upvalueindex(1), name))
+        lua_getglobal(L, name);
+    return 1;
+}
+
+// Points `package.preload` at the libraries waiting in the table at `lazy`
+SLW_INTERNAL void
+_slwLazy_setpreload(lua_State* L, int lazy)
+{
+    lazy = lua_absindex(L, lazy);
+    luaL_getsubtable(L, LUA_REGISTRYINDEX, "_LOADED");
+    lua_getfield(L, -1, "package");
+    if (lua_istable(L, -1))
+    {
+        lua_getfield(L, -1, "preload");
+        if (lua_istable(L, -1))
+        {
+            lua_pushnil(L);
+            while (lua_next(L, lazy) != 0)
+            {
+                lua_pop(L, 1);
+                lua_pushvalue(L, -1);
+                lua_pushvalue(L, lazy);
+                lua_pushcclosure(L, _slwLazy_preload, 1);
+                lua_rawset(L, -4);
+            }
+        }
+        lua_pop(L, 1);
+    }
+    lua_pop(L, 2);
+}
+
+// Pushes the table of libraries still waiting, returns false and pushes nothing if there's none
+SLW_INTERNAL bool
+_slwLazy_pushpending(lua_State* L)
+{
+    _slw_pushglobals(L);
+    if (!lua_getmetatable(L, -1))
+    {
+        lua_pop(L, 1);
+        return false;
+    }
+
+    lua_pushliteral(L, "__index");
+    lua_rawget(L, -2);
+    const bool pending = lua_tocfunction(L, -1) == _slwLazy_index;
+    if (pending)
+    {
+        lua_getupvalue(L, -1, 1);
+        lua_replace(L, -4);
+    }
+    lua_pop(L, pending ? 2 : 3);
+    return pending;
+}
+
+// Hooks the table of libraries at `lazy` into `_G` and `package.preload`, pops it
+SLW_INTERNAL void
+_slwLazy_install(lua_State* L, int lazy)
+{
+    lua_pushnil(L);
+    if (lua_next(L, lazy) == 0)
+    {
+        lua_remove(L, lazy);
+        return;
+    }
+    lua_pop(L, 2);
+
+    _slw_pushglobals(L);
+    if (!lua_getmetatable(L, -1))
+    {
+        lua_newtable(L);
+        lua_pushvalue(L, -1);
+        lua_setmetatable(L, -3);
+    }
+    lua_pushliteral(L, "__index");
+    lua_pushvalue(L, lazy);
+    lua_pushliteral(L, "__index");
+    lua_rawget(L, -4);
+    lua_pushcclosure(L, _slwLazy_index, 2);
+    lua_rawset(L, -3);
+    lua_pop(L, 2);
+
+    _slwLazy_setpreload(L, lazy);
+    lua_remove(L, lazy);
+}
+
+// Opens every library still waiting, for code that needs them all in place (snapshots look them up by name)
+SLW_INTERNAL void
+_slwLazy_openall(lua_State* L)
+{
+    if (!_slwLazy_pushpending(L))
+        return;
+
+    const int lazy = lua_gettop(L);
+    for (;;)
+    {
+        lua_pushnil(L);
+        if (lua_next(L, lazy) == 0)
+            break;
+        lua_pop(L, 1);
+        if (_slwLazy_open(L, lazy, lua_tostring(L, -1)))
+            lua_pop(L, 1);
+        lua_pop(L, 1);
+    }
+    lua_pop(L, 1);
+}
+
+// State Snapshots
+//----------------------------------
+// A header, then the globals and the loaded modules as two values in the binary value format, extended so
+// tables, functions and strings are written once: they get ids in the order they're first written and are referenced
+// after that. Tables are followed by their metatable (or nil).
+#define _SLW_SNAPSHOT_MAGIC     "SLWS"
+#define _SLW_SNAPSHOT_VERSION   2
+#define _SLW_SNAPSHOT_HEADER    12 // Magic, version, LUA_VERSION_NUM (u16), LuaJIT, u32 id count
+#define _SLW_SNAPSHOT_MAX_DEPTH 200
+
+#if CLW_USING_LUAJIT
+    #define _SLW_SNAPSHOT_LUAJIT 1
+#else
+    #define _SLW_SNAPSHOT_LUAJIT 0
+#endif
+
+#define _SLW_VALUE_REF     7 // Varint id
+#define _SLW_VALUE_FUNC    8 // Varint length, bytecode, varint upvalue count, upvalues (0 + value or 1 + varint id, varint index)
+#define _SLW_VALUE_BUILTIN 9 // Varint length, '\0' separated names; tables are followed by u32 pair count and pairs to set in them
+#define _SLW_VALUE_STRDEF  10 // Varint length, bytes; a string that's referenced again later
+
+// Shorter strings are cheaper written out than referenced
+#define _SLW_SNAPSHOT_MIN_INTERN 2
+
+typedef struct _slwSnapshot
+{
+    lua_State* L;
+    _slwBuffer buf;
+    int ids;      // Writing: object -> id or builtin name, upvalue id -> { function id, index }. Reading: id -> object
+    int builtins; // Reading: name -> builtin
+    int nextId;
+    const char* error;
+} _slwSnapshot;
+
+// Pops a name and a value into `t`, a value with several names gets them all, separated by '\0'
+SLW_INTERNAL void
+_slwSnapshot_setbuiltin(lua_State* L, int t, bool byName)
+{
+    if (byName)
+    {
+        lua_rawset(L, t);
+        return;
+    }
+
+    lua_insert(L, -2);
+    lua_pushvalue(L, -2);
+    lua_rawget(L, t);
+    if (lua_isstring(L, -1))
+    {
+        lua_pushlstring(L, "", 1);
+        lua_pushvalue(L, -3);
+        lua_concat(L, 3);
+        lua_replace(L, -2);
+    } else
+    {
+        lua_pop(L, 1);
+    }
+    lua_rawset(L, t);
+}
+
+SLW_INTERNAL void
+_slwSnapshot_addbuiltins(lua_State* L, int t, int idx, const char* name, bool byName)
+{
+    idx = lua_absindex(L, idx);
+    const bool library = strcmp(name, "_G") != 0 && strcmp(name, "_LOADED") != 0;
+
+    lua_pushstring(L, name);
+    lua_pushvalue(L, idx);
+    _slwSnapshot_setbuiltin(L, t, byName);
+
+    lua_pushnil(L);
+    while (lua_next(L, idx) != 0)
+    {
+        // C functions, and sentinels like `json.null` if it's a library (a global pointer is the state's own)
+        if (lua_type(L, -2) == LUA_TSTRING &&
+            (lua_iscfunction(L, -1) || (library && lua_type(L, -1) == LUA_TLIGHTUSERDATA)))
+        {
+            lua_pushfstring(L, "%s.%s", name, lua_tostring(L, -2));
+            lua_insert(L, -2);
+            _slwSnapshot_setbuiltin(L, t, byName);
+        } else
+        {
+            lua_pop(L, 1);
+        }
+    }
+}
+
+// Pushes the values a restoring state has without the snapshot: "_G", "_LOADED", the standard libraries and
+// their C functions and light userdata ("string.format", "_G.print", "json.null"), as name -> value or value -> name
+SLW_INTERNAL void
+_slwSnapshot_builtins(lua_State* L, bool byName)
+{
+    _slwLazy_openall(L);
+
+    lua_newtable(L);
+    const int t = lua_gettop(L);
+
+    _slw_pushglobals(L);
+    _slwSnapshot_addbuiltins(L, t, -1, "_G", byName);
+    lua_pop(L, 1);
+
+    luaL_getsubtable(L, LUA_REGISTRYINDEX, "_LOADED");
+    _slwSnapshot_addbuiltins(L, t, -1, "_LOADED", byName);
+    for (const _slwCloneLib* lib = _slwCloneLibs; lib->name; lib++)
+    {
+        lua_getfield(L, -1, lib->name);
+        if (lua_istable(L, -1))
+            _slwSnapshot_addbuiltins(L, t, -1, lib->name, byName);
+        lua_pop(L, 1);
+    }
+    lua_pop(L, 1);
+}
+
+SLW_INTERNAL int _slwSnapshot_encode(_slwSnapshot* s, int idx, int depth);
+
+// True if the value at the top of the stack doesn't need writing into the library table `name`,
+// the restoring state's copy of it has its own tables and C functions
+SLW_INTERNAL bool
+_slwSnapshot_skip(_slwSnapshot* s, const char* name)
+{
+    lua_State* L = s->L;
+    const int type = lua_type(L, -1);
+    if (strcmp(name, "_G") == 0 || strcmp(name, "_LOADED") == 0)
+        return false;
+
+    return type == LUA_TTABLE || type == LUA_TUSERDATA || type == LUA_TLIGHTUSERDATA || type == LUA_TTHREAD ||
+           lua_iscfunction(L, -1);
+}
+
+// Writes the pairs of the table at `idx`, all of them or the ones `_slwSnapshot_skip` keeps for `builtin`.
+// Their count goes into the u32 at `pairsAt`.
+SLW_INTERNAL int
+_slwSnapshot_encodepairs(_slwSnapshot* s, int idx, size_t count, size_t pairsAt, const char* builtin, int depth)
+{
+    lua_State* L = s->L;
+    uint32_t pairs = 0;
+    lua_pushnil(L);
+    while (lua_next(L, idx) != 0)
+    {
+        // Already in the array part
+        if (lua_type(L, -2) == LUA_TNUMBER && lua_isinteger(L, -2))
+        {
+            const lua_Integer i = lua_tointeger(L, -2);
+            if (i >= 1 && (size_t)i <= count)
+            {
+                lua_pop(L, 1);
+                continue;
+            }
+        }
+
+        if (builtin && _slwSnapshot_skip(s, builtin))
+        {
+            lua_pop(L, 1);
+            continue;
+        }
+
+        int err = _slwSnapshot_encode(s, -2, depth + 1);
+        if (err == _SLW_VALUE_OK)
+            err = _slwSnapshot_encode(s, -1, depth + 1);
+        lua_pop(L, 1);
+        if (err != _SLW_VALUE_OK)
+        {
+            lua_pop(L, 1);
+            return err;
+        }
+        pairs++;
+    }
+
+    memcpy(s->buf.data + pairsAt, &pairs, sizeof(pairs));
+    return _SLW_VALUE_OK;
+}
+
+SLW_INTERNAL int
+_slwSnapshot_encodeupvalues(_slwSnapshot* s, int idx, int id, int depth)
+{
+    lua_State* L = s->L;
+    int count = 0;
+    while (lua_getupvalue(L, idx, count + 1) != NULL)
+    {
+        lua_pop(L, 1);
+        count++;
+    }
+
+    if (!_slwBuffer_varint(&s->buf, (uint64_t)count))
+        return _SLW_VALUE_NOMEM;
+
+    for (int i = 1; i <= count; i++)
+    {
+#if LUA_VERSION_NUM >= 502
+        // Shared with a function written already, the reader joins them
+        void* upvalue = lua_upvalueid(L, idx, i);
+        lua_pushlightuserdata(L, upvalue);
+        lua_rawget(L, s->ids);
+        if (lua_istable(L, -1))
+        {
+            lua_rawgeti(L, -1, 1);
+            lua_rawgeti(L, -2, 2);
+            const bool ok = _slwBuffer_byte(&s->buf, 1) && _slwBuffer_varint(&s->buf, (uint64_t)lua_tointeger(L, -2)) &&
+                            _slwBuffer_varint(&s->buf, (uint64_t)lua_tointeger(L, -1));
+            lua_pop(L, 3);
+            if (!ok)
+                return _SLW_VALUE_NOMEM;
+            continue;
+        }
+        lua_pop(L, 1);
+
+        lua_pushlightuserdata(L, upvalue);
+        lua_createtable(L, 2, 0);
+        lua_pushinteger(L, id);
+        lua_rawseti(L, -2, 1);
+        lua_pushinteger(L, i);
+        lua_rawseti(L, -2, 2);
+        lua_rawset(L, s->ids);
+#else
+        (void)id;
+#endif
+
+        if (!_slwBuffer_byte(&s->buf, 0))
+            return _SLW_VALUE_NOMEM;
+
+        lua_getupvalue(L, idx, i);
+        const int err = _slwSnapshot_encode(s, -1, depth + 1);
+        lua_pop(L, 1);
+        if (err != _SLW_VALUE_OK)
+            return err;
+    }
+
+    return _SLW_VALUE_OK;
+}
+
+// Strings get ids like tables, so repeated keys and values are a reference after their first time
+SLW_INTERNAL int
+_slwSnapshot_encodestring(_slwSnapshot* s, int idx)
+{
+    lua_State* L = s->L;
+    size_t len;
+    const char* str = lua_tolstring(L, idx, &len);
+    if (len < _SLW_SNAPSHOT_MIN_INTERN)
+        return _slwValue_encode(L, idx, &s->buf, 0);
+
+    lua_pushvalue(L, idx);
+    lua_rawget(L, s->ids);
+    if (lua_type(L, -1) == LUA_TNUMBER)
+    {
+        const uint64_t ref = (uint64_t)lua_tointeger(L, -1);
+        lua_pop(L, 1);
+        return _slwBuffer_byte(&s->buf, _SLW_VALUE_REF) && _slwBuffer_varint(&s->buf, ref) ? _SLW_VALUE_OK : _SLW_VALUE_NOMEM;
+    }
+    lua_pop(L, 1);
+
+    lua_pushvalue(L, idx);
+    lua_pushinteger(L, ++s->nextId);
+    lua_rawset(L, s->ids);
+    return _slwBuffer_byte(&s->buf, _SLW_VALUE_STRDEF) && _slwBuffer_varint(&s->buf, len) &&
+           _slwBuffer_write(&s->buf, str, len) ? _SLW_VALUE_OK : _SLW_VALUE_NOMEM;
+}
+
+SLW_INTERNAL int
+_slwSnapshot_encode(_slwSnapshot* s, int idx, int depth)
+{
+    lua_State* L = s->L;
+    idx = lua_absindex(L, idx);
+
+    const int type = lua_type(L, idx);
+    if (type == LUA_TSTRING)
+        return _slwSnapshot_encodestring(s, idx);
+    if (type == LUA_TLIGHTUSERDATA)
+    {
+        // Written by name like C functions if it's a library's
+        lua_pushvalue(L, idx);
+        lua_rawget(L, s->ids);
+        const bool builtin = !lua_isnil(L, -1);
+        lua_pop(L, 1);
+        if (!builtin)
+            return _slwValue_encode(L, idx, &s->buf, depth);
+    } else if (type != LUA_TTABLE && type != LUA_TFUNCTION)
+    {
+        return _slwValue_encode(L, idx, &s->buf, depth);
+    }
+
+    if (depth >= _SLW_SNAPSHOT_MAX_DEPTH || !lua_checkstack(L, 8))
+        return _SLW_VALUE_TOODEEP;
+
+    lua_pushvalue(L, idx);
+    lua_rawget(L, s->ids);
+    if (lua_type(L, -1) == LUA_TNUMBER)
+    {
+        const uint64_t ref = (uint64_t)lua_tointeger(L, -1);
+        lua_pop(L, 1);
+        return _slwBuffer_byte(&s->buf, _SLW_VALUE_REF) && _slwBuffer_varint(&s->buf, ref) ? _SLW_VALUE_OK : _SLW_VALUE_NOMEM;
+    }
+
+    const int id = ++s->nextId;
+    lua_pushvalue(L, idx);
+    lua_pushinteger(L, id);
+    lua_rawset(L, s->ids);
+
+    // The name stays on the stack while the pairs are written
+    if (lua_type(L, -1) == LUA_TSTRING)
+    {
+        size_t len;
+        const char* name = lua_tolstring(L, -1, &len);
+        int err = _slwBuffer_byte(&s->buf, _SLW_VALUE_BUILTIN) && _slwBuffer_varint(&s->buf, len) &&
+                  _slwBuffer_write(&s->buf, name, len) ? _SLW_VALUE_OK : _SLW_VALUE_NOMEM;
+        const uint32_t zero = 0;
+        const size_t pairsAt = s->buf.size;
+        if (err == _SLW_VALUE_OK && type == LUA_TTABLE)
+            err = _slwBuffer_write(&s->buf, &zero, sizeof(zero)) ? _SLW_VALUE_OK : _SLW_VALUE_NOMEM;
+        if (err == _SLW_VALUE_OK && type == LUA_TTABLE)
+            err = _slwSnapshot_encodepairs(s, idx, 0, pairsAt, name, depth);
+        lua_pop(L, 1);
+        return err;
+    }
+    lua_pop(L, 1);
+
+    if (type == LUA_TTABLE)
+    {
+#if LUA_VERSION_NUM > 501
+        const size_t count = lua_rawlen(L, idx);
+#else
+        const size_t count = lua_objlen(L, idx);
+#endif
+        const uint32_t zero = 0;
+        if (!_slwBuffer_byte(&s->buf, _SLW_VALUE_TABLE) || !_slwBuffer_varint(&s->buf, count))
+            return _SLW_VALUE_NOMEM;
+
+        const size_t pairsAt = s->buf.size;
+        if (!_slwBuffer_write(&s->buf, &zero, sizeof(zero)))
+            return _SLW_VALUE_NOMEM;
+
+        for (size_t i = 1; i <= count; i++)
+        {
+            lua_rawgeti(L, idx, (lua_Integer)i);
+            const int err = _slwSnapshot_encode(s, -1, depth + 1);
+            lua_pop(L, 1);
+            if (err != _SLW_VALUE_OK)
+                return err;
+        }
+
+        int err = _slwSnapshot_encodepairs(s, idx, count, pairsAt, NULL, depth);
+        if (err != _SLW_VALUE_OK)
+            return err;
+
+        if (!lua_getmetatable(L, idx))
+            return _slwBuffer_byte(&s->buf, _SLW_VALUE_NIL) ? _SLW_VALUE_OK : _SLW_VALUE_NOMEM;
+
+        err = _slwSnapshot_encode(s, -1, depth + 1);
+        lua_pop(L, 1);
+        return err;
+    }
+
+    if (lua_iscfunction(L, idx))
+    {
+        s->error = "C functions that aren't part of a library can't be snapshotted";
+        return LUA_TFUNCTION;
+    }
+
+    if (!_slwBuffer_byte(&s->buf, _SLW_VALUE_FUNC))
+        return _SLW_VALUE_NOMEM;
+
+    // The bytecode goes in its own buffer, its length comes first
+    _slwBuffer code = { 0 };
+    lua_pushvalue(L, idx);
+#if LUA_VERSION_NUM >= 503
+    const bool dumped = lua_dump(L, _slwClone_writer, &code, 0) == 0;
+#else
+    const bool dumped = lua_dump(L, _slwClone_writer, &code) == 0;
+#endif
+    lua_pop(L, 1);
+
+    const bool ok = dumped && _slwBuffer_varint(&s->buf, code.size) && _slwBuffer_write(&s->buf, code.data, code.size);
+    slw_free(code.data);
+    if (!ok)
+        return _SLW_VALUE_NOMEM;
+
+    return _slwSnapshot_encodeupvalues(s, idx, id, depth);
+}
+
+SLW_INTERNAL bool _slwSnapshot_decode(_slwSnapshot* s, const uint8_t** p, const uint8_t* end, int depth);
+
+SLW_INTERNAL bool
+_slwSnapshot_readcount(const uint8_t** p, const uint8_t* end, uint32_t* pairs)
+{
+    if ((size_t)(end - *p) < sizeof(*pairs))
+        return false;
+    memcpy(pairs, *p, sizeof(*pairs));
+    *p += sizeof(*pairs);
+    return true;
+}
+
+// Sets `pairs` pairs at `*p` into the table at the top of the stack
+SLW_INTERNAL bool
+_slwSnapshot_decodepairs(_slwSnapshot* s, const uint8_t** p, const uint8_t* end, uint32_t pairs, int depth)
+{
+    lua_State* L = s->L;
+    for (uint32_t i = 0; i < pairs; i++)
+    {
+        if (!_slwSnapshot_decode(s, p, end, depth + 1))
+            return false;
+        if (!_slwSnapshot_decode(s, p, end, depth + 1))
+        {
+            lua_pop(L, 1);
+            return false;
+        }
+
+        if (lua_isnil(L, -2))
+            lua_pop(L, 2);
+        else
+            lua_rawset(L, -3);
+    }
+    return true;
+}
+
+SLW_INTERNAL bool
+_slwSnapshot_decodeupvalues(_slwSnapshot* s, const uint8_t** p, const uint8_t* end, int depth)
+{
+    lua_State* L = s->L;
+    const int fn = lua_gettop(L);
+
+    uint64_t count;
+    if (!_slw_readvarint(p, end, &count))
+        return false;
+
+    for (uint64_t i = 1; i <= count; i++)
+    {
+        if (*p >= end)
+            return false;
+
+        if (*(*p)++ == 0)
+        {
+            if (!_slwSnapshot_decode(s, p, end, depth + 1))
+                return false;
+            if (lua_setupvalue(L, fn, (int)i) == NULL)
+            {
+                lua_pop(L, 1);
+                return false;
+            }
+            continue;
+        }
+
+#if LUA_VERSION_NUM >= 502
+        uint64_t id, n;
+        if (!_slw_readvarint(p, end, &id) || !_slw_readvarint(p, end, &n) || id > INT_MAX || n > INT_MAX)
+            return false;
+
+        lua_rawgeti(L, s->ids, (lua_Integer)id);
+        const bool ok = lua_isfunction(L, -1) && !lua_iscfunction(L, -1) &&
+                        lua_getupvalue(L, -1, (int)n) != NULL && lua_getupvalue(L, fn, (int)i) != NULL;
+        lua_settop(L, fn + 1);
+        if (ok)
+            lua_upvaluejoin(L, fn, (int)i, -1, (int)n);
+        lua_pop(L, 1);
+        if (!ok)
+            return false;
+#else
+        return false;
+#endif
+    }
+
+    return true;
+}
+
+// Pushes the value at `*p`, returns false for malformed input (nothing pushed)
+SLW_INTERNAL bool
+_slwSnapshot_decode(_slwSnapshot* s, const uint8_t** p, const uint8_t* end, int depth)
+{
+    lua_State* L = s->L;
+    if (*p >= end || depth >= _SLW_SNAPSHOT_MAX_DEPTH || !lua_checkstack(L, 8))
+        return false;
+
+    const uint8_t tag = **p;
+    if (tag < _SLW_VALUE_TABLE)
+        return _slwValue_decode(L, p, end, depth);
+    (*p)++;
+
+    uint64_t n;
+    if (!_slw_readvarint(p, end, &n))
+        return false;
+
+    if (tag == _SLW_VALUE_REF)
+    {
+        if (n > INT_MAX)
+            return false;
+        lua_rawgeti(L, s->ids, (lua_Integer)n);
+        if (lua_isnil(L, -1))
+        {
+            lua_pop(L, 1);
+            return false;
+        }
+        return true;
+    }
+
+    bool ok;
+    switch (tag)
+    {
+        case _SLW_VALUE_STRDEF:
+            if ((uint64_t)(end - *p) < n)
+                return false;
+            lua_pushlstring(L, (const char*)*p, (size_t)n);
+            *p += n;
+            lua_pushvalue(L, -1);
+            lua_rawseti(L, s->ids, ++s->nextId);
+            return true;
+        case _SLW_VALUE_TABLE:
+        {
+            uint32_t pairs;
+            if (!_slwSnapshot_readcount(p, end, &pairs))
+                return false;
+
+            lua_createtable(L, n > INT_MAX ? 0 : (int)n, pairs > INT_MAX ? 0 : (int)pairs);
+            lua_pushvalue(L, -1);
+            lua_rawseti(L, s->ids, ++s->nextId);
+
+            ok = true;
+            for (uint64_t i = 1; ok && i <= n; i++)
+            {
+                ok = _slwSnapshot_decode(s, p, end, depth + 1);
+                if (ok)
+                    lua_rawseti(L, -2, (lua_Integer)i);
+            }
+
+            ok = ok && _slwSnapshot_decodepairs(s, p, end, pairs, depth);
+
+            // No metatable, most tables
+            if (ok && *p < end && **p == _SLW_VALUE_NIL)
+            {
+                (*p)++;
+                break;
+            }
+
+            ok = ok && _slwSnapshot_decode(s, p, end, depth + 1);
+            if (ok && lua_istable(L, -1))
+                lua_setmetatable(L, -2);
+            else if (ok)
+                lua_pop(L, 1);
+            break;
+        }
+        case _SLW_VALUE_FUNC:
+            if ((uint64_t)(end - *p) < n)
+                return false;
+            if (luaL_loadbuffer(L, (const char*)*p, (size_t)n, "=snapshot") != 0)
+            {
+                s->error = "the snapshot's bytecode doesn't load";
+                lua_pop(L, 1);
+                return false;
+            }
+            *p += n;
+
+            lua_pushvalue(L, -1);
+            lua_rawseti(L, s->ids, ++s->nextId);
+            ok = _slwSnapshot_decodeupvalues(s, p, end, depth);
+            break;
+        case _SLW_VALUE_BUILTIN:
+            if ((uint64_t)(end - *p) < n)
+                return false;
+        {
+            // The first of its names this state has
+            const char* name = (const char*)*p;
+            const char* nameEnd = name + n;
+            *p += n;
+
+            lua_pushnil(L);
+            while (lua_isnil(L, -1) && name < nameEnd)
+            {
+                const char* next = (const char*)memchr(name, '\0', (size_t)(nameEnd - name));
+                if (!next)
+                    next = nameEnd;
+
+                lua_pop(L, 1);
+                lua_pushlstring(L, name, (size_t)(next - name));
+                lua_rawget(L, s->builtins);
+                name = next + 1;
+            }
+
+            if (lua_isnil(L, -1))
+            {
+                s->error = "the snapshot uses a library or C function this state doesn't have";
+                lua_pop(L, 1);
+                return false;
+            }
+
+            lua_pushvalue(L, -1);
+            lua_rawseti(L, s->ids, ++s->nextId);
+            uint32_t pairs;
+            ok = !lua_istable(L, -1) || (_slwSnapshot_readcount(p, end, &pairs) && _slwSnapshot_decodepairs(s, p, end, pairs, depth));
+            break;
+        }
+        default:
+            return false;
+    }
+
+    if (!ok)
+        lua_pop(L, 1);
+    return ok;
+}
+
+// Read-only view of a whole file, `sequential` if it's read once front to back
+typedef struct _slwMapping
+{
+    const uint8_t* data;
+    size_t size;
+} _slwMapping;
+
+SLW_INTERNAL bool
+_slwMapping_open(_slwMapping* m, const char* path, bool sequential)
+{
+    memset(m, 0, sizeof(*m));
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    HANDLE map = NULL;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+        map = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+    // The view keeps the mapping alive
+    if (map)
+    {
+        m->data = (const uint8_t*)MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+        m->size = (size_t)size.QuadPart;
+        CloseHandle(map);
+    }
+    CloseHandle(file);
+
+    if (!m->data)
+        return false;
+#else
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return false;
+
+    if (sequential)
+        posix_madvise(data, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+    m->data = (const uint8_t*)data;
+    m->size = (size_t)st.st_size;
+#endif
+    return true;
+}
+
+SLW_INTERNAL void
+_slwMapping_close(_slwMapping* m)
+{
+#if defined(_WIN32)
+    UnmapViewOfFile(m->data);
+#else
+    munmap((void*)m->data, m->size);
+#endif
+}
+
+// Table Serialization
+//----------------------------------
+// One position-independent blob: a header, then tables laid out like the store's but with u32 offsets from the
+// start of the blob instead of pointers. Everything is 8-byte aligned, so an aligned blob is read in place.
+#define _SLW_SERIAL_MAGIC   "SLWT"
+#define _SLW_SERIAL_VERSION 1
+#define _SLW_SERIAL_ORDER   0x0102 // Written in native byte order, reads back as 0x0201 on the other one
+
+typedef struct _slwSerialHeader
+{
+    char magic[4];
+    uint8_t version;
+    uint8_t reserved;
+    uint16_t order;
+    uint32_t size;
+    uint32_t root;
+} _slwSerialHeader;
+
+// Followed by its entries, then `mask + 1` slots if `mask` isn't 0 (entry index + 1, 0 is empty)
+typedef struct _slwSerialTable
+{
+    uint32_t size;
+    uint32_t mask;
+} _slwSerialTable;
+
+typedef struct _slwSerialEntry
+{
+    uint32_t key;    // 0 in indexed tables
+    uint32_t keyLen;
+    uint32_t len;    // Strings
+    uint8_t ltype;
+    uint8_t b;
+    uint16_t reserved;
+    union
+    {
+        double d;
+        int64_t l;
+        uint64_t offset; // Strings and tables
+    } value;
+} _slwSerialEntry;
+
+SLW_INTERNAL SLW_INLINE const _slwSerialEntry*
+_slwSerial_entries(const _slwSerialTable* tbl)
+{
+    return (const _slwSerialEntry*)(tbl + 1);
+}
+
+SLW_INTERNAL SLW_INLINE const uint32_t*
+_slwSerial_slots(const _slwSerialTable* tbl)
+{
+    return (const uint32_t*)(_slwSerial_entries(tbl) + tbl->size);
+}
+
+// Bytes `_slwSerial_build` needs for `slt`, 0 if it has values that don't mean anything outside this process
+SLW_INTERNAL size_t
+_slwSerial_measure(const slwTable* slt, int depth)
+{
+    if (depth >= SLW_RECURSION_DEPTH)
+        return 0;
+
+    size_t bytes = _SLW_STORE_ALIGN(sizeof(_slwSerialTable) + slt->size * sizeof(_slwSerialEntry))
+                 + _SLW_STORE_ALIGN(_slwStore_capacity(slt) * sizeof(uint32_t));
+
+    for (size_t i = 0; i < slt->size; i++)
+    {
+        const slwTableValue* el = &slt->elements[i];
+        if (el->name)
+            bytes += _SLW_STORE_ALIGN(strlen(el->name) + 1);
+
+        if (el->ltype == LUA_TSTRING && el->value.s)
+        {
+            bytes += _SLW_STORE_ALIGN(strlen(el->value.s) + 1);
+        } else if (el->ltype == LUA_TTABLE && el->value.t)
+        {
+            const size_t nested = _slwSerial_measure(el->value.t, depth + 1);
+            if (!nested)
+                return 0;
+            bytes += nested;
+        } else if (el->ltype == LUA_TLIGHTUSERDATA || el->ltype == LUA_TFUNCTION)
+        {
+            return 0;
+        }
+    }
+
+    return bytes;
+}
+
+SLW_INTERNAL uint32_t
+_slwSerial_copystr(uint8_t* base, char** cursor, const char* str, size_t len)
+{
+    const char* copy = _slwStore_copystr(cursor, str, len);
+    return (uint32_t)((const uint8_t*)copy - base);
+}
+
+// The string of `len` bytes at `offset` if it's inside the blob and NUL-terminated
+SLW_INTERNAL const char*
+_slwSerial_string(const uint8_t* data, size_t size, uint64_t offset, uint32_t len)
+{
+    if (offset >= size || size - offset <= len || data[offset + len] != '\0')
+        return NULL;
+    return (const char*)(data + offset);
+}
+
+SLW_INTERNAL const _slwSerialEntry*
+_slwSerial_find(const uint8_t* data, size_t size, const _slwSerialTable* tbl, const char* key, size_t len)
+{
+    if (!tbl->mask)
+        return NULL;
+
+    const _slwSerialEntry* entries = _slwSerial_entries(tbl);
+    const uint32_t* slots = _slwSerial_slots(tbl);
+    uint32_t slot = (uint32_t)_slw_fnv1a(key, len) & tbl->mask;
+    for (uint32_t probes = 0; probes <= tbl->mask && slots[slot]; probes++, slot = (slot + 1) & tbl->mask)
+    {
+        if (slots[slot] > tbl->size)
+            return NULL;
+
+        const _slwSerialEntry* entry = &entries[slots[slot] - 1];
+        const char* name = entry->keyLen == len ? _slwSerial_string(data, size, entry->key, entry->keyLen) : NULL;
+        if (name && memcmp(name, key, len) == 0)
+            return entry;
+    }
+    return NULL;
+}
+
+// Writes `slt` at `*cursor` and returns its offset
+SLW_INTERNAL uint32_t
+_slwSerial_build(uint8_t* base, size_t size, char** cursor, const slwTable* slt)
+{
+    const uint32_t capacity = _slwStore_capacity(slt);
+    _slwSerialTable* tbl = (_slwSerialTable*)_slwStore_take(cursor, sizeof(_slwSerialTable) + slt->size * sizeof(_slwSerialEntry));
+    tbl->size = (uint32_t)slt->size;
+    tbl->mask = capacity ? capacity - 1 : 0;
+
+    _slwSerialEntry* entries = (_slwSerialEntry*)(tbl + 1);
+    uint32_t* slots = (uint32_t*)_slwStore_take(cursor, capacity * sizeof(uint32_t));
+    memset(slots, 0, capacity * sizeof(uint32_t));
+
+    for (size_t i = 0; i < slt->size; i++)
+    {
+        const slwTableValue* el = &slt->elements[i];
+        _slwSerialEntry* entry = &entries[i];
+        memset(entry, 0, sizeof(_slwSerialEntry));
+        entry->ltype = el->ltype;
+
+        switch (el->ltype)
+        {
+            case LUA_TSTRING:
+            {
+                const char* str = el->value.s ? el->value.s : "";
+                entry->len = (uint32_t)strlen(str);
+                entry->value.offset = _slwSerial_copystr(base, cursor, str, entry->len);
+                break;
+            }
+            case LUA_TNUMBER:
+                entry->value.d = el->value.d;
+                break;
+            case slw_tinteger:
+                entry->value.l = el->value.l;
+                break;
+            case LUA_TBOOLEAN:
+                entry->b = el->value.b;
+                break;
+            case LUA_TTABLE:
+                if (el->value.t)
+                    entry->value.offset = _slwSerial_build(base, size, cursor, el->value.t);
+                else
+                    entry->ltype = LUA_TNIL;
+                break;
+            default:
+                entry->ltype = LUA_TNIL;
+                break;
+        }
+
+        if (!el->name)
+            continue;
+
+        entry->keyLen = (uint32_t)strlen(el->name);
+        entry->key = _slwSerial_copystr(base, cursor, el->name, entry->keyLen);
+
+        // First one wins, same as `slwTable_getkey`
+        if (capacity && !_slwSerial_find(base, size, tbl, el->name, entry->keyLen))
+        {
+            uint32_t slot = (uint32_t)_slw_fnv1a(el->name, entry->keyLen) & tbl->mask;
+            while (slots[slot])
+                slot = (slot + 1) & tbl->mask;
+            slots[slot] = (uint32_t)i + 1;
+        }
+    }
+
+    return (uint32_t)((uint8_t*)tbl - base);
+}
+
+// The table at `offset` if it (entries and slots) is inside the blob
+SLW_INTERNAL const _slwSerialTable*
+_slwSerial_table(const uint8_t* data, size_t size, uint64_t offset)
+{
+    if (offset < sizeof(_slwSerialHeader) || (offset & 7) || offset > size || size - offset < sizeof(_slwSerialTable))
+        return NULL;
+
+    const _slwSerialTable* tbl = (const _slwSerialTable*)(data + offset);
+    const uint64_t bytes = sizeof(_slwSerialTable) + (uint64_t)tbl->size * sizeof(_slwSerialEntry) +
+                           (tbl->mask ? ((uint64_t)tbl->mask + 1) * sizeof(uint32_t) : 0);
+    if ((tbl->mask & (tbl->mask + 1)) != 0 || bytes > size - offset)
+        return NULL;
+
+    return tbl;
+}
+
+// Reads an entry into `out`, nested tables are left as their address in the blob
+SLW_INTERNAL bool
+_slwSerial_read(const uint8_t* data, size_t size, const _slwSerialEntry* entry, slwTableValue* out)
+{
+    memset(out, 0, sizeof(*out));
+    if (entry->key && !(out->name = _slwSerial_string(data, size, entry->key, entry->keyLen)))
+        return false;
+
+    out->ltype = entry->ltype;
+    switch (entry->ltype)
+    {
+        case LUA_TSTRING:
+            out->value.s = _slwSerial_string(data, size, entry->value.offset, entry->len);
+            return out->value.s != NULL;
+        case LUA_TNUMBER:
+            out->value.d = entry->value.d;
+            return true;
+        case slw_tinteger:
+            out->value.l = entry->value.l;
+            return true;
+        case LUA_TBOOLEAN:
+            out->value.b = entry->b != 0;
+            return true;
+        case LUA_TTABLE:
+        {
+            const _slwSerialTable* tbl = _slwSerial_table(data, size, entry->value.offset);
+            out->value.u = (void*)tbl;
+            return tbl != NULL;
+        }
+        case LUA_TNIL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Counts the tables and entries under `tbl`, checking every offset on the way
+SLW_INTERNAL bool
+_slwSerial_count(const uint8_t* data, size_t size, const _slwSerialTable* tbl, size_t* tables, size_t* entries, int depth)
+{
+    if (depth >= SLW_RECURSION_DEPTH)
+        return false;
+
+    *entries += tbl->size;
+    for (uint32_t i = 0; i < tbl->size; i++)
+    {
+        slwTableValue val;
+        if (!_slwSerial_read(data, size, &_slwSerial_entries(tbl)[i], &val))
+            return false;
+
+        if (val.ltype == LUA_TTABLE)
+        {
+            (*tables)++;
+            if (!_slwSerial_count(data, size, (const _slwSerialTable*)val.value.u, tables, entries, depth + 1))
+                return false;
+        }
+    }
+    return true;
+}
+
+// Fills `slt` from `tbl`, nested tables and their elements come from `*cursor`
+SLW_INTERNAL void
+_slwSerial_unpack(const uint8_t* data, size_t size, const _slwSerialTable* tbl, slwTable* slt, char** cursor)
+{
+    slt->size = tbl->size;
+    for (uint32_t i = 0; i < tbl->size; i++)
+    {
+        slwTableValue* el = &slt->elements[i];
+        (void)_slwSerial_read(data, size, &_slwSerial_entries(tbl)[i], el);
+        if (el->ltype != LUA_TTABLE)
+            continue;
+
+        const _slwSerialTable* nested = (const _slwSerialTable*)el->value.u;
+        slwTable* child = (slwTable*)_slwStore_take(cursor, sizeof(slwTable));
+        child->elements = (slwTableValue*)_slwStore_take(cursor, nested->size * sizeof(slwTableValue));
+        child->binding = NULL;
+        el->value.t = child;
+        _slwSerial_unpack(data, size, nested, child, cursor);
+    }
+}
+
+// MessagePack
+//----------------------------------
+// Big-endian, encoded straight from Lua values and decoded straight into them.
+// It's an array if every key is in 1..n, `pairs` is the number of keys either way
+SLW_INTERNAL bool
+_slw_isarray(lua_State* L, int idx, size_t* count, size_t* pairs)
+{
+#if LUA_VERSION_NUM > 501
+    *count = lua_rawlen(L, idx);
+#else
+    *count = lua_objlen(L, idx);
+#endif
+    size_t inArray = 0;
+    *pairs = 0;
+    lua_pushnil(L);
+    while (lua_next(L, idx) != 0)
+    {
+        lua_pop(L, 1);
+        (*pairs)++;
+        if (lua_type(L, -1) == LUA_TNUMBER && lua_isinteger(L, -1))
+        {
+            const lua_Integer i = lua_tointeger(L, -1);
+            inArray += i >= 1 && (size_t)i <= *count;
+        }
+    }
+
+    return *pairs == inArray && *pairs == *count;
+}
+
+SLW_INTERNAL bool
+_slwMsgpack_write(_slwBuffer* buf, uint8_t tag, uint64_t n, int bytes)
+{
+    uint8_t out[9];
+    out[0] = tag;
+    for (int i = 0; i < bytes; i++)
+        out[1 + i] = (uint8_t)(n >> (8 * (bytes - 1 - i)));
+    return _slwBuffer_write(buf, out, 1 + (size_t)bytes);
+}
+
+// Fix type when `n` fits in `fixMax`, otherwise the 8/16/32-bit `tag`s
+SLW_INTERNAL bool
+_slwMsgpack_header(_slwBuffer* buf, uint8_t fix, uint32_t fixMax, uint8_t tag8, uint8_t tag16, uint8_t tag32, size_t n)
+{
+    if (n <= fixMax)
+        return _slwBuffer_byte(buf, (uint8_t)(fix | n));
+    if (tag8 && n <= UINT8_MAX)
+        return _slwMsgpack_write(buf, tag8, n, 1);
+    if (n <= UINT16_MAX)
+        return _slwMsgpack_write(buf, tag16, n, 2);
+    return n <= UINT32_MAX && _slwMsgpack_write(buf, tag32, n, 4);
+}
+
+SLW_INTERNAL bool
+_slwMsgpack_integer(_slwBuffer* buf, int64_t n)
+{
+    if (n >= 0)
+    {
+        if (n <= 0x7F)
+            return _slwBuffer_byte(buf, (uint8_t)n);
+        if (n <= UINT8_MAX)
+            return _slwMsgpack_write(buf, 0xCC, (uint64_t)n, 1);
+        if (n <= UINT16_MAX)
+            return _slwMsgpack_write(buf, 0xCD, (uint64_t)n, 2);
+        if (n <= UINT32_MAX)
+            return _slwMsgpack_write(buf, 0xCE, (uint64_t)n, 4);
+        return _slwMsgpack_write(buf, 0xCF, (uint64_t)n, 8);
+    }
+
+    if (n >= -32)
+        return _slwBuffer_byte(buf, (uint8_t)(int8_t)n);
+    if (n >= INT8_MIN)
+        return _slwMsgpack_write(buf, 0xD0, (uint64_t)n, 1);
+    if (n >= INT16_MIN)
+        return _slwMsgpack_write(buf, 0xD1, (uint64_t)n, 2);
+    if (n >= INT32_MIN)
+        return _slwMsgpack_write(buf, 0xD2, (uint64_t)n, 4);
+    return _slwMsgpack_write(buf, 0xD3, (uint64_t)n, 8);
+}
+
+// Same results as `_slwValue_encode`
+SLW_INTERNAL int
+_slwMsgpack_encode(lua_State* L, int idx, _slwBuffer* buf, int depth)
+{
+    idx = lua_absindex(L, idx);
+    const int type = lua_type(L, idx);
+    bool ok = true;
+
+    switch (type)
+    {
+        case LUA_TNIL:
+            ok = _slwBuffer_byte(buf, 0xC0);
+            break;
+        case LUA_TBOOLEAN:
+            ok = _slwBuffer_byte(buf, lua_toboolean(L, idx) ? 0xC3 : 0xC2);
+            break;
+        case LUA_TNUMBER:
+            if (lua_isinteger(L, idx))
+            {
+                ok = _slwMsgpack_integer(buf, (int64_t)lua_tointeger(L, idx));
+            } else
+            {
+                const double d = (double)lua_tonumber(L, idx);
+                uint64_t bits;
+                memcpy(&bits, &d, sizeof(bits));
+                ok = _slwMsgpack_write(buf, 0xCB, bits, 8);
+            }
+            break;
+        case LUA_TSTRING:
+        {
+            size_t len;
+            const char* str = lua_tolstring(L, idx, &len);
+            ok = _slwMsgpack_header(buf, 0xA0, 31, 0xD9, 0xDA, 0xDB, len) && _slwBuffer_write(buf, str, len);
+            break;
+        }
+        case LUA_TTABLE:
+        {
+            if (depth >= SLW_RECURSION_DEPTH || !lua_checkstack(L, 3))
+                return _SLW_VALUE_TOODEEP;
+
+            size_t count, pairs;
+            if (_slw_isarray(L, idx, &count, &pairs))
+            {
+                if (!_slwMsgpack_header(buf, 0x90, 15, 0, 0xDC, 0xDD, count))
+                    return _SLW_VALUE_NOMEM;
+
+                for (size_t i = 1; i <= count; i++)
+                {
+                    lua_rawgeti(L, idx, (lua_Integer)i);
+                    const int err = _slwMsgpack_encode(L, -1, buf, depth + 1);
+                    lua_pop(L, 1);
+                    if (err != _SLW_VALUE_OK)
+                        return err;
+                }
+                break;
+            }
+
+            if (!_slwMsgpack_header(buf, 0x80, 15, 0, 0xDE, 0xDF, pairs))
+                return _SLW_VALUE_NOMEM;
+
+            lua_pushnil(L);
+            while (lua_next(L, idx) != 0)
+            {
+                int err = _slwMsgpack_encode(L, -2, buf, depth + 1);
+                if (err == _SLW_VALUE_OK)
+                    err = _slwMsgpack_encode(L, -1, buf, depth + 1);
+                lua_pop(L, 1);
+                if (err != _SLW_VALUE_OK)
+                {
+                    lua_pop(L, 1);
+                    return err;
+                }
+            }
+            break;
+        }
+        default:
+            return type;
+    }
+
+    return ok ? _SLW_VALUE_OK : _SLW_VALUE_NOMEM;
+}
+
+SLW_INTERNAL bool
+_slwMsgpack_read(const uint8_t** p, const uint8_t* end, int bytes, uint64_t* n)
+{
+    if (end - *p < bytes)
+        return false;
+
+    *n = 0;
+    for (int i = 0; i < bytes; i++)
+        *n = (*n << 8) | *(*p)++;
+    return true;
+}
+
+SLW_INTERNAL void
+_slwMsgpack_pushinteger(lua_State* L, int64_t n)
+{
+    if (n >= LUA_MININTEGER && n <= LUA_MAXINTEGER)
+        lua_pushinteger(L, (lua_Integer)n);
+    else
+        lua_pushnumber(L, (lua_Number)n);
+}
+
+SLW_INTERNAL bool _slwMsgpack_decode(lua_State* L, const uint8_t** p, const uint8_t* end, int depth);
+
+SLW_INTERNAL bool
+_slwMsgpack_decodetable(lua_State* L, const uint8_t** p, const uint8_t* end, uint64_t n, bool map, int depth)
+{
+    // Every element takes a byte at least, a count past the end of the input is malformed
+    if (depth >= SLW_RECURSION_DEPTH || n > (uint64_t)(end - *p) || !lua_checkstack(L, 3))
+        return false;
+
+    const int hint = n > INT_MAX ? 0 : (int)n;
+    lua_createtable(L, map ? 0 : hint, map ? hint : 0);
+    for (uint64_t i = 0; i < n; i++)
+    {
+        if (!_slwMsgpack_decode(L, p, end, depth + 1))
+        {
+            lua_pop(L, 1);
+            return false;
+        }
+
+        if (!map)
+        {
+            lua_rawseti(L, -2, (lua_Integer)i + 1);
+            continue;
+        }
+
+        if (!_slwMsgpack_decode(L, p, end, depth + 1))
+        {
+            lua_pop(L, 2);
+            return false;
+        }
+
+        // nil and NaN can't be keys
+        if (lua_isnil(L, -2) || (lua_type(L, -2) == LUA_TNUMBER && lua_tonumber(L, -2) != lua_tonumber(L, -2)))
+            lua_pop(L, 2);
+        else
+            lua_rawset(L, -3);
+    }
+    return true;
+}
+
+// Pushes the value at `*p`, returns false for malformed input (nothing pushed)
+SLW_INTERNAL bool
+_slwMsgpack_decode(lua_State* L, const uint8_t** p, const uint8_t* end, int depth)
+{
+    if (*p >= end)
+        return false;
+
+    const uint8_t tag = *(*p)++;
+    uint64_t n;
+
+    if (tag <= 0x7F)
+    {
+        lua_pushinteger(L, tag);
+        return true;
+    }
+    if (tag >= 0xE0)
+    {
+        lua_pushinteger(L, (int8_t)tag);
+        return true;
+    }
+    if ((tag & 0xF0) == 0x80)
+        return _slwMsgpack_decodetable(L, p, end, tag & 0x0F, true, depth);
+    if ((tag & 0xF0) == 0x90)
+        return _slwMsgpack_decodetable(L, p, end, tag & 0x0F, false, depth);
+
+    // Strings and binaries, by the size of their length
+    int lenBytes = 0;
+    if ((tag & 0xE0) == 0xA0)
+    {
+        n = tag & 0x1F;
+        lenBytes = -1;
+    } else if (tag == 0xD9 || tag == 0xC4)
+    {
+        lenBytes = 1;
+    } else if (tag == 0xDA || tag == 0xC5)
+    {
+        lenBytes = 2;
+    } else if (tag == 0xDB || tag == 0xC6)
+    {
+        lenBytes = 4;
+    }
+
+    if (lenBytes)
+    {
+        if (lenBytes > 0 && !_slwMsgpack_read(p, end, lenBytes, &n))
+            return false;
+        if (n > (uint64_t)(end - *p))
+            return false;
+
+        lua_pushlstring(L, (const char*)*p, (size_t)n);
+        *p += n;
+        return true;
+    }
+
+    switch (tag)
+    {
+        case 0xC0:
+            lua_pushnil(L);
+            return true;
+        case 0xC2:
+        case 0xC3:
+            lua_pushboolean(L, tag == 0xC3);
+            return true;
+        case 0xCA:
+        {
+            float f;
+            uint32_t bits;
+            if (!_slwMsgpack_read(p, end, 4, &n))
+                return false;
+            bits = (uint32_t)n;
+            memcpy(&f, &bits, sizeof(f));
+            lua_pushnumber(L, (lua_Number)f);
+            return true;
+        }
+        case 0xCB:
+        {
+            double d;
+            if (!_slwMsgpack_read(p, end, 8, &n))
+                return false;
+            memcpy(&d, &n, sizeof(d));
+            lua_pushnumber(L, (lua_Number)d);
+            return true;
+        }
+        case 0xCC: case 0xCD: case 0xCE: case 0xCF:
+            if (!_slwMsgpack_read(p, end, 1 << (tag - 0xCC), &n))
+                return false;
+            if (n > INT64_MAX)
+                lua_pushnumber(L, (lua_Number)n);
+            else
+                _slwMsgpack_pushinteger(L, (int64_t)n);
+            return true;
+        case 0xD0: case 0xD1: case 0xD2: case 0xD3:
+        {
+            const int bytes = 1 << (tag - 0xD0);
+            if (!_slwMsgpack_read(p, end, bytes, &n))
+                return false;
+
+            // Sign-extend
+            const int shift = 64 - 8 * bytes;
+            _slwMsgpack_pushinteger(L, (int64_t)(n << shift) >> shift);
+            return true;
+        }
+        case 0xDC: case 0xDD:
+        case 0xDE: case 0xDF:
+            if (!_slwMsgpack_read(p, end, (tag & 1) ? 4 : 2, &n))
+                return false;
+            return _slwMsgpack_decodetable(L, p, end, n, tag >= 0xDE, depth);
+        default:
+            // Extensions and the unused 0xC1
+            return false;
+    }
+}
+
+SLW_INTERNAL int
+_slwMsgpack_lencode(lua_State* L)
+{
+    _slwBuffer* buf = (_slwBuffer*)lua_touserdata(L, lua_upvalueindex(1));
+    luaL_checkany(L, 1);
+    lua_settop(L, 1);
+
+    // The buffer is kept between calls, only its contents are thrown away
+    buf->size = 0;
+    const int err = _slwMsgpack_encode(L, 1, buf, 0);
+    if (err == _SLW_VALUE_TOODEEP)
+        return luaL_error(L, "msgpack: can't encode a table nested deeper than %d (or with a cycle)", SLW_RECURSION_DEPTH);
+    else if (err == _SLW_VALUE_NOMEM)
+        return luaL_error(L, "not enough memory");
+    else if (err != _SLW_VALUE_OK)
+        return luaL_error(L, "msgpack: can't encode a %s value", lua_typename(L, err));
+
+    lua_pushlstring(L, (const char*)buf->data, buf->size);
+    return 1;
+}
+
+SLW_INTERNAL int
+_slwMsgpack_ldecode(lua_State* L)
+{
+    size_t len;
+    const char* str = luaL_checklstring(L, 1, &len);
+    const lua_Integer pos = luaL_optinteger(L, 2, 1);
+    luaL_argcheck(L, pos >= 1 && (size_t)pos <= len + 1, 2, "out of range");
+
+    const uint8_t* p = (const uint8_t*)str + pos - 1;
+    if (!_slwMsgpack_decode(L, &p, (const uint8_t*)str + len, 0))
+        return luaL_error(L, "msgpack: malformed or incomplete input at %d", (int)pos);
+
+    lua_pushinteger(L, (lua_Integer)(p - (const uint8_t*)str) + 1);
+    return 2;
+}
+
+SLW_INTERNAL int
+_slwMsgpack_buffergc(lua_State* L)
+{
+    slwBuffer_free((_slwBuffer*)lua_touserdata(L, 1));
+    return 0;
+}
+
+// JSON
+//----------------------------------
+// Strings are scanned 16 bytes at a time for the bytes that end a plain run (quote, backslash, control character),
+// the decoder is a push parser so a document can arrive in any number of pieces.
+#if !defined(SLW_JSON_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+    #include <emmintrin.h>
+    #define _SLW_JSON_SSE2 1
+#else
+    #define _SLW_JSON_SSE2 0
+#endif
+
+// Items an open array or object keeps on the stack before its table is made
+#define _SLW_JSON_FLUSH 1024
+
+#define _SLW_JSON_BADNUMBER -3
+
+#if _SLW_JSON_SSE2
+SLW_INTERNAL SLW_INLINE int
+_slw_ctz32(uint32_t n)
+{
+#if defined(_MSC_VER)
+    unsigned long i;
+    _BitScanForward(&i, n);
+    return (int)i;
+#else
+    return __builtin_ctz(n);
+#endif
+}
+#endif
+
+// First quote, backslash or control character in [p, end)
+SLW_INTERNAL const uint8_t*
+_slwJson_scanstring(const uint8_t* p, const uint8_t* end)
+{
+#if _SLW_JSON_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    for (; end - p >= 16; p += 16)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i*)p);
+
+        // Unsigned v <= 0x1F is min(v, 0x1F) == v
+        const __m128i stop = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                                          _mm_cmpeq_epi8(_mm_min_epu8(v, control), v));
+        const uint32_t mask = (uint32_t)_mm_movemask_epi8(stop);
+        if (mask)
+            return p + _slw_ctz32(mask);
+    }
+#endif
+    while (p < end && *p != '"' && *p != '\\' && *p >= 0x20)
+        p++;
+    return p;
+}
+
+SLW_INTERNAL const uint8_t*
+_slwJson_skipspace(const uint8_t* p, const uint8_t* end)
+{
+#if _SLW_JSON_SSE2
+    // Indentation comes in runs, anything shorter is done by the loop below
+    if (end - p >= 16 && *p == ' ' && p[1] == ' ')
+    {
+        const __m128i space = _mm_set1_epi8(' ');
+        const __m128i newline = _mm_set1_epi8('\n');
+        const __m128i tab = _mm_set1_epi8('\t');
+        const __m128i cr = _mm_set1_epi8('\r');
+        for (; end - p >= 16; p += 16)
+        {
+            const __m128i v = _mm_loadu_si128((const __m128i*)p);
+            const __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, newline)),
+                                            _mm_or_si128(_mm_cmpeq_epi8(v, tab), _mm_cmpeq_epi8(v, cr)));
+            const uint32_t mask = (uint32_t)_mm_movemask_epi8(ws) ^ 0xFFFF;
+            if (mask)
+                return p + _slw_ctz32(mask);
+        }
+    }
+#endif
+    while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+        p++;
+    return p;
+}
+
+// Encoding
+SLW_INTERNAL bool
+_slwJson_encodestring(_slwBuffer* buf, const char* str, size_t len)
+{
+    const uint8_t* p = (const uint8_t*)str;
+    const uint8_t* end = p + len;
+    if (!_slwBuffer_byte(buf, '"'))
+        return false;
+
+    while (p < end)
+    {
+        const uint8_t* stop = _slwJson_scanstring(p, end);
+        if (!_slwBuffer_write(buf, p, (size_t)(stop - p)))
+            return false;
+        if (stop == end)
+            break;
+
+        char escape[7] = { '\\', 0 };
+        size_t escapeLen = 2;
+        switch (*stop)
+        {
+            case '"':  escape[1] = '"';  break;
+            case '\\': escape[1] = '\\'; break;
+            case '\b': escape[1] = 'b';  break;
+            case '\f': escape[1] = 'f';  break;
+            case '\n': escape[1] = 'n';  break;
+            case '\r': escape[1] = 'r';  break;
+            case '\t': escape[1] = 't';  break;
+            default:
+                snprintf(escape, sizeof(escape), "\\u%04x", *stop);
+                escapeLen = 6;
+                break;
+        }
+        if (!_slwBuffer_write(buf, escape, escapeLen))
+            return false;
+        p = stop + 1;
+    }
+
+    return _slwBuffer_byte(buf, '"');
+}
+
+SLW_INTERNAL int
+_slwJson_encodenumber(lua_State* L, int idx, _slwBuffer* buf)
+{
+    char str[32];
+    int len;
+    if (lua_isinteger(L, idx))
+    {
+        len = snprintf(str, sizeof(str), "%lld", (long long)lua_tointeger(L, idx));
+    } else
+    {
+        const double d = (double)lua_tonumber(L, idx);
+        if (d != d || d - d != 0)
+            return _SLW_JSON_BADNUMBER;
+
+        // The shortest of the two that reads back the same
+        len = snprintf(str, sizeof(str), "%.15g", d);
+        if (strtod(str, NULL) != d)
+            len = snprintf(str, sizeof(str), "%.17g", d);
+    }
+
+    return _slwBuffer_write(buf, str, (size_t)len) ? _SLW_VALUE_OK : _SLW_VALUE_NOMEM;
+}
+
+// Same results as `_slwValue_encode`, plus `_SLW_JSON_BADNUMBER`
+SLW_INTERNAL int
+_slwJson_encode(lua_State* L, int idx, _slwBuffer* buf, int depth)
+{
+    idx = lua_absindex(L, idx);
+    const int type = lua_type(L, idx);
+    bool ok = true;
+
+    switch (type)
+    {
+        case LUA_TNIL:
+            ok = _slwBuffer_write(buf, "null", 4);
+            break;
+        case LUA_TLIGHTUSERDATA:
+            // `json.null`
+            if (lua_touserdata(L, idx) != NULL)
+                return type;
+            ok = _slwBuffer_write(buf, "null", 4);
+            break;
+        case LUA_TBOOLEAN:
+            ok = lua_toboolean(L, idx) ? _slwBuffer_write(buf, "true", 4) : _slwBuffer_write(buf, "false", 5);
+            break;
+        case LUA_TNUMBER:
+            return _slwJson_encodenumber(L, idx, buf);
+        case LUA_TSTRING:
+        {
+            size_t len;
+            const char* str = lua_tolstring(L, idx, &len);
+            ok = _slwJson_encodestring(buf, str, len);
+            break;
+        }
+        case LUA_TTABLE:
+        {
+            if (depth >= SLW_RECURSION_DEPTH || !lua_checkstack(L, 3))
+                return _SLW_VALUE_TOODEEP;
+
+            size_t count, pairs;
+            if (_slw_isarray(L, idx, &count, &pairs))
+            {
+                if (!_slwBuffer_byte(buf, '['))
+                    return _SLW_VALUE_NOMEM;
+
+                for (size_t i = 1; i <= count; i++)
+                {
+                    if (i > 1 && !_slwBuffer_byte(buf, ','))
+                        return _SLW_VALUE_NOMEM;
+
+                    lua_rawgeti(L, idx, (lua_Integer)i);
+                    const int err = _slwJson_encode(L, -1, buf, depth + 1);
+                    lua_pop(L, 1);
+                    if (err != _SLW_VALUE_OK)
+                        return err;
+                }
+
+                ok = _slwBuffer_byte(buf, ']');
+                break;
+            }
+
+            if (!_slwBuffer_byte(buf, '{'))
+                return _SLW_VALUE_NOMEM;
+
+            bool first = true;
+            lua_pushnil(L);
+            while (lua_next(L, idx) != 0)
+            {
+                int err = first || _slwBuffer_byte(buf, ',') ? _SLW_VALUE_OK : _SLW_VALUE_NOMEM;
+                first = false;
+
+                // Keys are strings, numbers are written as strings
+                const int keyType = lua_type(L, -2);
+                if (err == _SLW_VALUE_OK && keyType == LUA_TSTRING)
+                {
+                    size_t len;
+                    const char* key = lua_tolstring(L, -2, &len);
+                    err = _slwJson_encodestring(buf, key, len) ? _SLW_VALUE_OK : _SLW_VALUE_NOMEM;
+                } else if (err == _SLW_VALUE_OK && keyType == LUA_TNUMBER)
+                {
+                    err = _slwBuffer_byte(buf, '"') ? _slwJson_encodenumber(L, -2, buf) : _SLW_VALUE_NOMEM;
+                    if (err == _SLW_VALUE_OK && !_slwBuffer_byte(buf, '"'))
+                        err = _SLW_VALUE_NOMEM;
+                } else if (err == _SLW_VALUE_OK)
+                {
+                    err = keyType;
+                }
+
+                if (err == _SLW_VALUE_OK)
+                    err = _slwBuffer_byte(buf, ':') ? _slwJson_encode(L, -1, buf, depth + 1) : _SLW_VALUE_NOMEM;
+                lua_pop(L, 1);
+                if (err != _SLW_VALUE_OK)
+                {
+                    lua_pop(L, 1);
+                    return err;
+                }
+            }
+
+            ok = _slwBuffer_byte(buf, '}');
+            break;
+        }
+        default:
+            return type;
+    }
+
+    return ok ? _SLW_VALUE_OK : _SLW_VALUE_NOMEM;
+}
+
+// Decoding
+enum
+{
+    _SLW_JSON_VALUE,       // The document, an array element after ',' or an object value after ':'
+    _SLW_JSON_FIRST_VALUE, // After '[': a value or ']'
+    _SLW_JSON_FIRST_KEY,   // After '{': a key or '}'
+    _SLW_JSON_KEY,         // After ',' in an object
+    _SLW_JSON_COLON,
+    _SLW_JSON_NEXT,        // After a value: ',' or the closing bracket
+    _SLW_JSON_DONE,        // Only whitespace can follow
+    _SLW_JSON_ERROR
+};
+
+// Tokens that can continue in the next piece
+enum
+{
+    _SLW_JSON_TOKEN_NONE,
+    _SLW_JSON_TOKEN_STRING,
+    _SLW_JSON_TOKEN_NUMBER,
+    _SLW_JSON_TOKEN_LITERAL
+};
+
+typedef struct _slwJsonFrame
+{
+    bool object;
+    int pending;  // Items on the stack above the table's slot (pairs count as one)
+    size_t count; // Items so far
+} _slwJsonFrame;
+
+struct slwJsonDecoder
+{
+    lua_State* L;      // Where the C API pushes results
+    lua_State* T;      // Holds the values that are still being built
+    int ref;           // Keeps `T` alive
+    uint8_t state;
+    uint8_t token;
+    bool key;          // The string being read is an object key
+    bool escape;       // The last piece ended inside an escape
+    size_t offset;     // Bytes fed so far, for error messages
+    _slwBuffer text;   // The token that continues from the last piece (raw), unescaped strings
+    int depth;
+    _slwJsonFrame frames[SLW_JSON_MAX_DEPTH];
+    char error[80];
+};
+
+SLW_INTERNAL bool
+_slwJson_fail(slwJsonDecoder* dec, const uint8_t* at, const uint8_t* start, const char* what)
+{
+    snprintf(dec->error, sizeof(dec->error), "json: %s at byte %zu", what, dec->offset + (size_t)(at - start) + 1);
+    dec->state = _SLW_JSON_ERROR;
+    return false;
+}
+
+SLW_INTERNAL int
+_slwJson_hex(uint8_t c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    c |= 0x20;
+    return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+SLW_INTERNAL bool
+_slwJson_hex4(const uint8_t* p, const uint8_t* end, uint32_t* out)
+{
+    if (end - p < 4)
+        return false;
+
+    *out = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        const int h = _slwJson_hex(p[i]);
+        if (h < 0)
+            return false;
+        *out = (*out << 4) | (uint32_t)h;
+    }
+    return true;
+}
+
+// Unescapes in place (it never grows) and returns the new length, or (size_t)-1 for a bad escape
+SLW_INTERNAL size_t
+_slwJson_unescape(uint8_t* str, size_t len)
+{
+    const uint8_t* p = str;
+    const uint8_t* end = str + len;
+    uint8_t* out = str;
+
+    while (p < end)
+    {
+        if (*p != '\\')
+        {
+            *out++ = *p++;
+            continue;
+        }
+
+        if (++p == end)
+            return (size_t)-1;
+
+        switch (*p++)
+        {
+            case '"':  *out++ = '"';  break;
+            case '\\': *out++ = '\\'; break;
+            case '/':  *out++ = '/';  break;
+            case 'b':  *out++ = '\b'; break;
+            case 'f':  *out++ = '\f'; break;
+            case 'n':  *out++ = '\n'; break;
+            case 'r':  *out++ = '\r'; break;
+            case 't':  *out++ = '\t'; break;
+            case 'u':
+            {
+                uint32_t cp, low;
+                if (!_slwJson_hex4(p, end, &cp))
+                    return (size_t)-1;
+                p += 4;
+
+                // Surrogate pair
+                if (cp >= 0xD800 && cp <= 0xDBFF)
+                {
+                    if (end - p < 6 || p[0] != '\\' || p[1] != 'u' || !_slwJson_hex4(p + 2, end, &low) || low < 0xDC00 || low > 0xDFFF)
+                        return (size_t)-1;
+                    p += 6;
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                } else if (cp >= 0xDC00 && cp <= 0xDFFF)
+                {
+                    return (size_t)-1;
+                }
+
+                if (cp < 0x80)
+                {
+                    *out++ = (uint8_t)cp;
+                } else if (cp < 0x800)
+                {
+                    *out++ = (uint8_t)(0xC0 | (cp >> 6));
+                    *out++ = (uint8_t)(0x80 | (cp & 0x3F));
+                } else if (cp < 0x10000)
+                {
+                    *out++ = (uint8_t)(0xE0 | (cp >> 12));
+                    *out++ = (uint8_t)(0x80 | ((cp >> 6) & 0x3F));
+                    *out++ = (uint8_t)(0x80 | (cp & 0x3F));
+                } else
+                {
+                    *out++ = (uint8_t)(0xF0 | (cp >> 18));
+                    *out++ = (uint8_t)(0x80 | ((cp >> 12) & 0x3F));
+                    *out++ = (uint8_t)(0x80 | ((cp >> 6) & 0x3F));
+                    *out++ = (uint8_t)(0x80 | (cp & 0x3F));
+                }
+                break;
+            }
+            default:
+                return (size_t)-1;
+        }
+    }
+
+    return (size_t)(out - str);
+}
+
+// Moves the pending items of the top frame into its table, making the table first
+SLW_INTERNAL bool
+_slwJson_flush(slwJsonDecoder* dec)
+{
+    lua_State* T = dec->T;
+    _slwJsonFrame* frame = &dec->frames[dec->depth - 1];
+    const int base = lua_gettop(T) - frame->pending * (frame->object ? 2 : 1);
+    if (!lua_checkstack(T, 3))
+        return false;
+
+    if (lua_isnil(T, base))
+    {
+        const int hint = frame->count > INT_MAX ? 0 : (int)frame->count;
+        lua_createtable(T, frame->object ? 0 : hint, frame->object ? hint : 0);
+        lua_replace(T, base);
+    }
+
+    if (frame->object)
+    {
+        // In order, the last of duplicate keys wins
+        for (int i = 0; i < frame->pending; i++)
+        {
+            lua_pushvalue(T, base + 1 + 2 * i);
+            lua_pushvalue(T, base + 2 + 2 * i);
+            lua_rawset(T, base);
+        }
+        lua_settop(T, base);
+    } else
+    {
+        const size_t first = frame->count - (size_t)frame->pending;
+        for (int i = frame->pending; i > 0; i--)
+            lua_rawseti(T, base, (lua_Integer)(first + (size_t)i));
+    }
+
+    frame->pending = 0;
+    return true;
+}
+
+// A value was pushed, it's the document or goes into the open array or object
+SLW_INTERNAL bool
+_slwJson_valuedone(slwJsonDecoder* dec)
+{
+    if (dec->depth == 0)
+    {
+        dec->state = _SLW_JSON_DONE;
+        return true;
+    }
+
+    _slwJsonFrame* frame = &dec->frames[dec->depth - 1];
+    frame->pending++;
+    frame->count++;
+    dec->state = _SLW_JSON_NEXT;
+
+    // nil and NaN can't be keys, they don't exist in JSON anyway
+    return frame->pending < _SLW_JSON_FLUSH || _slwJson_flush(dec);
+}
+
+SLW_INTERNAL bool
+_slwJson_open(slwJsonDecoder* dec, bool object)
+{
+    if (dec->depth >= SLW_JSON_MAX_DEPTH || !lua_checkstack(dec->T, 4))
+        return false;
+
+    // The table's slot, the table is made once its size is known
+    lua_pushnil(dec->T);
+    _slwJsonFrame* frame = &dec->frames[dec->depth++];
+    frame->object = object;
+    frame->pending = 0;
+    frame->count = 0;
+    dec->state = object ? _SLW_JSON_FIRST_KEY : _SLW_JSON_FIRST_VALUE;
+    return true;
+}
+
+SLW_INTERNAL bool
+_slwJson_close(slwJsonDecoder* dec)
+{
+    if (!_slwJson_flush(dec))
+        return false;
+    dec->depth--;
+    return _slwJson_valuedone(dec);
+}
+
+// Pushes the number or literal in `dec->text`
+SLW_INTERNAL bool
+_slwJson_scalar(slwJsonDecoder* dec)
+{
+    lua_State* T = dec->T;
+    const char* str = (const char*)dec->text.data;
+    const size_t len = dec->text.size;
+
+    if (dec->token == _SLW_JSON_TOKEN_LITERAL)
+    {
+        if (len == 4 && memcmp(str, "true", 4) == 0)
+            lua_pushboolean(T, 1);
+        else if (len == 5 && memcmp(str, "false", 5) == 0)
+            lua_pushboolean(T, 0);
+        else if (len == 4 && memcmp(str, "null", 4) == 0)
+            lua_pushlightuserdata(T, NULL);
+        else
+            return false;
+        return true;
+    }
+
+    // -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+    size_t i = str[0] == '-';
+    const size_t intStart = i;
+    while (i < len && str[i] >= '0' && str[i] <= '9')
+        i++;
+    const size_t intDigits = i - intStart;
+    if (intDigits == 0 || (intDigits > 1 && str[intStart] == '0'))
+        return false;
+
+    bool integer = true;
+    if (i < len && str[i] == '.')
+    {
+        const size_t start = ++i;
+        while (i < len && str[i] >= '0' && str[i] <= '9')
+            i++;
+        if (i == start)
+            return false;
+        integer = false;
+    }
+    if (i < len && (str[i] == 'e' || str[i] == 'E'))
+    {
+        i += i + 1 < len && (str[i + 1] == '+' || str[i + 1] == '-');
+        const size_t start = ++i;
+        while (i < len && str[i] >= '0' && str[i] <= '9')
+            i++;
+        if (i == start)
+            return false;
+        integer = false;
+    }
+    if (i != len)
+        return false;
+
+    // Integers that fit in 64 bits stay integers
+    if (integer && intDigits <= 20)
+    {
+        uint64_t n = 0;
+        bool fits = true;
+        for (size_t d = intStart; d < len && fits; d++)
+        {
+            const uint64_t digit = (uint64_t)(str[d] - '0');
+            fits = n <= (UINT64_MAX - digit) / 10;
+            n = n * 10 + digit;
+        }
+
+        if (fits && n <= (intStart ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX))
+        {
+            _slwMsgpack_pushinteger(T, intStart ? (int64_t)(0 - n) : (int64_t)n);
+            return true;
+        }
+    }
+
+    // `text` always has room for the terminator, see `_slwJson_take`
+    dec->text.data[len] = '\0';
+    lua_pushnumber(T, (lua_Number)strtod(str, NULL));
+    return true;
+}
+
+// Appends to `dec->text`, leaving a byte free for a terminator
+SLW_INTERNAL bool
+_slwJson_take(slwJsonDecoder* dec, const uint8_t* p, size_t n)
+{
+    return _slwBuffer_reserve(&dec->text, n + 1) && _slwBuffer_write(&dec->text, p, n);
+}
+
+SLW_INTERNAL bool
+_slwJson_stringdone(slwJsonDecoder* dec, const uint8_t* str, size_t len)
+{
+    lua_pushlstring(dec->T, (const char*)str, len);
+    dec->token = _SLW_JSON_TOKEN_NONE;
+    dec->text.size = 0;
+
+    if (dec->key)
+    {
+        dec->state = _SLW_JSON_COLON;
+        return true;
+    }
+    return _slwJson_valuedone(dec);
+}
+
+// Reads a string from after its opening quote (or from where the last piece stopped) and sets `*p` after it
+SLW_INTERNAL bool
+_slwJson_string(slwJsonDecoder* dec, const uint8_t** p, const uint8_t* start, const uint8_t* end)
+{
+    // All in this piece without escapes, pushed straight from the input
+    if (dec->text.size == 0 && !dec->escape)
+    {
+        const uint8_t* stop = _slwJson_scanstring(*p, end);
+        if (stop < end && *stop == '"')
+        {
+            const uint8_t* str = *p;
+            *p = stop + 1;
+            return _slwJson_stringdone(dec, str, (size_t)(stop - str));
+        }
+    }
+
+    while (*p < end)
+    {
+        if (dec->escape)
+        {
+            if (!_slwJson_take(dec, *p, 1))
+                return _slwJson_fail(dec, *p, start, "not enough memory");
+            (*p)++;
+            dec->escape = false;
+            continue;
+        }
+
+        const uint8_t* stop = _slwJson_scanstring(*p, end);
+        if (!_slwJson_take(dec, *p, (size_t)(stop - *p)))
+            return _slwJson_fail(dec, stop, start, "not enough memory");
+        *p = stop;
+        if (stop == end)
+            break;
+
+        if (*stop == '"')
+        {
+            *p = stop + 1;
+            const size_t len = _slwJson_unescape(dec->text.data, dec->text.size);
+            if (len == (size_t)-1)
+                return _slwJson_fail(dec, stop, start, "bad escape in string");
+            return _slwJson_stringdone(dec, dec->text.data, len);
+        }
+
+        if (*stop == '\\')
+        {
+            if (!_slwJson_take(dec, stop, 1))
+                return _slwJson_fail(dec, stop, start, "not enough memory");
+            *p = stop + 1;
+            dec->escape = true;
+            continue;
+        }
+
+        return _slwJson_fail(dec, stop, start, "control character in string");
+    }
+
+    // Continues in the next piece
+    return true;
+}
+
+SLW_INTERNAL SLW_INLINE bool
+_slwJson_isscalar(uint8_t c, uint8_t token)
+{
+    if (token == _SLW_JSON_TOKEN_LITERAL)
+        return c >= 'a' && c <= 'z';
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+SLW_INTERNAL bool
+_slwJsonDecoder_feed(slwJsonDecoder* dec, const uint8_t* p, const uint8_t* end)
+{
+    const uint8_t* start = p;
+    if (dec->state == _SLW_JSON_ERROR)
+        return false;
+
+    while (p < end)
+    {
+        if (dec->token == _SLW_JSON_TOKEN_STRING)
+        {
+            if (!_slwJson_string(dec, &p, start, end))
+                return false;
+            continue;
+        }
+
+        if (dec->token != _SLW_JSON_TOKEN_NONE)
+        {
+            const uint8_t* tokenEnd = p;
+            while (tokenEnd < end && _slwJson_isscalar(*tokenEnd, dec->token))
+                tokenEnd++;
+            if (!_slwJson_take(dec, p, (size_t)(tokenEnd - p)))
+                return _slwJson_fail(dec, p, start, "not enough memory");
+            p = tokenEnd;
+            if (p == end)
+                break;
+
+            if (!_slwJson_scalar(dec))
+                return _slwJson_fail(dec, p, start, "bad number or literal");
+            dec->token = _SLW_JSON_TOKEN_NONE;
+            dec->text.size = 0;
+            if (!_slwJson_valuedone(dec))
+                return _slwJson_fail(dec, p, start, "not enough memory");
+            continue;
+        }
+
+        p = _slwJson_skipspace(p, end);
+        if (p == end)
+            break;
+
+        const uint8_t c = *p;
+        bool ok = true;
+        switch (dec->state)
+        {
+            case _SLW_JSON_FIRST_VALUE:
+                if (c == ']')
+                {
+                    p++;
+                    ok = _slwJson_close(dec);
+                    break;
+                }
+                // fallthrough
+            case _SLW_JSON_VALUE:
+                if (!lua_checkstack(dec->T, 4))
+                    return _slwJson_fail(dec, p, start, "document too big");
+
+                if (c == '{' || c == '[')
+                {
+                    p++;
+                    if (!_slwJson_open(dec, c == '{'))
+                        return _slwJson_fail(dec, p, start, "nested too deep");
+                } else if (c == '"')
+                {
+                    p++;
+                    dec->token = _SLW_JSON_TOKEN_STRING;
+                    dec->key = false;
+                } else if (c == '-' || (c >= '0' && c <= '9'))
+                {
+                    dec->token = _SLW_JSON_TOKEN_NUMBER;
+                } else if (c >= 'a' && c <= 'z')
+                {
+                    dec->token = _SLW_JSON_TOKEN_LITERAL;
+                } else
+                {
+                    return _slwJson_fail(dec, p, start, "unexpected character");
+                }
+                break;
+            case _SLW_JSON_FIRST_KEY:
+                if (c == '}')
+                {
+                    p++;
+                    ok = _slwJson_close(dec);
+                    break;
+                }
+                // fallthrough
+            case _SLW_JSON_KEY:
+                if (c != '"' || !lua_checkstack(dec->T, 4))
+                    return _slwJson_fail(dec, p, start, "expected a key");
+                p++;
+                dec->token = _SLW_JSON_TOKEN_STRING;
+                dec->key = true;
+                break;
+            case _SLW_JSON_COLON:
+                if (c != ':')
+                    return _slwJson_fail(dec, p, start, "expected ':'");
+                p++;
+                dec->state = _SLW_JSON_VALUE;
+                break;
+            case _SLW_JSON_NEXT:
+            {
+                const bool object = dec->frames[dec->depth - 1].object;
+                if (c == ',')
+                    dec->state = object ? _SLW_JSON_KEY : _SLW_JSON_VALUE;
+                else if (c == (object ? '}' : ']'))
+                    ok = _slwJson_close(dec);
+                else
+                    return _slwJson_fail(dec, p, start, object ? "expected ',' or '}'" : "expected ',' or ']'");
+                p++;
+                break;
+            }
+            default:
+                return _slwJson_fail(dec, p, start, "unexpected character after the document");
+        }
+
+        if (!ok)
+            return _slwJson_fail(dec, p, start, "not enough memory");
+    }
+
+    dec->offset += (size_t)(end - start);
+    return true;
+}
+
+// Pushes the document onto `L` (or the error message) and resets `dec` for the next one
+SLW_INTERNAL bool
+_slwJsonDecoder_finish(slwJsonDecoder* dec, lua_State* L)
+{
+    const uint8_t* end = (const uint8_t*)"";
+    if (dec->state != _SLW_JSON_ERROR && (dec->token == _SLW_JSON_TOKEN_NUMBER || dec->token == _SLW_JSON_TOKEN_LITERAL))
+    {
+        if (!_slwJson_scalar(dec))
+            _slwJson_fail(dec, end, end, "bad number or literal");
+        else
+            (void)_slwJson_valuedone(dec);
+        dec->token = _SLW_JSON_TOKEN_NONE;
+    }
+    if (dec->state != _SLW_JSON_ERROR && dec->state != _SLW_JSON_DONE)
+        _slwJson_fail(dec, end, end, "unexpected end of input");
+
+    const bool ok = dec->state == _SLW_JSON_DONE;
+    if (ok)
+        lua_xmove(dec->T, L, 1);
+    else
+        lua_pushstring(L, dec->error);
+
+    lua_settop(dec->T, 0);
+    dec->state = _SLW_JSON_VALUE;
+    dec->token = _SLW_JSON_TOKEN_NONE;
+    dec->escape = false;
+    dec->offset = 0;
+    dec->text.size = 0;
+    dec->depth = 0;
+    return ok;
+}
+
+SLW_INTERNAL slwJsonDecoder*
+_slwJsonDecoder_create(lua_State* L)
+{
+    slwJsonDecoder* dec = (slwJsonDecoder*)slw_calloc(1, sizeof(slwJsonDecoder));
+    if (!dec)
+        return NULL;
+
+    dec->L = L;
+    dec->T = lua_newthread(L);
+    dec->ref = luaL_ref(L, LUA_REGISTRYINDEX);
+    dec->state = _SLW_JSON_VALUE;
+    return dec;
+}
+
+SLW_INTERNAL int
+_slwJson_lencode(lua_State* L)
+{
+    _slwBuffer* buf = (_slwBuffer*)lua_touserdata(L, lua_upvalueindex(1));
+    luaL_checkany(L, 1);
+    lua_settop(L, 1);
+
+    // The buffer is kept between calls, only its contents are thrown away
+    buf->size = 0;
+    const int err = _slwJson_encode(L, 1, buf, 0);
+    if (err == _SLW_VALUE_TOODEEP)
+        return luaL_error(L, "json: can't encode a table nested deeper than %d (or with a cycle)", SLW_RECURSION_DEPTH);
+    else if (err == _SLW_VALUE_NOMEM)
+        return luaL_error(L, "not enough memory");
+    else if (err == _SLW_JSON_BADNUMBER)
+        return luaL_error(L, "json: can't encode NaN or infinity");
+    else if (err != _SLW_VALUE_OK)
+        return luaL_error(L, "json: can't encode a %s value", lua_typename(L, err));
+
+    lua_pushlstring(L, (const char*)buf->data, buf->size);
+    return 1;
+}
+
+SLW_INTERNAL int
+_slwJson_ldecode(lua_State* L)
+{
+    size_t len;
+    const char* str = luaL_checklstring(L, 1, &len);
+    slwState view = slwState_view(L);
+    if (!slwJson_decode(&view, str, len))
+        return lua_error(L);
+    return 1;
+}
+
+SLW_INTERNAL slwJsonDecoder*
+_slwJsonDecoder_self(lua_State* L)
+{
+    slwState view = slwState_view(L);
+    slwJsonDecoder** self = (slwJsonDecoder**)slwClass_check(&view, 1);
+    if (!*self)
+        luaL_error(L, "json decoder is closed");
+    return *self;
+}
+
+SLW_INTERNAL int
+_slwJsonDecoder_lfeed(lua_State* L)
+{
+    slwJsonDecoder* dec = _slwJsonDecoder_self(L);
+    size_t len;
+    const char* str = luaL_checklstring(L, 2, &len);
+    if (!_slwJsonDecoder_feed(dec, (const uint8_t*)str, (const uint8_t*)str + len))
+        return luaL_error(L, "%s", dec->error);
+    return 0;
+}
+
+SLW_INTERNAL int
+_slwJsonDecoder_lfinish(lua_State* L)
+{
+    if (!_slwJsonDecoder_finish(_slwJsonDecoder_self(L), L))
+        return lua_error(L);
+    return 1;
+}
+
+SLW_INTERNAL void
+_slwJsonDecoder_gc(void* self)
+{
+    slwJsonDecoder** dec = (slwJsonDecoder**)self;
+    if (*dec)
+        slwJsonDecoder_destroy(*dec);
+    *dec = NULL;
+}
+
+SLW_INTERNAL const slwClassMethod _slwJsonDecoderMethods[] = {
+    { "feed",   _slwJsonDecoder_lfeed },
+    { "finish", _slwJsonDecoder_lfinish },
+    { NULL, NULL }
+};
+
+SLW_INTERNAL const slwClass _slwJsonDecoderClass = {
+    .name = "slwJsonDecoder",
+    .size = sizeof(slwJsonDecoder*),
+    .methods = _slwJsonDecoderMethods,
+    .gc = _slwJsonDecoder_gc,
+};
+
+SLW_INTERNAL int
+_slwJson_ldecoder(lua_State* L)
+{
+    slwState view = slwState_view(L);
+    slwClass_register(&view, &_slwJsonDecoderClass);
+    slwJsonDecoder** self = (slwJsonDecoder**)slwClass_new(&view, &_slwJsonDecoderClass);
+    *self = _slwJsonDecoder_create(L);
+    if (!*self)
+        return luaL_error(L, "not enough memory");
+    return 1;
+}
+
+// Table Library
+//----------------------------------
+// Raw access only, metamethods are skipped the way `rawset`/`rawget` skip them.
+SLW_INTERNAL int
+_slwTablelib_new(lua_State* L)
+{
+    const lua_Integer narr = luaL_optinteger(L, 1, 0);
+    const lua_Integer nrec = luaL_optinteger(L, 2, 0);
+    luaL_argcheck(L, narr >= 0 && narr <= INT_MAX, 1, "out of range");
+    luaL_argcheck(L, nrec >= 0 && nrec <= INT_MAX, 2, "out of range");
+    lua_createtable(L, (int)narr, (int)nrec);
+    return 1;
+}
+
+// Removes every key but keeps the table's parts allocated, so refilling it doesn't rehash
+SLW_INTERNAL int
+_slwTablelib_clear(lua_State* L)
+{
+    luaL_checktype(L, 1, LUA_TTABLE);
+    lua_settop(L, 1);
+
+    // Clearing fields during a traversal is allowed, the key stays on the stack for `lua_next`
+    lua_pushnil(L);
+    while (lua_next(L, 1) != 0)
+    {
+        lua_pop(L, 1);
+        lua_pushvalue(L, -1);
+        lua_pushnil(L);
+        lua_rawset(L, 1);
+    }
+    return 0;
+}
+
+// `copy(src, f, e, t [, dst])` is `table.move` without metamethods, returns `dst`
+SLW_INTERNAL int
+_slwTablelib_copy(lua_State* L)
+{
+    luaL_checktype(L, 1, LUA_TTABLE);
+    const lua_Integer f = luaL_checkinteger(L, 2);
+    const lua_Integer e = luaL_checkinteger(L, 3);
+    const lua_Integer t = luaL_checkinteger(L, 4);
+    const int dst = lua_isnoneornil(L, 5) ? 1 : 5;
+    luaL_checktype(L, dst, LUA_TTABLE);
+
+    if (e >= f)
+    {
+        luaL_argcheck(L, f > 0 || e < LUA_MAXINTEGER + f, 3, "too many elements to move");
+        const lua_Integer n = e - f;
+        luaL_argcheck(L, t <= LUA_MAXINTEGER - n, 4, "destination wrap around");
+
+        // Backwards when the ranges overlap with the destination after the source
+        if (t > e || t <= f || (dst != 1 && !lua_rawequal(L, 1, dst)))
+        {
+            for (lua_Integer i = 0; i <= n; i++)
+            {
+                lua_rawgeti(L, 1, f + i);
+                lua_rawseti(L, dst, t + i);
+            }
+        } else
+        {
+            for (lua_Integer i = n; i >= 0; i--)
+            {
+                lua_rawgeti(L, 1, f + i);
+                lua_rawseti(L, dst, t + i);
+            }
+        }
+    }
+
+    lua_pushvalue(L, dst);
+    return 1;
+}
+
+// `fill(t, value [, i [, j]])` sets `t[i..j]` (1 and `#t` by default) to `value`, returns `t`
+SLW_INTERNAL int
+_slwTablelib_fill(lua_State* L)
+{
+    luaL_checktype(L, 1, LUA_TTABLE);
+    luaL_checkany(L, 2);
+    const lua_Integer i = luaL_optinteger(L, 3, 1);
+#if LUA_VERSION_NUM > 501
+    const lua_Integer j = luaL_opt(L, luaL_checkinteger, 4, (lua_Integer)lua_rawlen(L, 1));
+#else
+    const lua_Integer j = luaL_opt(L, luaL_checkinteger, 4, (lua_Integer)lua_objlen(L, 1));
+#endif
+    lua_settop(L, 2);
+
+    for (lua_Integer k = i; k <= j; k++)
+    {
+        lua_pushvalue(L, 2);
+        lua_rawseti(L, 1, k);
+
+        // `k++` would overflow
+        if (k == j)
+            break;
+    }
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+SLW_INTERNAL const luaL_Reg _slwTablelib[] = {
+    { "new",   _slwTablelib_new },
+    { "clear", _slwTablelib_clear },
+    { "copy",  _slwTablelib_copy },
+    { "fill",  _slwTablelib_fill },
+    { NULL, NULL }
+};
+
+// Event Dispatch
+//----------------------------------
+// A handler's registry table holds its function at 1 and the argument table of nesting level n at n + 1.
+#define _SLW_EVENT_LEVELS 8
+
+// The keys the argument table of a level was last filled with
+typedef struct _slwEventShape
+{
+    uint64_t hash; // Of the key names, 0 for indexed tables
+    size_t size;
+} _slwEventShape;
+
+struct slwEventHandler
+{
+    slwState* slw;
+    int ref;
+    int depth; // Dispatches in progress, a handler can cause another event for itself
+    _slwEventShape shapes[_SLW_EVENT_LEVELS];
+};
+
+SLW_INTERNAL uint64_t
+_slwEvent_shape(const slwTable* event)
+{
+    if (event->size == 0 || !event->elements[0].name)
+        return 0;
+
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < event->size; i++)
+        hash = (hash ^ _slw_fnv1a(event->elements[i].name, strlen(event->elements[i].name))) * 1099511628211ull;
+    return hash | 1;
+}
+
+// Whether `key` (at the top of the stack) is one `event` sets
+SLW_INTERNAL bool
+_slwEvent_haskey(lua_State* L, const slwTable* event, bool named)
+{
+    if (!named)
+    {
+        if (!lua_isinteger(L, -1))
+            return false;
+        const lua_Integer i = lua_tointeger(L, -1);
+        return i >= 1 && (uint64_t)i <= event->size;
+    }
+
+    if (lua_type(L, -1) != LUA_TSTRING)
+        return false;
+    const char* key = lua_tostring(L, -1);
+    for (size_t i = 0; i < event->size; i++)
+    {
+        if (strcmp(event->elements[i].name, key) == 0)
+            return true;
+    }
+    return false;
+}
+
+// Removes the keys a handler added to the table at the top of the stack, `kept` is how many the refill set
+SLW_INTERNAL void
+_slwEvent_trim(lua_State* L, const slwTable* event, bool named, size_t kept)
+{
+    size_t count = 0;
+    lua_pushnil(L);
+    while (lua_next(L, -2) != 0)
+    {
+        lua_pop(L, 1);
+        count++;
+    }
+    if (count <= kept)
+        return;
+
+    lua_pushnil(L);
+    while (lua_next(L, -2) != 0)
+    {
+        lua_pop(L, 1);
+        if (!_slwEvent_haskey(L, event, named))
+        {
+            lua_pushvalue(L, -1);
+            lua_pushnil(L);
+            lua_rawset(L, -4);
+        }
+    }
+}
+
+// Refills the table at the top of the stack with `event`, like `slwTable_push` would have made it
+SLW_INTERNAL void
+_slwEvent_fill(slwState* slw, const slwTable* event, _slwEventShape* shape)
+{
+    lua_State* L = slw->LState;
+    const uint64_t hash = _slwEvent_shape(event);
+
+    // Same keys as last time are overwritten in place, a different set of keys starts from an empty table
+    const bool reuse = hash == shape->hash && (!hash || event->size == shape->size);
+    if (!reuse)
+    {
+        lua_pushnil(L);
+        while (lua_next(L, -2) != 0)
+        {
+            lua_pop(L, 1);
+            lua_pushvalue(L, -1);
+            lua_pushnil(L);
+            lua_rawset(L, -4);
+        }
+    } else if (!hash)
+    {
+        for (size_t i = event->size + 1; i <= shape->size; i++)
+        {
+            lua_pushnil(L);
+            lua_rawseti(L, -2, (lua_Integer)i);
+        }
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < event->size; i++)
+    {
+        const slwTableValue el = event->elements[i];
+        if (hash)
+        {
+            lua_pushstring(L, el.name);
+            _slwTable_push_value(slw, el);
+            kept += !lua_isnil(L, -1);
+            lua_rawset(L, -3);
+        } else
+        {
+            _slwTable_push_value(slw, el);
+            kept += !lua_isnil(L, -1);
+            lua_rawseti(L, -2, (lua_Integer)(i + 1));
+        }
+    }
+
+    // Keys the handler added last time would still be there
+    if (reuse)
+        _slwEvent_trim(L, event, hash != 0, kept);
+
+    shape->hash = hash;
+    shape->size = event->size;
+}
+
+// Calls the handler (its registry table is at `pool`) with `event`
+SLW_INTERNAL bool
+_slwEvent_dispatch(slwEventHandler* handler, int pool, const slwTable* event)
+{
+    slwState* slw = handler->slw;
+    lua_State* L = slw->LState;
+    const int level = handler->depth;
+
+    lua_rawgeti(L, pool, 1);
+    if (level >= _SLW_EVENT_LEVELS)
+    {
+        // Deeper than the pool goes, a table of its own
+        slwTable_push(slw, (slwTable*)event);
+    } else
+    {
+        lua_rawgeti(L, pool, level + 2);
+        if (lua_isnil(L, -1))
+        {
+            lua_pop(L, 1);
+            const bool keyed = event->size && event->elements[0].name;
+            lua_createtable(L, keyed ? 0 : (int)event->size, keyed ? (int)event->size : 0);
+            lua_pushvalue(L, -1);
+            lua_rawseti(L, pool, level + 2);
+            handler->shapes[level].hash = 0;
+            handler->shapes[level].size = 0;
+        }
+        _slwEvent_fill(slw, event, &handler->shapes[level]);
+    }
+
+    handler->depth++;
+    const bool ok = _slwState_pcall(slw, 1, 0) == 0;
+    handler->depth--;
+    return ok;
+}
+
+// Key Paths
+//----------------------------------
+// Only the address is used, registry key of the state's path epoch (a userdata so paths can keep a pointer to it).
+SLW_INTERNAL const char _slwPathEpochKey = 0;
+
+struct slwPath
+{
+    lua_State* L;
+    uint64_t* epoch;   // Bumped by `slwPath_invalidate`
+    uint64_t version;  // Epoch `parent` was resolved in, 0 when it isn't
+    int keys;          // Registry ref of the keys as Lua strings, 1..count
+    int parent;        // Registry ref of the table holding the last key
+    int grand;         // Registry ref of the table holding `parent`, unused for one key
+    int link;          // Registry ref of the key `parent` is under in `grand`
+    int leaf;          // Registry ref of the last key
+    int count;
+};
+
+SLW_INTERNAL uint64_t*
+_slwPath_epoch(lua_State* L)
+{
+    uint64_t* epoch = (uint64_t*)_slw_registry_getp(L, &_slwPathEpochKey);
+    if (epoch)
+        return epoch;
+
+    lua_pushlightuserdata(L, (void*)&_slwPathEpochKey);
+    epoch = (uint64_t*)lua_newuserdata(L, sizeof(uint64_t));
+    *epoch = 1;
+    lua_rawset(L, LUA_REGISTRYINDEX);
+    return epoch;
+}
+
+// `slwPath_invalidate` for cslw's own calls and global writes, a no-op while the state has no paths
+SLW_INTERNAL void
+_slwPath_bump(lua_State* L)
+{
+    uint64_t* epoch = (uint64_t*)_slw_registry_getp(L, &_slwPathEpochKey);
+    if (epoch)
+        (*epoch)++;
+}
+
+// Walks to the table holding the last key and caches it, `create` makes missing tables like `slwState_settable2`
+SLW_INTERNAL bool
+_slwPath_resolve(slwPath* path, bool create)
+{
+    lua_State* L = path->L;
+    if (!lua_checkstack(L, 4))
+        return false;
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, path->keys);
+    const int keys = lua_gettop(L);
+    _slw_pushglobals(L);
+
+    for (int i = 1; i < path->count; i++)
+    {
+        lua_rawgeti(L, keys, i);
+        lua_rawget(L, -2);
+        if (lua_isnil(L, -1) && create)
+        {
+            lua_pop(L, 1);
+            lua_newtable(L);
+            lua_rawgeti(L, keys, i);
+            lua_pushvalue(L, -2);
+            lua_rawset(L, -4);
+        }
+
+        if (!lua_istable(L, -1))
+        {
+            lua_settop(L, keys - 1);
+            return false;
+        }
+
+        if (i == path->count - 1)
+        {
+            lua_pushvalue(L, -2);
+            lua_rawseti(L, LUA_REGISTRYINDEX, path->grand);
+        }
+        lua_remove(L, -2);
+    }
+
+    lua_rawseti(L, LUA_REGISTRYINDEX, path->parent);
+    lua_pop(L, 1);
+    path->version = *path->epoch;
+    return true;
+}
+
+// Pushes the table holding the last key, or returns false (nothing pushed)
+SLW_INTERNAL bool
+_slwPath_pushparent(slwPath* path, bool create)
+{
+    lua_State* L = path->L;
+    if (path->version == *path->epoch)
+    {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, path->parent);
+        if (path->count < 2)
+            return true;
+
+        // Lua code in between cslw calls (inside a C function) can replace it without bumping the epoch,
+        // the last link is checked every time. Tables further up aren't, see `slwPath_compile`.
+        lua_rawgeti(L, LUA_REGISTRYINDEX, path->grand);
+        lua_rawgeti(L, LUA_REGISTRYINDEX, path->link);
+        lua_rawget(L, -2);
+        const bool same = lua_rawequal(L, -1, -3);
+        lua_pop(L, 2);
+        if (same)
+            return true;
+        lua_pop(L, 1);
+    }
+
+    if (!_slwPath_resolve(path, create))
+        return false;
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, path->parent);
+    return true;
+}
+
+// Table Bindings
+//----------------------------------
+// A bound `slwTable` remembers the Lua table it was pushed as and which of its elements changed since.
+struct _slwTableBinding
+{
+    lua_State* L;
+    int ref;
+    uint64_t* bits;   // Dirty elements, by index
+    size_t words;
+    size_t* dirty;    // The same elements in the order they changed
+    size_t count;
+    size_t capacity;
+    bool all;         // Tracking ran out of memory, every element is written
+    size_t* nested;   // Indices of the elements that were tables when they were written
+    size_t nestedCount;
+};
+
+SLW_INTERNAL void
+_slwTable_unbind(slwTable* slt)
+{
+    _slwTableBinding* b = slt->binding;
+    if (!b)
+        return;
+
+    luaL_unref(b->L, LUA_REGISTRYINDEX, b->ref);
+    slw_free(b->bits);
+    slw_free(b->dirty);
+    slw_free(b->nested);
+    slw_free(b);
+    slt->binding = NULL;
+}
+
+SLW_INTERNAL void
+_slwTable_findnested(slwTable* slt)
+{
+    _slwTableBinding* b = slt->binding;
+    size_t count = 0;
+    for (size_t i = 0; i < slt->size; i++)
+        count += slt->elements[i].ltype == LUA_TTABLE;
+
+    size_t* nested = count ? (size_t*)slw_realloc(b->nested, count * sizeof(size_t)) : b->nested;
+    if (count && !nested)
+    {
+        // Nested tables are still written when their element changes, they just aren't synced on their own
+        b->nestedCount = 0;
+        return;
+    }
+
+    b->nested = nested;
+    b->nestedCount = 0;
+    for (size_t i = 0; i < slt->size; i++)
+        if (slt->elements[i].ltype == LUA_TTABLE)
+            b->nested[b->nestedCount++] = i;
+}
+
+SLW_INTERNAL void _slwTable_pushbound(slwState* slw, slwTable* slt);
+
+// Pushes the element's value, nested tables as their bound Lua table
+SLW_INTERNAL void
+_slwTable_pushelement(slwState* slw, const slwTableValue* el)
+{
+    if (el->ltype == LUA_TTABLE && el->value.t)
+        _slwTable_pushbound(slw, el->value.t);
+    else if (el->ltype == LUA_TNIL)
+        lua_pushnil(slw->LState);
+    else
+        _slwTable_push_value(slw, *el);
+}
+
+// Like `slwTable_push`, but tables already bound to this state are pushed as they are and new ones get bound
+SLW_INTERNAL void
+_slwTable_pushbound(slwState* slw, slwTable* slt)
+{
+    lua_State* L = slw->LState;
+    _slwTableBinding* b = slt->binding;
+    if (b && b->L == L)
+    {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, b->ref);
+        return;
+    }
+
+    // Bound to another state, it can only follow one
+    if (b)
+    {
+        slwTable_push(slw, slt);
+        return;
+    }
+
+    const bool keyed = slt->size && slt->elements[0].name;
+    lua_createtable(L, keyed ? 0 : (int)slt->size, keyed ? (int)slt->size : 0);
+    for (size_t i = 0; i < slt->size; i++)
+    {
+        const slwTableValue* el = &slt->elements[i];
+        if (el->name)
+            lua_pushstring(L, el->name);
+        else
+            lua_pushinteger(L, (lua_Integer)(i + 1));
+        _slwTable_pushelement(slw, el);
+        lua_rawset(L, -3);
+    }
+
+    b = (_slwTableBinding*)slw_calloc(1, sizeof(_slwTableBinding));
+    if (!b)
+        return;
+
+    lua_pushvalue(L, -1);
+    b->L = L;
+    b->ref = luaL_ref(L, LUA_REGISTRYINDEX);
+    slt->binding = b;
+    _slwTable_findnested(slt);
+}
+
+// Compact Tables
+//----------------------------------
+SLW_INTERNAL SLW_INLINE uint32_t
+_slwCompact_hash(const char* name)
+{
+    // 0 is for indexed elements
+    const uint32_t hash = (uint32_t)_slw_fnv1a(name, strlen(name));
+    return hash ? hash : 1;
+}
+
+SLW_INTERNAL bool
+_slwCompact_reserve(slwCompactTable* sct, size_t n)
+{
+    if (sct->size + n <= sct->capacity)
+        return true;
+
+    size_t capacity = sct->capacity * 2;
+    while (capacity < sct->size + n)
+        capacity *= 2;
+
+    const size_t bytes = capacity * (sizeof(slwValue) + sizeof(const char*) + sizeof(uint32_t) + sizeof(uint8_t));
+    void* block = slw_malloc(bytes);
+    if (!block)
+        return false;
+
+    slwCompactTable grown = *sct;
+    grown.block = block;
+    grown.capacity = capacity;
+    memcpy(slwCompactTable_values(&grown), slwCompactTable_values(sct), sct->size * sizeof(slwValue));
+    memcpy(slwCompactTable_names(&grown), slwCompactTable_names(sct), sct->size * sizeof(const char*));
+    memcpy(slwCompactTable_hashes(&grown), slwCompactTable_hashes(sct), sct->size * sizeof(uint32_t));
+    memcpy(slwCompactTable_types(&grown), slwCompactTable_types(sct), sct->size * sizeof(uint8_t));
+
+    slw_free(sct->block);
+    sct->block = block;
+    sct->capacity = capacity;
+    return true;
+}
+
+SLW_INTERNAL void
+_slwCompact_append(slwCompactTable* sct, const char* name, uint32_t hash, slwTableValue val)
+{
+    const size_t i = sct->size++;
+    slwCompactTable_values(sct)[i] = val.value;
+    slwCompactTable_names(sct)[i] = name;
+    slwCompactTable_hashes(sct)[i] = hash;
+    slwCompactTable_types(sct)[i] = val.ltype;
+}
+
+SLW_INTERNAL void
+_slwTable_set_value(slwTable* slt, const char* key, slwTableValue val)
+{
+    slwTableValue* sltTable = slwTable_getkey(slt, key);
+    if (sltTable)
+    {
+        sltTable->value = val.value;
+        sltTable->ltype = val.ltype;
+        slwTable_touch(slt, (size_t)(sltTable - slt->elements));
+        return;
+    }
+
+    val.name = key;
+    slt->elements = (slwTableValue*)slw_realloc(slt->elements, sizeof(slwTableValue) * (slt->size + 1));
+    slt->elements[slt->size++] = val;
+    slwTable_touch(slt, slt->size - 1);
+}
+
+#if !CLW_USING_LUAJIT
+// Lua allocates through `slw_realloc`/`slw_free` too, so overriding them covers everything.
+SLW_INTERNAL void*
+_slw_lua_alloc(void* ud, void* ptr, size_t osize, size_t nsize)
+{
+    (void)ud;
+    (void)osize;
+
+    if (nsize == 0)
+    {
+        slw_free(ptr);
+        return NULL;
+    }
+
+    return slw_realloc(ptr, nsize);
+}
+#endif
+
+// Same as the one `luaL_newstate` sets
+SLW_INTERNAL int
+_slw_lua_panic(lua_State* L)
+{
+    const char* msg = lua_tostring(L, -1);
+    fprintf(stderr, "PANIC: unprotected error in call to Lua API (%s)\n", msg ? msg : "error object is not a string");
+    fflush(stderr);
+    return 0;
+}
+
+// Functions
+//------------------------------------------------------------------------
+// Primary Functions
+SLW_API void
+slwState_destroy(slwState* slw)
+{
+    SLW_CHECKSTATE(slw);
+    if (slw->LState)
+        slwState_close(slw);
+
+    if (slw->profiler)
+    {
+        slwProfiler_reset(slw);
+        slw_free(slw->profiler);
+    }
+
+    while (slw->cstats)
+    {
+        slwCStats* next = slw->cstats->next;
+        slw_free(slw->cstats);
+        slw->cstats = next;
+    }
+
+    slw_free(slw);
+    slw = NULL;
+}
+
+SLW_API slwState*
+slwState_new_empty()
+{
+#if CLW_USING_LUAJIT
+    lua_State* L = luaL_newstate(); // x64 LuaJIT doesn't accept custom allocators
+#else
+    lua_State* L = lua_newstate(_slw_lua_alloc, NULL);
+#endif
+    if (!L) return NULL;
+
+    lua_atpanic(L, _slw_lua_panic);
+
+    slwState* slw = (slwState*)slw_calloc(1, sizeof(slwState));
+    slw->LState = L;
+    _slw_registry_setp(L, &_slwStateKey, slw);
+
+    return slw;
+}
+
+SLW_API slwState*
+slwState_new_with(const uint32_t libs)
+{
+    slwState* slw = slwState_new_empty();
+    if (!slw) return NULL;
+
+    slwState_openlibraries(slw, libs);
+    return slw;
+}
+
+SLW_API slwState*
+slwState_new_from_slws(slwState* slw)
+{
+    SLW_CHECKSTATE(slw);
+    SLW_CHECKSTATE(slw);
+
+    slwState* newSLW = (slwState*)slw_calloc(1, sizeof(slwState));
+    if (!newSLW)
+        return NULL;
+
+    newSLW->LState = slw->LState;
+
+    return newSLW;
+}
+
+SLW_API slwState* slwState_new_from_luas(lua_State* L)
+{
+    SLW_ASSERT(L != NULL);
+
+    slwState* slw = (slwState*)slw_calloc(1, sizeof(slwState));
+    if (!slw)
+        return NULL;
+
+    slw->LState = L;
+
+    return slw;
+}
+
+SLW_API slwState*
+slwState_owner(lua_State* L)
+{
+    SLW_ASSERT(L != NULL);
+    return (slwState*)_slw_registry_getp(L, &_slwStateKey);
+}
+
+SLW_API slwState*
+slwState_clone(slwState* slw)
+{
+    SLW_CHECKSTATE(slw);
+
+    slwState* clone = slwState_new_with(_slwClone_libs(slw->LState));
+    if (!clone)
+        return NULL;
+
+    // Functions that are wrapped for stats get records of their own, see `_slwClone_value`
+    clone->cstatsEnabled = slw->cstatsEnabled;
+
+    _slwClone c;
+    c.from = slw->LState;
+    c.to = clone->LState;
+    c.slw = clone;
+    c.nextId = 0;
+    c.depth = 0;
+
+    const int fromTop = lua_gettop(c.from);
+    lua_settop(c.to, 0);
+
+    lua_newtable(c.from);
+    c.seen = lua_gettop(c.from);
+    lua_newtable(c.to);
+    c.made = lua_gettop(c.to);
+
+    // The globals, the loaded modules and the libraries both states have are mapped to each other up front
+#if LUA_VERSION_NUM >= 502
+    lua_rawgeti(c.from, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
+    lua_rawgeti(c.to, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
+#else
+    lua_pushvalue(c.from, LUA_GLOBALSINDEX);
+    lua_pushvalue(c.to, LUA_GLOBALSINDEX);
+#endif
+    _slwClone_remember(&c, -1, -1);
+
+    luaL_getsubtable(c.from, LUA_REGISTRYINDEX, "_LOADED");
+    luaL_getsubtable(c.to, LUA_REGISTRYINDEX, "_LOADED");
+    _slwClone_remember(&c, -1, -1);
+
+    const int fromLibs = lua_gettop(c.from) + 1;
+    const int toLibs = lua_gettop(c.to) + 1;
+    for (const _slwCloneLib* lib = _slwCloneLibs; lib->name; lib++)
+    {
+        lua_getfield(c.from, fromLibs - 1, lib->name);
+        lua_getfield(c.to, toLibs - 1, lib->name);
+        if (lua_istable(c.from, -1) && lua_istable(c.to, -1))
+        {
+            _slwClone_remember(&c, -1, -1);
+        } else
+        {
+            lua_pop(c.from, 1);
+            lua_pop(c.to, 1);
+        }
+    }
+
+    // Stacks: seen/made, globals, loaded, libraries...
+    bool ok = true;
+    for (int i = 0; ok && fromLibs + i <= lua_gettop(c.from); i++)
+        ok = _slwClone_fill(&c, fromLibs + i, toLibs + i, true);
+
+    ok = ok && _slwClone_fill(&c, fromLibs - 2, toLibs - 2, false);
+    ok = ok && _slwClone_fill(&c, fromLibs - 1, toLibs - 1, false);
+
+    lua_settop(c.from, fromTop);
+    lua_settop(c.to, 0);
+
+    if (!ok)
+    {
+        slwState_destroy(clone);
+        return NULL;
+    }
+
+    // The `_G.__index` of `slw_lib_lazy` came along with the globals, `package.preload` didn't
+    if (_slwLazy_pushpending(c.to))
+    {
+        _slwLazy_setpreload(c.to, -1);
+        lua_pop(c.to, 1);
+    }
+    return clone;
+}
+
+SLW_API bool
+slwState_snapshot(slwState* slw, const char* path)
+{
+    SLW_CHECKSTATE(slw);
+    lua_State* L = slw->LState;
+    const int top = lua_gettop(L);
+
+    _slwSnapshot s = { 0 };
+    s.L = L;
+    _slwSnapshot_builtins(L, false);
+    s.ids = lua_gettop(L);
+
+    // The id count is filled in once everything's written
+    const uint8_t header[_SLW_SNAPSHOT_HEADER] = {
+        'S', 'L', 'W', 'S', _SLW_SNAPSHOT_VERSION,
+        (uint8_t)(LUA_VERSION_NUM & 0xFF), (uint8_t)(LUA_VERSION_NUM >> 8), _SLW_SNAPSHOT_LUAJIT, 0, 0, 0, 0
+    };
+
+    int err = _slwBuffer_write(&s.buf, header, sizeof(header)) ? _SLW_VALUE_OK : _SLW_VALUE_NOMEM;
+    if (err == _SLW_VALUE_OK)
+    {
+        _slw_pushglobals(L);
+        err = _slwSnapshot_encode(&s, -1, 0);
+        lua_pop(L, 1);
+    }
+    if (err == _SLW_VALUE_OK)
+    {
+        luaL_getsubtable(L, LUA_REGISTRYINDEX, "_LOADED");
+        err = _slwSnapshot_encode(&s, -1, 0);
+        lua_pop(L, 1);
+    }
+    lua_settop(L, top);
+
+    if (err == _SLW_VALUE_OK)
+    {
+        const uint32_t ids = (uint32_t)s.nextId;
+        memcpy(s.buf.data + 8, &ids, sizeof(ids));
+    }
+
+    FILE* file = NULL;
+    if (err == _SLW_VALUE_OK)
+    {
+        file = fopen(path, "wb");
+        const bool written = file && fwrite(s.buf.data, 1, s.buf.size, file) == s.buf.size;
+        if (file && fclose(file) != 0)
+            file = NULL;
+        if (!written || !file)
+        {
+            slw_free(s.buf.data);
+            lua_pushfstring(L, "cannot write snapshot '%s'", path);
+            return false;
+        }
+    }
+    slw_free(s.buf.data);
+
+    switch (err)
+    {
+        case _SLW_VALUE_OK:
+            return true;
+        case _SLW_VALUE_TOODEEP:
+            lua_pushstring(L, "snapshot nests too deep");
+            break;
+        case _SLW_VALUE_NOMEM:
+            lua_pushstring(L, "not enough memory for the snapshot");
+            break;
+        default:
+            if (s.error)
+                lua_pushstring(L, s.error);
+            else
+                lua_pushfstring(L, "%s values can't be snapshotted", lua_typename(L, err));
+            break;
+    }
+    return false;
+}
+
+SLW_API bool
+slwState_restore(slwState* slw, const char* path)
+{
+    SLW_CHECKSTATE(slw);
+    lua_State* L = slw->LState;
+
+    _slwMapping m;
+    if (!_slwMapping_open(&m, path, true))
+    {
+        lua_pushfstring(L, "cannot open snapshot '%s'", path);
+        return false;
+    }
+
+    const uint8_t* p = m.data;
+    const uint8_t* end = m.data + m.size;
+    if (m.size < _SLW_SNAPSHOT_HEADER || memcmp(p, _SLW_SNAPSHOT_MAGIC, 4) != 0 || p[4] != _SLW_SNAPSHOT_VERSION ||
+        (p[5] | (p[6] << 8)) != LUA_VERSION_NUM || p[7] != _SLW_SNAPSHOT_LUAJIT)
+    {
+        _slwMapping_close(&m);
+        lua_pushfstring(L, "'%s' isn't a snapshot for this Lua version", path);
+        return false;
+    }
+    // Sized up front, it grows to one slot per table, function and repeated string. Every id took a couple of bytes.
+    uint32_t ids;
+    memcpy(&ids, p + 8, sizeof(ids));
+    if (ids > m.size / 2)
+        ids = 0;
+    p += _SLW_SNAPSHOT_HEADER;
+
+    const int top = lua_gettop(L);
+    _slwSnapshot s = { 0 };
+    s.L = L;
+    lua_createtable(L, ids > INT_MAX ? 0 : (int)ids, 0);
+    s.ids = lua_gettop(L);
+    _slwSnapshot_builtins(L, true);
+    s.builtins = lua_gettop(L);
+
+    // Nothing it makes is garbage, collecting while it runs would only traverse it over and over
+#if defined(LUA_GCISRUNNING)
+    const bool collecting = lua_gc(L, LUA_GCISRUNNING, 0) != 0;
+#else
+    const bool collecting = true;
+#endif
+    lua_gc(L, LUA_GCSTOP, 0);
+    const bool ok = _slwSnapshot_decode(&s, &p, end, 0) && _slwSnapshot_decode(&s, &p, end, 0) && p == end;
+    if (collecting)
+        lua_gc(L, LUA_GCRESTART, 0);
+
+    if (!ok)
+        lua_pushstring(L, s.error ? s.error : "malformed snapshot");
+    lua_replace(L, top + 1);
+    lua_settop(L, top + !ok);
+
+    _slwMapping_close(&m);
+    return ok;
+}
+
+SLW_API void
+slwState_close(slwState* slw)
+{
+    SLW_CHECKSTATE(slw);
+    slwProfiler_stop(slw);
+    lua_close(slw->LState);
+    slw->LState = NULL;
+}
+
+// Opens `name` now, or leaves it in the table at `lazy` for `_slwLazy_install` if that isn't 0
+SLW_INTERNAL void
+_slwState_openlib(slwState* slw, int lazy, const char* name, lua_CFunction func)
+{
+    if (lazy == 0)
+    {
+        slwState_openlib(slw, name, func);
+        return;
+    }
+
+    lua_pushcfunction(slw->LState, func);
+    lua_setfield(slw->LState, lazy, name);
+}
+
+SLW_API void
+slwState_openlibraries(slwState* slw, const uint32_t libs)
+{
+    SLW_CHECKSTATE(slw);
+    lua_State* L = slw->LState;
+
+    // Strings index `string` through their metatable and `jit` turns the compiler on, those are never left waiting
+    int lazy = 0;
+    if (libs & slw_lib_lazy)
+    {
+        lua_newtable(L);
+        lazy = lua_gettop(L);
+    }
+
+    luaopen_base(L);
+    if (libs & slw_lib_package)
+        slwState_openlib(slw, "package", luaopen_package);
+    if (libs & slw_lib_table)
+        _slwState_openlib(slw, lazy, "table", luaopen_table);
+    if (libs & slw_lib_string)
+        slwState_openlib(slw, "string", luaopen_string);
+    if (libs & slw_lib_math)
+        _slwState_openlib(slw, lazy, "math", luaopen_math);
+    if (libs & slw_lib_debug)
+        _slwState_openlib(slw, lazy, "debug", luaopen_debug);
+    if (libs & slw_lib_io)
+        _slwState_openlib(slw, lazy, "io", luaopen_io);
+#if CLW_USING_LUAJIT == 0
+    if (libs & slw_lib_coroutine)
+        _slwState_openlib(slw, lazy, "coroutine", luaopen_coroutine);
+#endif
+    if (libs & slw_lib_os)
+        _slwState_openlib(slw, lazy, "os", luaopen_os);
+#if CLW_USING_LUAJIT == 0
+    if (libs & slw_lib_utf8)
+        _slwState_openlib(slw, lazy, "utf8", luaopen_utf8);
+#else
+    if (libs & slw_lib_jit)
+        slwState_openlib(slw, "jit", luaopen_jit);
+    if (libs & slw_lib_ffi)
+        _slwState_openlib(slw, lazy, "ffi", luaopen_ffi);
+#endif
+#if __cslw_bit32_manual
+    if (libs && slw_lib_bit32)
+        _slwState_openlib(slw, lazy, "bit32", luaopen_bit32);
+#endif
+    if (libs & slw_lib_msgpack)
+        _slwState_openlib(slw, lazy, "msgpack", slwMsgpack_openlib);
+    if (libs & slw_lib_json)
+        _slwState_openlib(slw, lazy, "json", slwJson_openlib);
+    if (libs & slw_lib_cslw)
+        _slwState_openlib(slw, lazy, "cslw", slwTablelib_openlib);
+
+    if (lazy != 0)
+        _slwLazy_install(L, lazy);
+}
+
+SLW_API void
+slwState_openlib(slwState* slw, const char* name, lua_CFunction func)
+{
+    SLW_CHECKSTATE(slw);
+    lua_State* L = slw->LState;
+    luaL_requiref(L, name, func, 1);
+    lua_pop(L, 1);
+}
+
+SLW_API bool
+slwState_runstring(slwState* slw, const char* str)
+{
+    SLW_CHECKSTATE(slw);
+    lua_State* L = slw->LState;
+    return (luaL_loadstring(L, str) || _slwState_pcall(slw, 0, LUA_MULTRET)) == 0;
+}
+
+SLW_API bool
+slwState_runfile(slwState* slw, const char* filename)
+{
+    SLW_CHECKSTATE(slw);
+    lua_State* L = slw->LState;
+    return (luaL_loadfile(L, filename) || _slwState_pcall(slw, 0, LUA_MULTRET)) == 0;
+}
+
+SLW_API bool
+slwState_call_fn_at(slwState* slw, const size_t idx, ...)
+{
+    SLW_CHECKSTATE(slw);
+    lua_State* L = slw->LState;
+
+    if (!lua_isfunction(L, idx))
+        return false;
+
+    int nargs = 0;
+    
+    va_list args;
+    va_start(args, idx);
+
+    slwTableValue* arg = NULL;
+    while ((arg = va_arg(args, slwTableValue*)) != NULL)
+    {
+        _slwTable_push_value(slw, *arg);
+        ++nargs;
+    }
+    va_end(args);
+
+    if (_slwState_pcall(slw, nargs, LUA_MULTRET) != 0)
+        return false;
+
+    return true;
+}
+
+SLW_API bool
+slwState_call_fn(slwState* slw, const char* name, ...)
+{
+    SLW_CHECKSTATE(slw);
+
+    lua_getglobal(slw->LState, name);
+
+    va_list args;
+    va_start(args, name);
+
+    bool result = slwState_call_fn_at(slw, -1, args);
+
+    va_end(args);
+
+    return result;
+}
+
+SLW_API void
+slwState_setbudget(slwState* slw, const uint64_t maxInstructions, const uint64_t timeoutUs)
+{
+    SLW_CHECKSTATE(slw);
+    slw->budget.maxInstructions = maxInstructions;
+    slw->budget.timeoutUs = timeoutUs;
+    slw->budget.exceeded = false;
+}
+
+SLW_API void
+slwState_clearbudget(slwState* slw)
+{
+    SLW_CHECKSTATE(slw);
+    slw->budget.maxInstructions = 0;
+    slw->budget.timeoutUs = 0;
+}
+
+SLW_API bool
+slwState_budgetexceeded(slwState* slw)
+{
+    SLW_CHECKSTATE(slw);
+    return slw->budget.exceeded;
+}
+
+// Profiler Functions
+//------------------------------------------------------------------------
+SLW_API bool
+slwProfiler_start(slwState* slw, const uint32_t hz)
+{
+    SLW_CHECKSTATE(slw);
+    SLW_ASSERT(hz > 0);
+
+    if (!slw->profiler)
+    {
+        slw->profiler = (slwProfiler*)slw_calloc(1, sizeof(slwProfiler));
+        if (!slw->profiler)
+            return false;
+    }
+
+    slwProfiler* prof = slw->profiler;
+    prof->L = slw->LState;
+    prof->periodNs = 1000000000ull / hz;
+    prof->nextSample = _slw_clock_ns() + prof->periodNs;
+
+    prof->running = NULL;
+    _slw_registry_setp(slw->LState, &_slwProfilerKey, prof);
+    _slwProfiler_swap(slw->LState, "resume", _slwProfiler_resume, true);
+    _slwProfiler_swap(slw->LState, "wrap", _slwProfiler_wrap, true);
+
+#if SLW_PROFILER_USE_SIGNAL
+    if (!_slwProfiler_attach(prof))
+    {
+        _slw_registry_setp(slw->LState, &_slwProfilerKey, NULL);
+        _slwProfiler_swap(slw->LState, "resume", _slwProfiler_resume, false);
+        _slwProfiler_swap(slw->LState, "wrap", _slwProfiler_wrap, false);
+        return false;
+    }
+#else
+    _slw_updatehook(slw->LState);
+#endif
+    return true;
+}
+
+SLW_API void
+slwProfiler_stop(slwState* slw)
+{
+    SLW_CHECKSTATE(slw);
+
+    if (!slw->profiler)
+        return;
+
+#if SLW_PROFILER_USE_SIGNAL
+    _slwProfiler_detach(slw->profiler);
+#endif
+    _slw_registry_setp(slw->LState, &_slwProfilerKey, NULL);
+    _slw_updatehook(slw->LState);
+    _slwProfiler_swap(slw->LState, "resume", _slwProfiler_resume, false);
+    _slwProfiler_swap(slw->LState, "wrap", _slwProfiler_wrap, false);
+}
+
+SLW_API void
+slwProfiler_reset(slwState* slw)
+{
+    SLW_ASSERT(slw != NULL);
+
+    slwProfiler* prof = slw->profiler;
+    if (!prof)
+        return;
+
+    for (size_t i = 0; i < prof->capacity; i++)
+        slw_free(prof->entries[i].stack);
+
+    slw_free(prof->entries);
+    prof->entries = NULL;
+    prof->capacity = 0;
+    prof->size = 0;
+    prof->samples = 0;
+}
+
+SLW_API uint64_t
+slwProfiler_samples(slwState* slw)
+{
+    SLW_CHECKSTATE(slw);
+    return slw->profiler ? slw->profiler->samples : 0;
+}
+
+SLW_API bool
+slwProfiler_dump(slwState* slw, FILE* file)
+{
+    SLW_ASSERT(slw != NULL);
+    SLW_ASSERT(file != NULL);
+
+    slwProfiler* prof = slw->profiler;
+    if (!prof)
+        return false;
+
+    for (size_t i = 0; i < prof->capacity; i++)
+    {
+        struct slwProfilerEntry* el = &prof->entries[i];
+        if (el->stack)
+            fprintf(file, "%s %llu\n", el->stack, (unsigned long long)el->count);
+    }
+
+    return !ferror(file);
+}
+
+// C Function Statistics
+//------------------------------------------------------------------------
+SLW_API void
+slwCStats_enable(slwState* slw, const bool enable)
+{
+    SLW_CHECKSTATE(slw);
+    slw->cstatsEnabled = SLW_ENABLE_CSTATS && enable;
+}
+
+SLW_API slwCStats*
+slwCStats_list(slwState* slw)
+{
+    SLW_CHECKSTATE(slw);
+    return slw->cstats;
+}
+
+SLW_API void
+slwCStats_reset(slwState* slw)
+{
+    SLW_CHECKSTATE(slw);
+    for (slwCStats* stats = slw->cstats; stats; stats = stats->next)
+    {
+        stats->calls = 0;
+        stats->totalNs = 0;
+        stats->maxNs = 0;
+        memset(stats->histogram, 0, sizeof(stats->histogram));
+    }
+}
+
+SLW_API uint64_t
+slwCStats_percentile(const slwCStats* stats, const double p)
+{
+    SLW_ASSERT(stats != NULL);
+#if SLW_ENABLE_CSTATS
+    if (stats->calls == 0)
+        return 0;
+
+    const uint64_t target = (uint64_t)(p / 100.0 * (double)stats->calls + 0.5);
+    uint64_t seen = 0;
+    for (int i = 0; i < SLW_CSTATS_BUCKETS; i++)
+    {
+        seen += stats->histogram[i];
+        if (seen >= target && seen > 0)
+            return _slwCStats_bucket_value(i);
+    }
+
+    return stats->maxNs;
+#else
+    (void)p;
+    return 0;
+#endif
+}
+
+SLW_API bool
+slwCStats_dump(slwState* slw, FILE* file)
+{
+    SLW_CHECKSTATE(slw);
+    SLW_ASSERT(file != NULL);
+#if SLW_ENABLE_CSTATS
+    fprintf(file, "%-32s %12s %14s %10s %10s %10s %10s %10s\n", "function", "calls", "total_ns", "mean_ns", "p50_ns", "p90_ns", "p99_ns", "max_ns");
+    for (slwCStats* stats = slw->cstats; stats; stats = stats->next)
+    {
+        fprintf(file, "%-32s %12llu %14llu %10llu %10llu %10llu %10llu %10llu\n",
+            stats->name,
+            (unsigned long long)stats->calls,
+            (unsigned long long)stats->totalNs,
+            (unsigned long long)(stats->calls ? stats->totalNs / stats->calls : 0),
+            (unsigned long long)slwCStats_percentile(stats, 50.0),
+            (unsigned long long)slwCStats_percentile(stats, 90.0),
+            (unsigned long long)slwCStats_percentile(stats, 99.0),
+            (unsigned long long)stats->maxNs);
+    }
+
+    return !ferror(file);
+#else
+    return false;
+#endif
+}
+
+// Class Functions
+//------------------------------------------------------------------------
+SLW_API bool
+slwClass_register(slwState* slw, const slwClass* cls)
+{
+    SLW_CHECKSTATE(slw);
+    SLW_ASSERT(cls != NULL && cls->name != NULL);
+    lua_State* L = slw->LState;
+
+    _slwClass_pushmetatable(L, cls);
+    const bool registered = !lua_isnil(L, -1);
+    lua_pop(L, 1);
+    if (registered)
+        return false;
+
+    lua_newtable(L);
+    const int mt = lua_gettop(L);
+
+    lua_pushstring(L, cls->name);
+    lua_setfield(L, mt, "__name");
+    lua_pushstring(L, cls->name);
+    lua_setfield(L, mt, "__metatable");
+
+    // Methods and properties share one table so `__index` is a single lookup
+    lua_newtable(L);
+    const int members = lua_gettop(L);
+    for (const slwClassMethod* method = cls->methods; method && method->name; method++)
+    {
+        lua_pushvalue(L, mt);
+        _slw_pushcclosure(slw, method->name, method->fn, 1);
+        lua_setfield(L, members, method->name);
+    }
+
+    for (const slwClassField* field = cls->fields; field && field->name; field++)
+    {
+        SLW_ASSERT(field->type != slw_field_string     || field->size == sizeof(const char*));
+        SLW_ASSERT(field->type != slw_field_number     || field->size == sizeof(double));
+        SLW_ASSERT(field->type != slw_field_float      || field->size == sizeof(float));
+        SLW_ASSERT(field->type != slw_field_int        || field->size == sizeof(int32_t));
+        SLW_ASSERT(field->type != slw_field_int64      || field->size == sizeof(int64_t));
+        SLW_ASSERT(field->type != slw_field_bool       || field->size == sizeof(bool));
+        SLW_ASSERT(field->type != slw_field_lightudata || field->size == sizeof(void*));
+    }
+
+    for (const slwClassProperty* prop = cls->properties; prop && prop->name; prop++)
+    {
+        lua_pushlightuserdata(L, (void*)prop);
+        lua_setfield(L, members, prop->name);
+    }
+
+    if (cls->properties || cls->fields)
+    {
+        if (cls->fields)
+        {
+            _slwFieldHash_push(L, cls);
+        } else
+        {
+            lua_pushnil(L);
+            lua_pushnil(L);
+        }
+        const int hash = lua_gettop(L) - 1;
+
+        lua_pushvalue(L, mt);
+        lua_pushvalue(L, members);
+        lua_pushvalue(L, hash);
+        lua_pushvalue(L, hash + 1);
+        lua_pushcclosure(L, _slwClass_index, 4);
+        lua_setfield(L, mt, "__index");
+
+        lua_pushvalue(L, mt);
+        lua_pushvalue(L, members);
+        lua_pushvalue(L, hash);
+        lua_pushlightuserdata(L, (void*)cls);
+        lua_pushcclosure(L, _slwClass_newindex, 4);
+        lua_setfield(L, mt, "__newindex");
+        lua_pop(L, 2);
+    } else
+    {
+        // Only methods, the members table can be `__index` itself
+        lua_pushvalue(L, members);
+        lua_setfield(L, mt, "__index");
+    }
+    lua_pop(L, 1);
+
+    if (cls->gc)
+    {
+        lua_pushvalue(L, mt);
+        lua_pushlightuserdata(L, (void*)cls);
+        lua_pushcclosure(L, _slwClass_gc, 2);
+        lua_setfield(L, mt, "__gc");
+    }
+
+    if (cls->close)
+    {
+        lua_pushvalue(L, mt);
+        lua_pushlightuserdata(L, (void*)cls);
+        lua_pushcclosure(L, _slwClass_close, 2);
+        lua_setfield(L, mt, "__close");
+    }
+
+    lua_pushlightuserdata(L, (void*)cls);
+    lua_insert(L, -2);
+    lua_rawset(L, LUA_REGISTRYINDEX);
+    return true;
+}
+
+SLW_API void*
+slwClass_new(slwState* slw, const slwClass* cls)
+{
+    SLW_CHECKSTATE(slw);
+    SLW_ASSERT(cls != NULL);
+    lua_State* L = slw->LState;
+
+    void* self = lua_newuserdata(L, cls->size + sizeof(bool));
+    _slwClass_pushmetatable(L, cls);
+    if (lua_isnil(L, -1))
+    {
+        lua_pop(L, 2);
+        return NULL;
+    }
+
+    memset(self, 0, cls->size + sizeof(bool));
+    lua_setmetatable(L, -2);
+    return self;
+}
+
+SLW_API void*
+slwClass_check(slwState* slw, const int idx)
+{
+    SLW_CHECKSTATE(slw);
+    lua_State* L = slw->LState;
+
+    void* self = lua_touserdata(L, idx);
+    if (self && lua_getmetatable(L, idx))
+    {
+        const bool same = lua_rawequal(L, -1, lua_upvalueindex(1));
+        lua_pop(L, 1);
+        if (same)
+            return self;
+    }
+
+    lua_getfield(L, lua_upvalueindex(1), "__name");
+    const char* msg = lua_pushfstring(L, "%s expected, got %s", lua_tostring(L, -1), luaL_typename(L, idx));
+    luaL_argerror(L, idx, msg);
+    return NULL;
+}
+
+SLW_API void*
+slwClass_test(slwState* slw, const int idx, const slwClass* cls)
+{
+    SLW_CHECKSTATE(slw);
+    SLW_ASSERT(cls != NULL);
+    lua_State* L = slw->LState;
+
+    void* self = lua_touserdata(L, idx);
+    if (!self || !lua_getmetatable(L, idx))
+        return NULL;
+
+    _slwClass_pushmetatable(L, cls);
+    const bool same = lua_rawequal(L, -1, -2);
+    lua_pop(L, 2);
+    return same ? self : NULL;
+}
+
+// Store Functions
+//------------------------------------------------------------------------
+SLW_API slwStore*
+slwStore_create(const slwTable* slt)
+{
+    SLW_ASSERT(slt != NULL);
+
+    const size_t header = _SLW_STORE_ALIGN(sizeof(slwStore));
+    const size_t bytes = header + _slwStore_measure(slt, 0);
+    slwStore* store = (slwStore*)slw_malloc(bytes);
+    if (!store)
+        return NULL;
+
+    char* cursor = (char*)store + header;
+    store->refs = 1;
+    store->bytes = bytes;
+    store->root = _slwStore_build(&cursor, slt);
+    SLW_ASSERT(cursor == (char*)store + bytes);
+
+    return store;
+}
+
+SLW_API slwStore*
+slwStore_retain(slwStore* store)
+{
+    SLW_ASSERT(store != NULL);
+    _slw_atomic_add(&store->refs, 1);
+    return store;
+}
+
+SLW_API void
+slwStore_release(slwStore* store)
+{
+    SLW_ASSERT(store != NULL);
+    if (_slw_atomic_add(&store->refs, -1) == 0)
+        slw_free(store);
+}
+
+SLW_API void
+slwStore_push(slwState* slw, slwStore* store)
+{
+    SLW_CHECKSTATE(slw);
+    SLW_ASSERT(store != NULL);
+    lua_State* L = slw->LState;
+
+    _slwStoreView_pushmeta(L);
+    const int top = lua_gettop(L);
+    _slwStoreView_push(L, store, store->root, top - 1, top);
+    lua_replace(L, top - 1);
+    lua_settop(L, top - 1);
+}
+
+SLW_API void
+slwState_setstore(slwState* slw, const char* name, slwStore* store)
+{
+    SLW_CHECKSTATE(slw);
+
+    slwStore_push(slw, store);
+    lua_setglobal(slw->LState, name);
+    _slwPath_bump(slw->LState);
+}
+
+// Serialization Functions
+SLW_API void*
+slwTable_serialize(const slwTable* slt, size_t* size)
+{
+    SLW_ASSERT(slt != NULL);
+    SLW_ASSERT(size != NULL);
+
+    const size_t tables = _slwSerial_measure(slt, 0);
+    const size_t bytes = _SLW_STORE_ALIGN(sizeof(_slwSerialHeader)) + tables;
+    if (!tables || bytes > UINT32_MAX)
+        return NULL;
+
+    // Zeroed, so the padding is the same in every blob
+    uint8_t* base = (uint8_t*)slw_calloc(1, bytes);
+    if (!base)
+        return NULL;
+
+    char* cursor = (char*)base;
+    _slwSerialHeader* header = (_slwSerialHeader*)_slwStore_take(&cursor, sizeof(_slwSerialHeader));
+    memcpy(header->magic, _SLW_SERIAL_MAGIC, sizeof(header->magic));
+    header->version = _SLW_SERIAL_VERSION;
+    header->order = _SLW_SERIAL_ORDER;
+    header->size = (uint32_t)bytes;
+    header->root = _slwSerial_build(base, bytes, &cursor, slt);
+
+    SLW_ASSERT((size_t)((uint8_t*)cursor - base) == bytes);
+    *size = bytes;
+    return base;
+}
+
+SLW_API slwTable*
+slwTable_deserialize(const void* data, size_t size)
+{
+    slwTableView view;
+    if (!slwTableView_init(&view, data, size))
+        return NULL;
+
+    const _slwSerialTable* root = (const _slwSerialTable*)(view.data + view.table);
+    size_t tables = 0, entries = 0;
+    if (!_slwSerial_count(view.data, view.size, root, &tables, &entries, 0))
+        return NULL;
+
+    // The root's elements come first so `slwTable_free` frees the block with them,
+    // each nested table's elements are aligned (up to 7 bytes more)
+    const size_t bytes = _SLW_STORE_ALIGN(root->size * sizeof(slwTableValue)) +
+                         tables * (_SLW_STORE_ALIGN(sizeof(slwTable)) + 7) + (entries - root->size) * sizeof(slwTableValue);
+    slwTable* slt = (slwTable*)slw_calloc(1, sizeof(slwTable));
+    char* block = bytes ? (char*)slw_malloc(bytes) : NULL;
+    if (!slt || (bytes && !block))
+    {
+        slw_free(slt);
+        slw_free(block);
+        return NULL;
+    }
+
+    char* cursor = block;
+    slt->elements = (slwTableValue*)_slwStore_take(&cursor, root->size * sizeof(slwTableValue));
+    _slwSerial_unpack(view.data, view.size, root, slt, &cursor);
+    SLW_ASSERT((size_t)(cursor - block) <= bytes);
+    return slt;
+}
+
+SLW_API bool
+slwTableView_init(slwTableView* view, const void* data, size_t size)
+{
+    SLW_ASSERT(view != NULL);
+
+    memset(view, 0, sizeof(*view));
+    const _slwSerialHeader* header = (const _slwSerialHeader*)data;
+    if (!data || ((uintptr_t)data & 7) || size < sizeof(_slwSerialHeader) || memcmp(header->magic, _SLW_SERIAL_MAGIC, 4) != 0 ||
+        header->version != _SLW_SERIAL_VERSION || header->order != _SLW_SERIAL_ORDER || header->size != size ||
+        !_slwSerial_table((const uint8_t*)data, size, header->root))
+        return false;
+
+    view->data = (const uint8_t*)data;
+    view->size = size;
+    view->table = header->root;
+    return true;
+}
+
+SLW_API bool
+slwTableView_open(slwTableView* view, const char* path)
+{
+    SLW_ASSERT(view != NULL);
+
+    _slwMapping m;
+    if (!_slwMapping_open(&m, path, false))
+        return false;
+
+    if (!slwTableView_init(view, m.data, m.size))
+    {
+        _slwMapping_close(&m);
+        return false;
+    }
+
+    view->mapped = true;
+    return true;
+}
+
+SLW_API void
+slwTableView_close(slwTableView* view)
+{
+    SLW_ASSERT(view != NULL);
+
+    if (view->mapped)
+    {
+        _slwMapping m = { view->data, view->size };
+        _slwMapping_close(&m);
+    }
+    memset(view, 0, sizeof(*view));
+}
+
+SLW_API size_t
+slwTableView_size(const slwTableView* view)
+{
+    SLW_ASSERT(view != NULL);
+    return view->data ? ((const _slwSerialTable*)(view->data + view->table))->size : 0;
+}
+
+SLW_API bool
+slwTableView_at(const slwTableView* view, const size_t i, slwTableValue* out)
+{
+    SLW_ASSERT(view != NULL);
+    SLW_ASSERT(out != NULL);
+
+    if (i >= slwTableView_size(view))
+        return false;
+
+    const _slwSerialTable* tbl = (const _slwSerialTable*)(view->data + view->table);
+    return _slwSerial_read(view->data, view->size, &_slwSerial_entries(tbl)[i], out);
+}
+
+SLW_API bool
+slwTableView_get(const slwTableView* view, const char* key, slwTableValue* out)
+{
+    SLW_ASSERT(view != NULL);
+    SLW_ASSERT(key != NULL);
+    SLW_ASSERT(out != NULL);
+
+    if (!view->data)
+        return false;
+
+    const _slwSerialTable* tbl = (const _slwSerialTable*)(view->data + view->table);
+    const size_t len = strlen(key);
+    const _slwSerialEntry* entry = _slwSerial_find(view->data, view->size, tbl, key, len);
+    if (entry)
+        return _slwSerial_read(view->data, view->size, entry, out);
+
+    // Small tables have no index
+    if (tbl->mask)
+        return false;
+
+    for (uint32_t i = 0; i < tbl->size; i++)
+    {
+        entry = &_slwSerial_entries(tbl)[i];
+        const char* name = entry->key && entry->keyLen == len ? _slwSerial_string(view->data, view->size, entry->key, entry->keyLen) : NULL;
+        if (name && memcmp(name, key, len) == 0)
+            return _slwSerial_read(view->data, view->size, entry, out);
+    }
+    return false;
+}
+
+SLW_API bool
+slwTableView_table(const slwTableView* view, const slwTableValue* val, slwTableView* out)
+{
+    SLW_ASSERT(view != NULL);
+    SLW_ASSERT(val != NULL);
+    SLW_ASSERT(out != NULL);
+
+    const uint8_t* p = (const uint8_t*)val->value.u;
+    if (val->ltype != LUA_TTABLE || !view->data || p < view->data || p >= view->data + view->size ||
+        !_slwSerial_table(view->data, view->size, (uint64_t)(p - view->data)))
+        return false;
+
+    out->data = view->data;
+    out->size = view->size;
+    out->table = (size_t)(p - view->data);
+    out->mapped = false;
+    return true;
+}
+
+// MessagePack Functions
+SLW_API bool
+slwMsgpack_encode(slwState* slw, const int idx, slwBuffer* out)
+{
+    SLW_CHECKSTATE(slw);
+    SLW_ASSERT(out != NULL);
+
+    lua_State* L = slw->LState;
+    const int top = lua_gettop(L);
+    const size_t size = out->size;
+    if (_slwMsgpack_encode(L, idx, out, 0) == _SLW_VALUE_OK)
+        return true;
+
+    lua_settop(L, top);
+    out->size = size;
+    return false;
+}
+
+SLW_API size_t
+slwMsgpack_decode(slwState* slw, const void* data, const size_t size)
+{
+    SLW_CHECKSTATE(slw);
+
+    const uint8_t* p = (const uint8_t*)data;
+    if (!data || !_slwMsgpack_decode(slw->LState, &p, p + size, 0))
+        return 0;
+    return (size_t)(p - (const uint8_t*)data);
+}
+
+SLW_API int
+slwMsgpack_openlib(lua_State* L)
+{
+    lua_createtable(L, 0, 2);
+
+    // One encode buffer for the library, freed with it
+    _slwBuffer* buf = (_slwBuffer*)lua_newuserdata(L, sizeof(_slwBuffer));
+    memset(buf, 0, sizeof(*buf));
+    lua_createtable(L, 0, 1);
+    lua_pushcfunction(L, _slwMsgpack_buffergc);
+    lua_setfield(L, -2, "__gc");
+    lua_setmetatable(L, -2);
+
+    lua_pushvalue(L, -1);
+    lua_pushcclosure(L, _slwMsgpack_lencode, 1);
+    lua_setfield(L, -3, "encode");
+    lua_pop(L, 1);
+
+    lua_pushcfunction(L, _slwMsgpack_ldecode);
+    lua_setfield(L, -2, "decode");
+    return 1;
+}
+
+// JSON Functions
+//------------------------------------------------------------------------
+SLW_API bool
+slwJson_encode(slwState* slw, const int idx, slwBuffer* out)
+{
+    SLW_CHECKSTATE(slw);
+    SLW_ASSERT(out != NULL);
+
+    lua_State* L = slw->LState;
+    const int top = lua_gettop(L);
+    const size_t size = out->size;
+    if (_slwJson_encode(L, idx, out, 0) == _SLW_VALUE_OK)
+        return true;
+
+    lua_settop(L, top);
+    out->size = size;
+    return false;
+}
+
+SLW_API bool
+slwJson_decode(slwState* slw, const void* data, const size_t size)
+{
+    SLW_CHECKSTATE(slw);
+
+    lua_State* L = slw->LState;
+    slwJsonDecoder* dec = _slwJsonDecoder_create(L);
+    if (!dec)
+    {
+        lua_pushliteral(L, "not enough memory");
+        return false;
+    }
+
+    const uint8_t* p = (const uint8_t*)(data ? data : "");
+    (void)_slwJsonDecoder_feed(dec, p, p + size);
+    const bool ok = _slwJsonDecoder_finish(dec, L);
+    slwJsonDecoder_destroy(dec);
+    return ok;
+}
+
+SLW_API slwJsonDecoder*
+slwJsonDecoder_create(slwState* slw)
+{
+    SLW_CHECKSTATE(slw);
+    return _slwJsonDecoder_create(slw->LState);
+}
+
+SLW_API bool
+slwJsonDecoder_feed(slwJsonDecoder* dec, const void* data, const size_t size)
+{
+    SLW_ASSERT(dec != NULL);
+
+    const uint8_t* p = (const uint8_t*)(data ? data : "");
+    return _slwJsonDecoder_feed(dec, p, p + size);
+}
+
+SLW_API bool
+slwJsonDecoder_finish(slwJsonDecoder* dec)
+{
+    SLW_ASSERT(dec != NULL);
+    return _slwJsonDecoder_finish(dec, dec->L);
+}
+
+SLW_API const char*
+slwJsonDecoder_error(const slwJsonDecoder* dec)
+{
+    SLW_ASSERT(dec != NULL);
+    return dec->state == _SLW_JSON_ERROR ? dec->error : NULL;
+}
+
+SLW_API void
+slwJsonDecoder_destroy(slwJsonDecoder* dec)
+{
+    if (!dec)
+        return;
+
+    luaL_unref(dec->L, LUA_REGISTRYINDEX, dec->ref);
+    slw_free(dec->text.data);
+    slw_free(dec);
+}
+
+SLW_API int
+slwJson_openlib(lua_State* L)
+{
+    lua_createtable(L, 0, 4);
+
+    // One encode buffer for the library, freed with it
+    _slwBuffer* buf = (_slwBuffer*)lua_newuserdata(L, sizeof(_slwBuffer));
+    memset(buf, 0, sizeof(*buf));
+    lua_createtable(L, 0, 1);
+    lua_pushcfunction(L, _slwMsgpack_buffergc);
+    lua_setfield(L, -2, "__gc");
+    lua_setmetatable(L, -2);
+
+    lua_pushcclosure(L, _slwJson_lencode, 1);
+    lua_setfield(L, -2, "encode");
+
+    lua_pushcfunction(L, _slwJson_ldecode);
+    lua_setfield(L, -2, "decode");
+
+    lua_pushcfunction(L, _slwJson_ldecoder);
+    lua_setfield(L, -2, "decoder");
+
+    lua_pushlightuserdata(L, NULL);
+    lua_setfield(L, -2, "null");
+    return 1;
+}
+
+// Table Library Functions
+//------------------------------------------------------------------------
+SLW_API int
+slwTablelib_openlib(lua_State* L)
+{
+    lua_createtable(L, 0, 4);
+    for (const luaL_Reg* reg = _slwTablelib; reg->name; reg++)
+    {
+        lua_pushcfunction(L, reg->func);
+        lua_setfield(L, -2, reg->name);
+    }
+
+    // `table.new` and `table.clear` like LuaJIT's, without replacing LuaJIT's own
+    lua_getglobal(L, "table");
+    if (lua_istable(L, -1))
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            lua_getfield(L, -1, _slwTablelib[i].name);
+            if (lua_isnil(L, -1))
+            {
+                lua_pushcfunction(L, _slwTablelib[i].func);
+                lua_setfield(L, -3, _slwTablelib[i].name);
+            }
+            lua_pop(L, 1);
+        }
+    }
+    lua_pop(L, 1);
+    return 1;
+}
+
+// Event Functions
+//------------------------------------------------------------------------
+SLW_API slwEventHandler*
+slwEvent_bind(slwState* slw, const int idx)
+{
+    SLW_CHECKSTATE(slw);
+    lua_State* L = slw->LState;
+    if (!lua_isfunction(L, idx))
+        return NULL;
+
+    slwEventHandler* handler = (slwEventHandler*)slw_calloc(1, sizeof(slwEventHandler));
+    if (!handler)
+        return NULL;
+
+    const int fn = lua_absindex(L, idx);
+    lua_createtable(L, _SLW_EVENT_LEVELS + 1, 0);
+    lua_pushvalue(L, fn);
+    lua_rawseti(L, -2, 1);
+
+    handler->slw = slw;
+    handler->ref = luaL_ref(L, LUA_REGISTRYINDEX);
+    return handler;
+}
+
+SLW_API bool
+slwEvent_dispatch(slwEventHandler* handler, const slwTable* event)
+{
+    SLW_ASSERT(handler != NULL);
+    SLW_ASSERT(event != NULL);
+    return slwEvent_dispatchmany(handler, event, 1) == 1;
+}
+
+SLW_API size_t
+slwEvent_dispatchmany(slwEventHandler* handler, const slwTable* events, const size_t count)
+{
+    SLW_ASSERT(handler != NULL);
+    SLW_ASSERT(events != NULL || count == 0);
+
+    lua_State* L = handler->slw->LState;
+    if (!lua_checkstack(L, 6))
+    {
+        lua_pushliteral(L, "not enough stack space to dispatch an event");
+        return 0;
+    }
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, handler->ref);
+    const int pool = lua_gettop(L);
+
+    size_t delivered = 0;
+    for (; delivered < count; delivered++)
+    {
+        if (!_slwEvent_dispatch(handler, pool, &events[delivered]))
+        {
+            // The error message takes the pool's place
+            lua_remove(L, pool);
+            return delivered;
+        }
+    }
+
+    lua_pop(L, 1);
+    return delivered;
+}
+
+SLW_API void
+slwEvent_unbind(slwEventHandler* handler)
+{
+    if (!handler)
+        return;
+
+    luaL_unref(handler->slw->LState, LUA_REGISTRYINDEX, handler->ref);
+    slw_free(handler);
+}
+
+// Path Functions
+//------------------------------------------------------------------------
+SLW_API slwPath*
+slwPath_compile(slwState* slw, const char* str)
+{
+    SLW_CHECKSTATE(slw);
+    SLW_ASSERT(str != NULL);
+
+    lua_State* L = slw->LState;
+    slwPath* path = (slwPath*)slw_calloc(1, sizeof(slwPath));
+    if (!path)
+        return NULL;
+
+    // Every key is interned once here, they're only pushed from the registry afterwards
+    lua_newtable(L);
+    const char* key = str;
+    for (const char* p = str; ; p++)
+    {
+        if (*p != '.' && *p != '\0')
+            continue;
+
+        if (p == key)
+        {
+            // Empty key ("a..b", ".a" or "")
+            lua_pop(L, 1);
+            slw_free(path);
+            return NULL;
+        }
+
+        lua_pushlstring(L, key, (size_t)(p - key));
+        lua_rawseti(L, -2, ++path->count);
+        key = p + 1;
+        if (*p == '\0')
+            break;
+    }
+
+    lua_rawgeti(L, -1, path->count);
+    path->leaf = luaL_ref(L, LUA_REGISTRYINDEX);
+    if (path->count > 1)
+    {
+        lua_rawgeti(L, -1, path->count - 1);
+        path->link = luaL_ref(L, LUA_REGISTRYINDEX);
+    } else
+    {
+        path->link = LUA_NOREF;
+    }
+    path->keys = luaL_ref(L, LUA_REGISTRYINDEX);
+
+    // Slots of their own for the parent and the table holding it, refilled by `_slwPath_resolve`
+    lua_pushboolean(L, 0);
+    path->parent = luaL_ref(L, LUA_REGISTRYINDEX);
+    lua_pushboolean(L, 0);
+    path->grand = luaL_ref(L, LUA_REGISTRYINDEX);
+
+    path->L = L;
+    path->epoch = _slwPath_epoch(L);
+    return path;
+}
+
+SLW_API bool
+slwPath_push(slwPath* path)
+{
+    SLW_ASSERT(path != NULL);
+    lua_State* L = path->L;
+
+    if (!_slwPath_pushparent(path, false))
+    {
+        lua_pushnil(L);
+        return false;
+    }
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, path->leaf);
+    lua_rawget(L, -2);
+    lua_remove(L, -2);
+    return !lua_isnil(L, -1);
+}
+
+SLW_API bool
+slwPath_set(slwPath* path, slwTableValue val)
+{
+    SLW_ASSERT(path != NULL);
+    lua_State* L = path->L;
+
+    if (!_slwPath_pushparent(path, true))
+        return false;
+
+    slwState view = slwState_view(L);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, path->leaf);
+    if (val.ltype == LUA_TNIL)
+        lua_pushnil(L);
+    else
+        _slwTable_push_value(&view, val);
+    lua_rawset(L, -3);
+    lua_pop(L, 1);
+    return true;
+}
+
+SLW_API double
+slwPath_getnumber(slwPath* path, double fallback)
+{
+    SLW_ASSERT(path != NULL);
+    if (slwPath_push(path) && lua_type(path->L, -1) == LUA_TNUMBER)
+        fallback = (double)lua_tonumber(path->L, -1);
+    lua_pop(path->L, 1);
+    return fallback;
+}
+
+SLW_API bool
+slwPath_getbool(slwPath* path, bool fallback)
+{
+    SLW_ASSERT(path != NULL);
+    if (slwPath_push(path) && lua_isboolean(path->L, -1))
+        fallback = lua_toboolean(path->L, -1);
+    lua_pop(path->L, 1);
+    return fallback;
+}
+
+SLW_API const char*
+slwPath_getstring(slwPath* path)
+{
+    SLW_ASSERT(path != NULL);
+    const char* str = NULL;
+    if (slwPath_push(path) && lua_type(path->L, -1) == LUA_TSTRING)
+        str = lua_tostring(path->L, -1);
+    lua_pop(path->L, 1);
+    return str;
+}
+
+SLW_API void
+slwPath_invalidate(slwState* slw)
+{
+    SLW_CHECKSTATE(slw);
+    _slwPath_bump(slw->LState);
+}
+
+SLW_API void
+slwPath_free(slwPath* path)
+{
+    if (!path)
+        return;
+
+    luaL_unref(path->L, LUA_REGISTRYINDEX, path->keys);
+    luaL_unref(path->L, LUA_REGISTRYINDEX, path->leaf);
+    luaL_unref(path->L, LUA_REGISTRYINDEX, path->parent);
+    luaL_unref(path->L, LUA_REGISTRYINDEX, path->grand);
+    luaL_unref(path->L, LUA_REGISTRYINDEX, path->link);
+    slw_free(path);
+}
+
+// Table Binding Functions
+//------------------------------------------------------------------------
+SLW_API bool
+slwTable_bind(slwState* slw, slwTable* slt)
+{
+    SLW_CHECKSTATE(slw);
+    SLW_ASSERT(slt != NULL);
+
+    lua_State* L = slw->LState;
+    if (slt->binding && slt->binding->L != L)
+        return false;
+
+    if (slt->binding)
+        (void)slwTable_sync(slt);
+    _slwTable_pushbound(slw, slt);
+    return slt->binding != NULL;
+}
+
+SLW_API void
+slwTable_touch(slwTable* slt, const size_t index)
+{
+    SLW_ASSERT(slt != NULL);
+
+    _slwTableBinding* b = slt->binding;
+    if (!b || b->all)
+        return;
+
+    const size_t word = index / 64;
+    const uint64_t bit = 1ull << (index % 64);
+    if (word < b->words && (b->bits[word] & bit))
+        return;
+
+    if (word >= b->words)
+    {
+        const size_t words = word + 1 > b->words * 2 ? word + 1 : b->words * 2;
+        uint64_t* bits = (uint64_t*)slw_realloc(b->bits, words * sizeof(uint64_t));
+        if (!bits)
+        {
+            b->all = true;
+            return;
+        }
+        memset(bits + b->words, 0, (words - b->words) * sizeof(uint64_t));
+        b->bits = bits;
+        b->words = words;
+    }
+
+    if (b->count == b->capacity)
+    {
+        const size_t capacity = b->capacity ? b->capacity * 2 : 16;
+        size_t* dirty = (size_t*)slw_realloc(b->dirty, capacity * sizeof(size_t));
+        if (!dirty)
+        {
+            b->all = true;
+            return;
+        }
+        b->dirty = dirty;
+        b->capacity = capacity;
+    }
+
+    b->bits[word] |= bit;
+    b->dirty[b->count++] = index;
+}
+
+SLW_API bool
+slwTable_sync(slwTable* slt)
+{
+    SLW_ASSERT(slt != NULL);
+
+    _slwTableBinding* b = slt->binding;
+    if (!b)
+        return false;
+
+    lua_State* L = b->L;
+    if (!lua_checkstack(L, 4))
         return false;
 
-    int nargs = 0;
-    
-    va_list args;
-    va_start(args, idx);
+    slwState view = slwState_view(L);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, b->ref);
+
+    const size_t count = b->all ? slt->size : b->count;
+    bool tables = false;
+    for (size_t i = 0; i < count; i++)
+    {
+        const size_t index = b->all ? i : b->dirty[i];
+        if (index >= slt->size)
+            continue;
+
+        const slwTableValue* el = &slt->elements[index];
+        if (el->name)
+            lua_pushstring(L, el->name);
+        else
+            lua_pushinteger(L, (lua_Integer)(index + 1));
+        _slwTable_pushelement(&view, el);
+        lua_rawset(L, -3);
+        tables |= el->ltype == LUA_TTABLE;
+    }
+
+    if (b->all)
+        memset(b->bits, 0, b->words * sizeof(uint64_t));
+    else
+        for (size_t i = 0; i < b->count; i++)
+            b->bits[b->dirty[i] / 64] &= ~(1ull << (b->dirty[i] % 64));
+    b->count = 0;
+    b->all = false;
+
+    // A new table element, the list may also still have ones that aren't tables anymore
+    if (tables)
+        _slwTable_findnested(slt);
+
+    for (size_t i = 0; i < b->nestedCount; i++)
+    {
+        const size_t index = b->nested[i];
+        if (index < slt->size && slt->elements[index].ltype == LUA_TTABLE && slt->elements[index].value.t)
+            (void)slwTable_sync(slt->elements[index].value.t);
+    }
+
+    lua_pop(L, 1);
+    return true;
+}
+
+SLW_API void
+slwTable_unbind(slwTable* slt)
+{
+    SLW_ASSERT(slt != NULL);
+
+    _slwTableBinding* b = slt->binding;
+    if (!b)
+        return;
+
+    for (size_t i = 0; i < b->nestedCount; i++)
+    {
+        const size_t index = b->nested[i];
+        if (index < slt->size && slt->elements[index].ltype == LUA_TTABLE && slt->elements[index].value.t)
+            slwTable_unbind(slt->elements[index].value.t);
+    }
+    _slwTable_unbind(slt);
+}
+
+// Compact Table Functions
+//------------------------------------------------------------------------
+SLW_API void
+slwCompactTable_free(slwCompactTable* sct)
+{
+    SLW_ASSERT(sct != NULL);
+    slw_free(sct->block);
+    slwCompactTable_init(sct);
+}
+
+SLW_API size_t
+slwCompactTable_find(const slwCompactTable* sct, const char* name)
+{
+    SLW_ASSERT(sct != NULL);
+    SLW_ASSERT(name != NULL);
+
+    // Only the hashes are read until one matches, names are compared after that
+    const uint32_t hash = _slwCompact_hash(name);
+    const uint32_t* hashes = slwCompactTable_hashes(sct);
+    const char** names = slwCompactTable_names(sct);
+    for (size_t i = 0; i < sct->size; i++)
+    {
+        if (hashes[i] == hash && strcmp(names[i], name) == 0)
+            return i;
+    }
+
+    return SIZE_MAX;
+}
+
+SLW_API bool
+slwCompactTable_set(slwCompactTable* sct, const char* name, slwTableValue val)
+{
+    SLW_ASSERT(sct != NULL);
 
-    slwTableValue* arg = NULL;
-    while ((arg = va_arg(args, slwTableValue*)) != NULL)
+    if (name)
     {
-        _slwTable_push_value(slw, *arg);
-        ++nargs;
+        const size_t i = slwCompactTable_find(sct, name);
+        if (i != SIZE_MAX)
+        {
+            slwCompactTable_values(sct)[i] = val.value;
+            slwCompactTable_types(sct)[i] = val.ltype;
+            return true;
+        }
     }
-    va_end(args);
 
-    if (lua_pcall(L, nargs, LUA_MULTRET, 0) != 0)
+    if (!_slwCompact_reserve(sct, 1))
         return false;
 
+    _slwCompact_append(sct, name, name ? _slwCompact_hash(name) : 0, val);
     return true;
 }
 
 SLW_API bool
-slwState_call_fn(slwState* slw, const char* name, ...)
+slwCompactTable_get(const slwCompactTable* sct, const char* name, slwTableValue* out)
 {
-    SLW_CHECKSTATE(slw);
+    SLW_ASSERT(out != NULL);
 
-    lua_getglobal(slw->LState, name);
+    const size_t i = slwCompactTable_find(sct, name);
+    if (i == SIZE_MAX)
+        return false;
 
-    va_list args;
-    va_start(args, name);
+    out->name = slwCompactTable_names(sct)[i];
+    out->ltype = slwCompactTable_types(sct)[i];
+    out->value = slwCompactTable_values(sct)[i];
+    return true;
+}
 
-    bool result = slwState_call_fn_at(slw, -1, args);
+SLW_API bool
+slwCompactTable_append(slwCompactTable* sct, const slwTable* slt)
+{
+    SLW_ASSERT(sct != NULL);
+    SLW_ASSERT(slt != NULL);
 
-    va_end(args);
+    if (!_slwCompact_reserve(sct, slt->size))
+        return false;
 
-    return result;
+    for (size_t i = 0; i < slt->size; i++)
+    {
+        const slwTableValue* el = &slt->elements[i];
+        _slwCompact_append(sct, el->name, el->name ? _slwCompact_hash(el->name) : 0, *el);
+    }
+    return true;
 }
 
-// Stack Functions
-//------------------------------------------------------------------------
-SLW_API SLW_INLINE void
-slwStack_pop(slwState* slw, const int32_t n)
+SLW_API void
+slwCompactTable_push(slwState* slw, const slwCompactTable* sct)
 {
     SLW_CHECKSTATE(slw);
-    lua_pop(slw->LState, n);
-}
+    SLW_ASSERT(sct != NULL);
 
-SLW_NODISCARD SLW_API SLW_INLINE bool
-slwStack_isboolean(slwState* slw, const int32_t idx)
-{
-    SLW_CHECKSTATE(slw);
-    return lua_isboolean(slw->LState, idx);
-}
+    lua_State* L = slw->LState;
+    const char** names = slwCompactTable_names(sct);
+    const uint8_t* types = slwCompactTable_types(sct);
+    const slwValue* values = slwCompactTable_values(sct);
 
-SLW_NODISCARD SLW_API SLW_INLINE bool
-slwStack_iscfunction(slwState* slw, const int32_t idx)
-{
-    SLW_CHECKSTATE(slw);
-    return lua_iscfunction(slw->LState, idx);
+    const bool keyed = sct->size && names[0];
+    lua_createtable(L, keyed ? 0 : (int)sct->size, keyed ? (int)sct->size : 0);
+    for (size_t i = 0; i < sct->size; i++)
+    {
+        const slwTableValue el = { names[i], types[i], values[i] };
+        if (keyed)
+        {
+            lua_pushstring(L, el.name);
+            _slwTable_push_value(slw, el);
+            lua_settable(L, -3);
+        } else
+        {
+            _slwTable_push_value(slw, el);
+            lua_rawseti(L, -2, (lua_Integer)(i + 1));
+        }
+    }
 }
 
-SLW_NODISCARD SLW_API SLW_INLINE bool
-slwStack_isfunction(slwState* slw, const int32_t idx)
+// Channel Functions
+//------------------------------------------------------------------------
+SLW_API slwChannel*
+slwChannel_create(const size_t capacity, const uint32_t mode)
 {
-    SLW_CHECKSTATE(slw);
-    return lua_isfunction(slw->LState, idx);
-}
+    SLW_ASSERT(capacity > 0);
+    SLW_ASSERT(mode == slw_channel_spsc || mode == slw_channel_mpmc);
 
-SLW_NODISCARD SLW_API SLW_INLINE bool
-slwStack_islightuserdata(slwState* slw, const int32_t idx)
-{
-    SLW_CHECKSTATE(slw);
-    return lua_islightuserdata(slw->LState, idx);
-}
+    size_t size = 1;
+    while (size < capacity)
+        size <<= 1;
 
-SLW_NODISCARD SLW_API SLW_INLINE bool
-slwStack_isnil(slwState* slw, const int32_t idx)
-{
-    SLW_CHECKSTATE(slw);
-    return lua_isnil(slw->LState, idx);
-}
+    slwChannel* ch = (slwChannel*)slw_calloc(1, sizeof(slwChannel) + size * sizeof(_slwChannelCell));
+    if (!ch)
+        return NULL;
 
-SLW_NODISCARD SLW_API SLW_INLINE bool
-slwStack_isnone(slwState* slw, const int32_t idx)
-{
-    SLW_CHECKSTATE(slw);
-    return lua_isnone(slw->LState, idx);
-}
+    ch->refs = 1;
+    ch->mode = mode;
+    ch->mask = size - 1;
+    for (size_t i = 0; i < size; i++)
+        ch->cells[i].seq = i;
 
-SLW_NODISCARD SLW_API SLW_INLINE bool
-slwStack_isnoneornil(slwState* slw, const int32_t idx)
-{
-    SLW_CHECKSTATE(slw);
-    return lua_isnoneornil(slw->LState, idx);
+    return ch;
 }
 
-SLW_NODISCARD SLW_API SLW_INLINE bool
-slwStack_isnumber(slwState* slw, const int32_t idx)
+SLW_API slwChannel*
+slwChannel_retain(slwChannel* ch)
 {
-    SLW_CHECKSTATE(slw);
-    return lua_isnumber(slw->LState, idx);
+    SLW_ASSERT(ch != NULL);
+    _slw_atomic_add(&ch->refs, 1);
+    return ch;
 }
 
-SLW_NODISCARD SLW_API SLW_INLINE bool
-slwStack_isstring(slwState* slw, const int32_t idx)
+SLW_API void
+slwChannel_release(slwChannel* ch)
 {
-    SLW_CHECKSTATE(slw);
-    return lua_isstring(slw->LState, idx);
-}
+    SLW_ASSERT(ch != NULL);
+    if (_slw_atomic_add(&ch->refs, -1) != 0)
+        return;
 
-SLW_NODISCARD SLW_API SLW_INLINE bool
-slwStack_istable(slwState* slw, const int32_t idx)
-{
-    SLW_CHECKSTATE(slw);
-    return lua_istable(slw->LState, idx);
+    uint8_t* data;
+    size_t size;
+    while (_slwChannel_dequeue(ch, &data, &size))
+        slw_free(data);
+    slw_free(ch);
 }
 
-SLW_NODISCARD SLW_API SLW_INLINE bool
-slwStack_isthread(slwState* slw, const int32_t idx)
+SLW_API void
+slwChannel_close(slwChannel* ch)
 {
-    SLW_CHECKSTATE(slw);
-    return lua_isthread(slw->LState, idx);
+    SLW_ASSERT(ch != NULL);
+    _slw_atomic_store(&ch->closed, 1);
 }
 
-SLW_NODISCARD SLW_API SLW_INLINE bool
-slwStack_isuserdata(slwState* slw, const int32_t idx)
+SLW_API bool
+slwChannel_trysend(slwState* slw, slwChannel* ch, const int idx)
 {
     SLW_CHECKSTATE(slw);
-    return lua_isuserdata(slw->LState, idx);
-}
+    SLW_ASSERT(ch != NULL);
 
-SLW_NODISCARD SLW_API SLW_INLINE bool
-slwStack_toboolean(slwState* slw, const int32_t idx)
-{
-    SLW_CHECKSTATE(slw);
-    return lua_toboolean(slw->LState, idx);
-}
+    if (_slw_atomic_load(&ch->closed))
+        return false;
 
-SLW_NODISCARD SLW_API SLW_INLINE lua_CFunction
-slwStack_tocfunction(slwState* slw, const int32_t idx)
-{
-    SLW_CHECKSTATE(slw);
-    return lua_tocfunction(slw->LState, idx);
+    _slwBuffer buf = { 0 };
+    if (_slwValue_encode(slw->LState, idx, &buf, 0) != _SLW_VALUE_OK || !_slwChannel_enqueue(ch, buf.data, buf.size))
+    {
+        slw_free(buf.data);
+        return false;
+    }
+    return true;
 }
 
-SLW_NODISCARD SLW_API SLW_INLINE int64_t
-slwStack_tointeger(slwState* slw, const int32_t idx)
+SLW_API bool
+slwChannel_send(slwState* slw, slwChannel* ch, const int idx)
 {
     SLW_CHECKSTATE(slw);
-    return lua_tointeger(slw->LState, idx);
-}
+    SLW_ASSERT(ch != NULL);
 
-SLW_NODISCARD SLW_API SLW_INLINE const char*
-slwStack_tolstring(slwState* slw, const int32_t idx, size_t* len)
-{
-    SLW_CHECKSTATE(slw);
-    return lua_tolstring(slw->LState, idx, len);
-}
+    _slwBuffer buf = { 0 };
+    if (_slwValue_encode(slw->LState, idx, &buf, 0) != _SLW_VALUE_OK)
+    {
+        slw_free(buf.data);
+        return false;
+    }
 
-SLW_NODISCARD SLW_API SLW_INLINE double
-slwStack_tonumber(slwState* slw, const int32_t idx)
-{
-    SLW_CHECKSTATE(slw);
-    return lua_tonumber(slw->LState, idx);
-}
+    uint32_t spins = 0;
+    while (!_slw_atomic_load(&ch->closed))
+    {
+        if (_slwChannel_enqueue(ch, buf.data, buf.size))
+            return true;
+        _slw_backoff(&spins);
+    }
 
-SLW_NODISCARD SLW_API SLW_INLINE const void*
-slwStack_topointer(slwState* slw, const int32_t idx)
-{
-    SLW_CHECKSTATE(slw);
-    return lua_topointer(slw->LState, idx);
+    slw_free(buf.data);
+    return false;
 }
 
-SLW_NODISCARD SLW_API SLW_INLINE const char*
-slwStack_tostring(slwState* slw, const int32_t idx)
+SLW_API bool
+slwChannel_tryrecv(slwState* slw, slwChannel* ch)
 {
     SLW_CHECKSTATE(slw);
-    return lua_tostring(slw->LState, idx);
-}
+    SLW_ASSERT(ch != NULL);
 
-SLW_NODISCARD SLW_API SLW_INLINE void*
-slwStack_tothread(slwState* slw, const int32_t idx)
-{
-    SLW_CHECKSTATE(slw);
-    return lua_tothread(slw->LState, idx);
+    uint8_t* data;
+    size_t size;
+    if (!_slwChannel_dequeue(ch, &data, &size))
+        return false;
+
+    return _slwChannel_pushmessage(slw->LState, data, size);
 }
 
-SLW_NODISCARD SLW_API SLW_INLINE void*
-slwStack_touserdata(slwState* slw, const int32_t idx)
+SLW_API bool
+slwChannel_recv(slwState* slw, slwChannel* ch)
 {
     SLW_CHECKSTATE(slw);
-    return lua_touserdata(slw->LState, idx);
+    SLW_ASSERT(ch != NULL);
+
+    uint32_t spins = 0;
+    for (;;)
+    {
+        if (slwChannel_tryrecv(slw, ch))
+            return true;
+
+        // A last look, something could've been sent right before it was closed
+        if (_slw_atomic_load(&ch->closed))
+            return slwChannel_tryrecv(slw, ch);
+
+        _slw_backoff(&spins);
+    }
 }
 
-SLW_API SLW_INLINE void
-slwStack_setglobal(slwState* slw, const char* name)
+SLW_API void
+slwChannel_push(slwState* slw, slwChannel* ch)
 {
     SLW_CHECKSTATE(slw);
-    lua_setglobal(slw->LState, name);
+    SLW_ASSERT(ch != NULL);
+
+    slwClass_register(slw, &_slwChannelClass);
+    slwChannel** self = (slwChannel**)slwClass_new(slw, &_slwChannelClass);
+    *self = slwChannel_retain(ch);
 }
 
+// Stack Functions
+//------------------------------------------------------------------------
 // Push Functions
 //----------------------------------
-SLW_API SLW_INLINE void
-slwStack_pushstring(slwState* slw, const char* str)
-{
-    SLW_CHECKSTATE(slw);
-    lua_pushstring(slw->LState, str);
-}
-
 SLW_API const char*
 slwStack_pushfstring(slwState* slw, const char* fmt, ...)
 {
@@ -480,67 +7671,10 @@ slwStack_pushfstring(slwState* slw, const char* fmt, ...)
     return result;
 }
 
-SLW_API SLW_INLINE void
-slwStack_pushnumber(slwState* slw, double num)
-{
-    SLW_CHECKSTATE(slw);
-    lua_pushnumber(slw->LState, num);
-}
-
-SLW_API SLW_INLINE void
-slwStack_pushint(slwState* slw, int64_t num)
-{
-    SLW_CHECKSTATE(slw);
-    lua_pushinteger(slw->LState, num);
-}
-
-SLW_API SLW_INLINE void
-slwStack_pushboolean(slwState* slw, bool b)
-{
-    SLW_CHECKSTATE(slw);
-    lua_pushboolean(slw->LState, b);
-}
-
-SLW_API SLW_INLINE void
-slwStack_pushcfunction(slwState* slw, lua_CFunction fn)
-{
-    SLW_CHECKSTATE(slw);
-    lua_pushcfunction(slw->LState, fn);
-}
-
-SLW_API SLW_INLINE void
-slwStack_pushlightudata(slwState* slw, void* data)
-{
-    SLW_CHECKSTATE(slw);
-    lua_pushlightuserdata(slw->LState, data);
-}
-
-SLW_API SLW_INLINE void
-slwStack_pushcclosure(slwState* slw, lua_CFunction fn, int n)
-{
-    SLW_CHECKSTATE(slw);
-    lua_pushcclosure(slw->LState, fn, n);
-}
-
-SLW_API SLW_INLINE void
-slwStack_pushnil(slwState* slw)
-{
-    SLW_CHECKSTATE(slw);
-    lua_pushnil(slw->LState);
-}
-
 // Set Functions (Globals)
 //------------------------------------------------------------------------
-SLW_API SLW_INLINE void
-slwState_setstring(slwState* slw, const char* name, const char* str)
-{
-    SLW_CHECKSTATE(slw);
-    lua_pushstring(slw->LState, str);
-    lua_setglobal(slw->LState, name);
-}
-
 SLW_API const char*
-slwset_setfstring(slwState* slw, const char* name, const char* fmt, ...)
+slwState_setfstring(slwState* slw, const char* name, const char* fmt, ...)
 {
     SLW_CHECKSTATE(slw);
 
@@ -551,74 +7685,132 @@ slwset_setfstring(slwState* slw, const char* name, const char* fmt, ...)
     va_end(args);
 
     lua_setglobal(slw->LState, name);
+    _slwPath_bump(slw->LState);
     return result;
 }
 
 SLW_API SLW_INLINE void
-slwState_setnumber(slwState* slw, const char* name, double num)
+slwState_setcfunction(slwState* slw, const char* name, lua_CFunction fn)
 {
     SLW_CHECKSTATE(slw);
-    lua_pushnumber(slw->LState, num);
+    _slw_pushcclosure(slw, name, fn, 0);
     lua_setglobal(slw->LState, name);
+    _slwPath_bump(slw->LState);
 }
 
 SLW_API SLW_INLINE void
-slwState_setint(slwState* slw, const char* name, uint64_t num)
+slwState_setcclosure(slwState* slw, const char* name, lua_CFunction fn, int n)
 {
     SLW_CHECKSTATE(slw);
-    lua_pushinteger(slw->LState, num);
+    _slw_pushcclosure(slw, name, fn, n);
     lua_setglobal(slw->LState, name);
+    _slwPath_bump(slw->LState);
 }
 
 SLW_API SLW_INLINE void
-slwState_setbool(slwState* slw, const char* name, bool b)
+slwState_settable(slwState* slw, const char* name, slwTable* slt)
 {
     SLW_CHECKSTATE(slw);
-    lua_pushboolean(slw->LState, b);
-    lua_setglobal(slw->LState, name);
-}
+    SLW_ASSERT(slt != NULL);
 
-SLW_API SLW_INLINE void
-slwState_setcfunction(slwState* slw, const char* name, lua_CFunction fn)
-{
-    SLW_CHECKSTATE(slw);
-    lua_pushcfunction(slw->LState, fn);
+    slwTable_push(slw, slt);
     lua_setglobal(slw->LState, name);
+    _slwPath_bump(slw->LState);
 }
 
-SLW_API SLW_INLINE void
-slwState_setlightudata(slwState* slw, const char* name, void* data)
+SLW_API void
+slwState_settableproxy(slwState* slw, const char* name, slwTable* slt)
 {
     SLW_CHECKSTATE(slw);
-    lua_pushlightuserdata(slw->LState, data);
+    SLW_ASSERT(slt != NULL);
 
+    slwTable_pushproxy(slw, slt);
     lua_setglobal(slw->LState, name);
+    _slwPath_bump(slw->LState);
 }
 
-SLW_API SLW_INLINE void
-slwState_setcclosure(slwState* slw, const char* name, lua_CFunction fn, int n)
+// Batch Functions (Globals)
+//------------------------------------------------------------------------
+SLW_API void
+slwState_setmany(slwState* slw, const slwTableValue* values, const size_t count)
 {
     SLW_CHECKSTATE(slw);
-    lua_pushcclosure(slw->LState, fn, n);
-    lua_setglobal(slw->LState, name);
+    SLW_ASSERT(values != NULL || count == 0);
+
+    lua_State* L = slw->LState;
+    _slw_pushglobals(L);
+    for (size_t i = 0; i < count; i++)
+    {
+        lua_pushstring(L, values[i].name);
+        if (values[i].ltype == LUA_TNIL)
+            lua_pushnil(L);
+        else
+            _slwTable_push_value(slw, values[i]);
+        lua_rawset(L, -3);
+    }
+    lua_pop(L, 1);
+    _slwPath_bump(L);
 }
 
-SLW_API SLW_INLINE void
-slwState_settable(slwState* slw, const char* name, slwTable* slt)
+SLW_API size_t
+slwState_getmany(slwState* slw, slwTableValue* values, const size_t count)
 {
     SLW_CHECKSTATE(slw);
-    SLW_ASSERT(slt != NULL);
+    SLW_ASSERT(values != NULL || count == 0);
 
-    slwTable_push(slw, slt);
-    lua_setglobal(slw->LState, name);
-}
+    lua_State* L = slw->LState;
+    size_t found = 0;
+    _slw_pushglobals(L);
+    for (size_t i = 0; i < count; i++)
+    {
+        slwTableValue* val = &values[i];
+        lua_pushstring(L, val->name);
+        lua_rawget(L, -2);
+
+        // Misses keep what the entry had, a default
+        int type = lua_type(L, -1);
+        if (type == LUA_TNUMBER && val->ltype != LUA_TNUMBER && lua_isinteger(L, -1))
+            type = slw_tinteger;
+        if (type == LUA_TNIL || (val->ltype != LUA_TNIL && val->ltype != type))
+        {
+            lua_pop(L, 1);
+            continue;
+        }
 
-SLW_API SLW_INLINE void
-slwState_setnil(slwState* slw, const char* name)
-{
-    SLW_CHECKSTATE(slw);
-    lua_pushnil(slw->LState);
-    lua_setglobal(slw->LState, name);
+        val->ltype = (uint8_t)type;
+        switch (type)
+        {
+            case slw_tinteger:
+                val->value.l = (int64_t)lua_tointeger(L, -1);
+                break;
+            case LUA_TBOOLEAN:
+                val->value.b = lua_toboolean(L, -1);
+                break;
+            case LUA_TNUMBER:
+                val->value.d = (double)lua_tonumber(L, -1);
+                break;
+            case LUA_TSTRING:
+                val->value.s = lua_tostring(L, -1);
+                break;
+            case LUA_TTABLE:
+                val->value.t = slwTable_get_at(slw, -1);
+                break;
+            case LUA_TFUNCTION:
+                val->value.f = lua_tocfunction(L, -1);
+                break;
+            case LUA_TTHREAD:
+                val->value.u = lua_tothread(L, -1);
+                break;
+            default:
+                val->value.u = lua_touserdata(L, -1);
+                break;
+        }
+
+        found++;
+        lua_pop(L, 1);
+    }
+    lua_pop(L, 1);
+    return found;
 }
 
 // Get Functions (Globals)
@@ -629,6 +7821,7 @@ slwState_type_to_c(slwState* slw, const int type, const int idx)
     SLW_CHECKSTATE(slw);
     slwReturnValue ret;
     ret.exists = true;
+    ret.ltype = (uint8_t)type;
 
     lua_State* L = slw->LState;
 
@@ -636,16 +7829,20 @@ slwState_type_to_c(slwState* slw, const int type, const int idx)
     {
         case LUA_TNONE:
             ret.exists = false;
+            ret.ltype = LUA_TNIL;
             return ret;
         case LUA_TBOOLEAN:
             ret.value.b = lua_toboolean(L, idx);
             break;
         case LUA_TNUMBER:
-            const double d = lua_tonumber(L, idx);
-            if (_is_integer(d))
-                ret.value.i = (int)d;
-            else
-                ret.value.d = d;
+            if (lua_isinteger(L, idx))
+            {
+                ret.value.l = (int64_t)lua_tointeger(L, idx);
+                ret.ltype = slw_tinteger;
+            } else
+            {
+                ret.value.d = lua_tonumber(L, idx);
+            }
             break;
         case LUA_TSTRING:
             ret.value.s = lua_tostring(L, idx);
@@ -689,7 +7886,7 @@ slwState_getstring(slwState* slw, const char* name)
     lua_State* L = slw->LState;
     lua_getglobal(L, name);
     if (lua_isstring(L, -1))
-        return (slwReturnValue){.exists = true, .value.s = lua_tostring(L, -1)};
+        return (slwReturnValue){.exists = true, .ltype = LUA_TSTRING, .value.s = lua_tostring(L, -1)};
 
     return (slwReturnValue){.exists = false, .value.b = false};
 }
@@ -701,7 +7898,7 @@ slwState_getnumber(slwState* slw, const char* name)
     lua_State* L = slw->LState;
     lua_getglobal(L, name);
     if (lua_isnumber(L, -1))
-        return (slwReturnValue){.exists = true, .value.d = lua_tonumber(L, -1)};
+        return (slwReturnValue){.exists = true, .ltype = LUA_TNUMBER, .value.d = lua_tonumber(L, -1)};
 
     return (slwReturnValue){.exists = false, .value.b = false};
 }
@@ -717,7 +7914,7 @@ slwState_getint(slwState* slw, const char* name)
 #else
     if (lua_isinteger(L, -1))
 #endif
-        return (slwReturnValue){.exists = true, .value.i = lua_tointeger(L, -1)};
+        return (slwReturnValue){.exists = true, .ltype = slw_tinteger, .value.l = (int64_t)lua_tointeger(L, -1)};
 
     return (slwReturnValue){.exists = false, .value.b = false};
 }
@@ -729,7 +7926,7 @@ slwState_getbool(slwState* slw, const char* name)
     lua_State* L = slw->LState;
     lua_getglobal(L, name);
     if (lua_isboolean(L, -1))
-        return (slwReturnValue){.exists = true, .value.i = lua_toboolean(L, -1)};
+        return (slwReturnValue){.exists = true, .ltype = LUA_TBOOLEAN, .value.i = lua_toboolean(L, -1)};
 
     return (slwReturnValue){.exists = false, .value.b = false};
 }
@@ -741,7 +7938,7 @@ slwState_getcfunction(slwState* slw, const char* name)
     lua_State* L = slw->LState;
     lua_getglobal(L, name);
     if (lua_iscfunction(L, -1))
-        return (slwReturnValue){.exists = true, .value.f = lua_tocfunction(L, -1)};
+        return (slwReturnValue){.exists = true, .ltype = LUA_TFUNCTION, .value.f = lua_tocfunction(L, -1)};
 
     return (slwReturnValue){.exists = false, .value.b = false};
 }
@@ -753,7 +7950,7 @@ slwState_getfunction(slwState* slw, const char* name)
     lua_State* L = slw->LState;
     lua_getglobal(L, name);
     if (lua_iscfunction(L, -1))
-        return (slwReturnValue){.exists = true, .value.b = false};
+        return (slwReturnValue){.exists = true, .ltype = LUA_TFUNCTION, .value.b = false};
 
     return (slwReturnValue){.exists = false, .value.b = false};
 }
@@ -765,7 +7962,7 @@ slwState_getuserdata(slwState* slw, const char* name)
     lua_State* L = slw->LState;
     lua_getglobal(L, name);
     if (lua_isuserdata(L, -1))
-        return (slwReturnValue){.exists = true, .value.u = lua_touserdata(L, -1)};
+        return (slwReturnValue){.exists = true, .ltype = (uint8_t)lua_type(L, -1), .value.u = lua_touserdata(L, -1)};
 
     return (slwReturnValue){.exists = false, .value.b = false};
 }
@@ -784,7 +7981,7 @@ slwState_getnil(slwState* slw, const char* name)
 
 SLW_API slwTable*
 slwTable_create() {
-    return (slwTable*)calloc(1, sizeof(slwTable));
+    return (slwTable*)slw_calloc(1, sizeof(slwTable));
 }
 
 // Table Functions
@@ -815,6 +8012,7 @@ slwTable_createkv(slwState* slw, ...)
     slwTable* tbl = (slwTable*)slw_malloc(sizeof(slwTable));
     tbl->elements = (slwTableValue*)slw_malloc(sizeof(slwTableValue) * tableLen);
     tbl->size = tableLen;
+    tbl->binding = NULL;
 
     for (int i = 0; i < tableLen; i++)
     {
@@ -854,6 +8052,7 @@ slwTable_createi(slwState* slw, ...)
     slwTable* tbl = (slwTable*)slw_malloc(sizeof(slwTable));
     tbl->elements = (slwTableValue*)slw_malloc(sizeof(slwTableValue) * tableLen);
     tbl->size = tableLen;
+    tbl->binding = NULL;
 
     for (int i = 0; i < tableLen; i++)
     {
@@ -874,10 +8073,25 @@ slwTable_free(slwTable* slt)
 {
     SLW_ASSERT(slt != NULL);
 
-    free(slt->elements);
+    _slwTable_unbind(slt);
+    slw_free(slt->elements);
     slt->elements = NULL;
     slt->size = 0;
-    free(slt);
+    slw_free(slt);
+}
+
+SLW_API void
+slwTable_free_deep(slwTable* slt)
+{
+    SLW_ASSERT(slt != NULL);
+
+    for (size_t i = 0; i < slt->size; i++)
+    {
+        const slwTableValue* el = &slt->elements[i];
+        if (el->ltype == LUA_TTABLE && el->value.t)
+            slwTable_free_deep(el->value.t);
+    }
+    slwTable_free(slt);
 }
 
 SLW_API void
@@ -922,6 +8136,20 @@ slwTable_push(slwState* slw, slwTable* slt)
     }
 }
 
+SLW_API void
+slwTable_pushproxy(slwState* slw, slwTable* slt)
+{
+    SLW_CHECKSTATE(slw);
+    SLW_ASSERT(slt != NULL);
+    lua_State* L = slw->LState;
+
+    _slwTableProxy_pushmeta(L);
+    const int top = lua_gettop(L);
+    _slwTableProxy_push(L, slt, top - 1, top);
+    lua_replace(L, top - 1);
+    lua_settop(L, top - 1);
+}
+
 SLW_API slwTable*
 slwTable_get_at(slwState* slw, const int32_t idx) // TODO: rename to `get_at` and create another one to call this with -1
 {
@@ -933,6 +8161,7 @@ slwTable_get_at(slwState* slw, const int32_t idx) // TODO: rename to `get_at` an
 
     slwTable* tbl = (slwTable*)slw_malloc(sizeof(slwTable));
     tbl->elements = NULL;
+    tbl->binding = NULL;
 
 #if LUA_VERSION_NUM > 501
     int tableLen = lua_rawlen(L, idx);
@@ -958,8 +8187,15 @@ slwTable_get_at(slwState* slw, const int32_t idx) // TODO: rename to `get_at` an
                         value.value.s = lua_tostring(L, idx);
                         break;
                     case LUA_TNUMBER:
-                        value.ltype = LUA_TNUMBER;
-                        value.value.d = lua_tonumber(L, idx);
+                        if (lua_isinteger(L, idx))
+                        {
+                            value.ltype = slw_tinteger;
+                            value.value.l = (int64_t)lua_tointeger(L, idx);
+                        } else
+                        {
+                            value.ltype = LUA_TNUMBER;
+                            value.value.d = lua_tonumber(L, idx);
+                        }
                         break;
                     case LUA_TBOOLEAN:
                         value.ltype = LUA_TBOOLEAN;
@@ -1005,8 +8241,15 @@ slwTable_get_at(slwState* slw, const int32_t idx) // TODO: rename to `get_at` an
                     value.value.s = lua_tostring(L, idx);
                     break;
                 case LUA_TNUMBER:
-                    value.ltype = LUA_TNUMBER;
-                    value.value.d = lua_tonumber(L, idx);
+                    if (lua_isinteger(L, idx))
+                    {
+                        value.ltype = slw_tinteger;
+                        value.value.l = (int64_t)lua_tointeger(L, idx);
+                    } else
+                    {
+                        value.ltype = LUA_TNUMBER;
+                        value.value.d = lua_tonumber(L, idx);
+                    }
                     break;
                 case LUA_TBOOLEAN:
                     value.ltype = LUA_TBOOLEAN;
@@ -1036,12 +8279,6 @@ slwTable_get_at(slwState* slw, const int32_t idx) // TODO: rename to `get_at` an
     return tbl;
 }
 
-SLW_API SLW_INLINE slwTable*
-slwTable_get(slwState* slw)
-{
-    return slwTable_get_at(slw, -1);
-}
-
 // TODO: variadic arguments so I can easily do something like: `slwTable_get_from_key(slw, "SOME_GLOBAL2", "nested", "another_nested", "fn")`
 SLW_API slwTableValue*
 slwTable_getkey(slwTable* slt, const char* key)
@@ -1114,6 +8351,7 @@ slwTable_setval(slwTable* slt, ...)
 
                 currentTable->elements = (slwTableValue*)slw_realloc(currentTable->elements, sizeof(slwTableValue) * (currentTable->size + 1));
                 currentTable->elements[currentTable->size++] = newTableValue;
+                slwTable_touch(currentTable, currentTable->size - 1);
 
                 foundValue = &currentTable->elements[currentTable->size - 1];
             }
@@ -1132,6 +8370,7 @@ slwTable_setval(slwTable* slt, ...)
                 slwTableValue* el = &currentTable->elements[j];
                 el->ltype = value->ltype;
                 el->value = value->value;
+                slwTable_touch(currentTable, j);
                 keyExists = true;
                 break;
             }
@@ -1145,6 +8384,7 @@ slwTable_setval(slwTable* slt, ...)
 
             currentTable->elements = (slwTableValue*)slw_realloc(currentTable->elements, sizeof(slwTableValue) * (currentTable->size + 1));
             currentTable->elements[currentTable->size++] = newValue;
+            slwTable_touch(currentTable, currentTable->size - 1);
         }
     }
 
@@ -1172,6 +8412,7 @@ SLW_API void slwState_settable2(slwState* slw, ...)
             value = (slwTableValue*)key;
             break;
         }
+        SLW_ASSERT(numKeys < SLW_TABLE_MAX_KEYS); // Deeper paths can use `slwPath_compile`
         keys[numKeys++] = key;
     }
 
@@ -1213,6 +8454,7 @@ SLW_API void slwState_settable2(slwState* slw, ...)
     lua_settable(L, -3);
 
     lua_pop(L, numKeys - 1);
+    _slwPath_bump(L);
 }
 
 // Table Set Functions
@@ -1265,7 +8507,7 @@ SLW_API SLW_INLINE void
 slwTable_setint(slwTable* slt, const char* name, uint64_t num)
 {
     SLW_ASSERT(slt != NULL);
-    _slwTable_set_value(slt, name, slwt_tnumber(num)); // Todo: make integer
+    _slwTable_set_value(slt, name, slwt_tinteger((int64_t)num));
 }
 
 SLW_API SLW_INLINE void
@@ -1318,10 +8560,13 @@ _slwTable_print_value(slwState* slw, slwTableValue value, int depth, int idx)
             break;
         case LUA_TNUMBER:
             if (_is_integer(value.value.d))
-                printf("%d\n", (int)value.value.d);
+                printf("%lld\n", (long long)value.value.d);
             else
                 printf("%f\n", value.value.d);
             break;
+        case slw_tinteger:
+            printf("%lld\n", (long long)value.value.l);
+            break;
         case LUA_TBOOLEAN:
             printf("%s\n", value.value.b ? "true" : "false");
             break;
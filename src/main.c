@@ -9,11 +9,8 @@
 
 int l_my_function(lua_State* L)
 {
-#if defined(SLW_GENERICS_SUPPORT)
-    slwState* slw = slwState_new(L);
-#else
-    slwState* slw = slwState_new_from_luas(L);
-#endif
+    slwState view = slwState_view(L);
+    slwState* slw = &view;
     printf("l_my_function called\n");
 
     slwTable* tbl = slwTable_get_at(slw, -1);
@@ -84,6 +81,56 @@ int main(void)
         }
     }
 
+    // Proxies, keys longer than any element name don't match
+    {
+        slwTable* cfg = slw_calloc(1, sizeof(slwTable));
+        slwTable_setnumber(cfg, "hp", 100);
+        slwState_settableproxy(slw, "cfg", cfg);
+        if (!slwState_runstring(slw, "assert(cfg.hp == 100 and cfg[string.rep('h', 200)] == nil and cfg['hp\\0'] == nil)"))
+            printf("Proxy lookup failed: %s\n", lua_tostring(slw->LState, -1));
+
+        lua_pushnil(slw->LState);
+        lua_setglobal(slw->LState, "cfg");
+        lua_gc(slw->LState, LUA_GCCOLLECT, 0);
+        slwTable_free(cfg);
+    }
+
+    // Compiled paths, scripts replacing a table along the path
+    {
+        slwPath* path = slwPath_compile(slw, "game.player.hp");
+        (void)slwPath_set(path, slwt_tnumber(9));
+        if (!slwState_runstring(slw, "game.player = { hp = 10 }") || slwPath_getnumber(path, 0) != 10)
+            printf("Path read a replaced table\n");
+
+        (void)slwPath_set(path, slwt_tnumber(11));
+        if (!slwState_runstring(slw, "assert(game.player.hp == 11)"))
+            printf("Path wrote into a replaced table: %s\n", lua_tostring(slw->LState, -1));
+
+        (void)slwPath_getnumber(path, 0);
+        slwState_setnil(slw, "game");
+        if (slwPath_getnumber(path, 0) != 0)
+            printf("Path read a removed global\n");
+        slwPath_free(path);
+    }
+
+    // Event tables are reused, keys a handler adds don't reach the next event
+    {
+        if (!slwState_runstring(slw, "function onEvent(e) assert(e.seen == nil) e.seen = true end"))
+            printf("%s\n", lua_tostring(slw->LState, -1));
+        lua_getglobal(slw->LState, "onEvent");
+        slwEventHandler* handler = slwEvent_bind(slw, -1);
+        lua_pop(slw->LState, 1);
+
+        slwTableValue fields[] = { { "x", LUA_TNUMBER, { .d = 1 } } };
+        const slwTable event = { fields, 1, NULL };
+        for (int i = 0; i < 2; i++)
+        {
+            if (!slwEvent_dispatch(handler, &event))
+                printf("Event kept a key: %s\n", lua_tostring(slw->LState, -1));
+        }
+        slwEvent_unbind(handler);
+    }
+
     // Cleanup
     slwState_destroy(slw);
 }
\ No newline at end of file